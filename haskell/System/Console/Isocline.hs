@@ -89,6 +89,13 @@ module System.Console.Isocline(
       completeQuotedWord,
       completeQuotedWordEx,
 
+      CharClass(..),
+      CharClassId(..),
+      charClass,
+      completeWordClass,
+      completeQuotedWordClass,
+      completeQuotedWordClassEx,
+
       Completion(..),
       completion,
       isPrefix,
@@ -121,6 +128,7 @@ module System.Console.Isocline(
       enableHistoryDuplicates,
       enableCompletionPreview,
       enableMultilineIndent,
+      enableHorizontalScroll,
       enableHighlight,
       enableInlineHelp,
       enableHint,
@@ -138,6 +146,8 @@ module System.Console.Isocline(
       completeWordPrim,
       completeQuotedWordPrim,
       completeQuotedWordPrimEx,
+      completeWordPrimClass,
+      completeQuotedWordPrimClassEx,
 
       readlineMaybe,
       readlineExMaybe,
@@ -151,6 +161,22 @@ module System.Console.Isocline(
 
       asyncStop,
 
+      -- * ByteString and Text
+      readlineBS,
+      readlinePrimBS,
+      readlineText,
+      readlinePrimText,
+      CompletionBS(..),
+      completionBS,
+      completionText,
+      completionTextFull,
+      addCompletionsBS,
+      completeWordBS,
+      completeQuotedWordBS,
+      completeWordText,
+      highlightFmtBS,
+      highlightFmtText,
+
       -- * Low-level highlighting
       HighlightEnv,      
       setDefaultHighlighter,      
@@ -180,10 +206,12 @@ import Control.Exception( bracket )
 import Foreign.C.String( CString, peekCString, peekCStringLen, withCString, castCharToCChar )
 import Foreign.Ptr
 import Foreign.C.Types
+import Foreign.Marshal.Alloc( allocaBytes )
 
 -- the following are used for utf8 encoding.
-import qualified Data.ByteString as B ( useAsCString, packCString )
-import qualified Data.Text as T  ( pack, unpack )
+import qualified Data.ByteString as B ( ByteString, useAsCString, packCString, concat, empty, singleton )
+import qualified Data.ByteString.Unsafe as BU ( unsafeUseAsCStringLen, unsafePackCStringFinalizer )
+import qualified Data.Text as T  ( Text, pack, unpack )
 import Data.Text.Encoding as TE  ( decodeUtf8With, encodeUtf8)
 import Data.Text.Encoding.Error  ( lenientDecode )
 
@@ -343,10 +371,13 @@ foreign import ccall "wrapper" ic_make_charclassfun :: CCharClassFun -> IO (FunP
 
 foreign import ccall ic_add_completion_ex     :: Ptr IcCompletionEnv -> CString -> CString -> CString -> IO CCBool
 foreign import ccall ic_add_completion_prim   :: Ptr IcCompletionEnv -> CString -> CString -> CString -> CInt -> CInt -> IO CCBool
+foreign import ccall ic_add_completions_packed :: Ptr IcCompletionEnv -> CString -> CLong -> IO CCBool
 foreign import ccall ic_complete_filename     :: Ptr IcCompletionEnv -> CString -> CChar -> CString -> CString -> IO ()
 foreign import ccall ic_complete_word         :: Ptr IcCompletionEnv -> CString -> FunPtr CCompleterFun -> FunPtr CCharClassFun -> IO ()
 foreign import ccall ic_complete_qword        :: Ptr IcCompletionEnv -> CString -> FunPtr CCompleterFun -> FunPtr CCharClassFun -> IO ()
 foreign import ccall ic_complete_qword_ex     :: Ptr IcCompletionEnv -> CString -> FunPtr CCompleterFun -> FunPtr CCharClassFun -> CChar -> CString -> IO ()
+foreign import ccall ic_complete_word_class     :: Ptr IcCompletionEnv -> CString -> FunPtr CCompleterFun -> Ptr IcCharClass -> IO ()
+foreign import ccall ic_complete_qword_ex_class :: Ptr IcCompletionEnv -> CString -> FunPtr CCompleterFun -> Ptr IcCharClass -> CChar -> CString -> IO ()
 
 foreign import ccall ic_has_completions       :: Ptr IcCompletionEnv -> IO CCBool
 foreign import ccall ic_stop_completing       :: Ptr IcCompletionEnv -> IO CCBool
@@ -440,17 +471,17 @@ addCompletionPrim (CompletionEnv rpc) (Completion replacement display help) dele
        return (fromEnum cbool /= 0)
 
     
--- | @addCompletions compl completions@: add multiple completions at once.
+-- | @addCompletions compl completions@: add multiple completions at once
+-- (with a single foreign call).
 -- If 'addCompletions' returns 'True' keep adding completions,
 -- but if it returns 'False' an effort should be made to return from the completer
 -- callback without adding more completions.
 addCompletions :: CompletionEnv -> [Completion] -> IO Bool
-addCompletions compl [] = return True
-addCompletions compl (c:cs)
-  = do continue <- addCompletion compl c
-       if (continue) 
-         then addCompletions compl cs
-         else return False
+addCompletions compl completions
+  = addCompletionsBS compl (map toCompletionBS completions)
+  where
+    toCompletionBS (Completion replacement display help)
+      = CompletionBS (encodeUTF8 replacement) (encodeUTF8 display) (encodeUTF8 help)
 
 -- | @completeFileName compls input dirSep roots extensions@: 
 -- Complete filenames with the given @input@, a possible directory separator @dirSep@, 
@@ -481,6 +512,7 @@ completeFileName (CompletionEnv rpc) prefx dirSep roots extensions
 -- is limited to the /word/ just before the cursor.
 -- Pass 'Nothing' to @isWordChar@ for the default @not . separator@
 -- where @separator = \c -> c `elem` \" \\t\\r\\n,.;:/\\\\(){}[]\"@.
+-- See also 'completeWordClass' which avoids calling @isWordChar@ for every character.
 completeWord :: CompletionEnv -> String -> Maybe (Char -> Bool) -> (String -> [Completion]) -> IO () 
 completeWord cenv input isWordChar completer 
   = completeWordPrim cenv input isWordChar cenvCompleter
@@ -593,6 +625,56 @@ completeQuotedWordPrimEx (CompletionEnv rpc) prefx isWordChar escapeChar quoteCh
        ic_complete_qword_ex rpc cprefx ccompleter cisWordChar cescapeChar cquoteChars
        
 
+-- | @completeWordClass compl input wordChars completer@: 
+-- As 'completeWord' but the /word/ characters are given by a 'CharClass' that is evaluated natively
+-- instead of by a Haskell function that is called for every character.
+completeWordClass :: CompletionEnv -> String -> CharClass -> (String -> [Completion]) -> IO () 
+completeWordClass cenv input wordChars completer 
+  = completeWordPrimClass cenv input wordChars cenvCompleter
+  where
+    cenvCompleter cenv input
+      = do addCompletions cenv (completer input)
+           return ()
+
+-- | @completeQuotedWordClass compl input wordChars completer@: 
+-- As 'completeQuotedWord' but the /word/ characters are given by a 'CharClass' that is evaluated natively.
+completeQuotedWordClass :: CompletionEnv -> String -> CharClass -> (String -> [Completion]) -> IO () 
+completeQuotedWordClass cenv input wordChars completer 
+  = completeQuotedWordClassEx cenv input wordChars (Just '\\') "'\"" completer
+
+-- | @completeQuotedWordClassEx compl input wordChars escapeChar quoteChars completer@: 
+-- As 'completeQuotedWordEx' but the /word/ characters are given by a 'CharClass' that is evaluated natively.
+completeQuotedWordClassEx :: CompletionEnv -> String -> CharClass -> Maybe Char -> String -> (String -> [Completion]) -> IO () 
+completeQuotedWordClassEx cenv input wordChars escapeChar quoteChars completer 
+  = completeQuotedWordPrimClassEx cenv input wordChars escapeChar quoteChars cenvCompleter 
+  where
+    cenvCompleter cenv input 
+      = do addCompletions cenv (completer input)
+           return ()
+
+-- | @completeWordPrimClass compl input wordChars completer@: 
+-- As 'completeWordPrim' but the /word/ characters are given by a 'CharClass' that is evaluated natively.
+completeWordPrimClass :: CompletionEnv -> String -> CharClass -> (CompletionEnv -> String -> IO ()) -> IO () 
+completeWordPrimClass (CompletionEnv rpc) prefx wordChars completer 
+  = withUTF8String prefx $ \cprefx ->
+    withCharClass wordChars $ \cwordChars ->
+    withCCompleter (Just completer) $ \ccompleter ->
+    do ic_complete_word_class rpc cprefx ccompleter cwordChars
+
+-- | @completeQuotedWordPrimClassEx compl input wordChars escapeChar quoteChars completer@: 
+-- As 'completeQuotedWordPrimEx' but the /word/ characters are given by a 'CharClass' that is evaluated natively.
+completeQuotedWordPrimClassEx :: CompletionEnv -> String -> CharClass -> Maybe Char -> String -> (CompletionEnv -> String -> IO ()) ->  IO () 
+completeQuotedWordPrimClassEx (CompletionEnv rpc) prefx wordChars escapeChar quoteChars completer
+  = withUTF8String prefx $ \cprefx ->
+    withUTF8String0 quoteChars $ \cquoteChars ->
+    withCharClass wordChars $ \cwordChars ->
+    withCCompleter (Just completer) $ \ccompleter ->
+    do let cescapeChar = case escapeChar of
+                          Nothing -> toEnum 0
+                          Just c  -> castCharToCChar c                      
+       ic_complete_qword_ex_class rpc cprefx ccompleter cwordChars cescapeChar cquoteChars
+
+
 withCharClassFun :: Maybe (Char -> Bool) -> (FunPtr CCharClassFun -> IO a) -> IO a
 withCharClassFun isInClass action
   = bracket (makeCharClassFun isInClass) (\cfun -> when (nullFunPtr /= cfun) (freeHaskellFunPtr cfun))  action 
@@ -609,6 +691,68 @@ makeCharClassFun (Just isInClass)
     in do ic_make_charclassfun charClassFun
           
 
+
+----------------------------------------------------------------------------
+-- Character classes
+----------------------------------------------------------------------------
+
+data IcCharClass
+
+foreign import ccall ic_char_class_init       :: Ptr IcCharClass -> CInt -> IO ()
+foreign import ccall ic_char_class_set_ascii  :: Ptr IcCharClass -> CString -> CCBool -> IO ()
+foreign import ccall ic_char_class_add_range  :: Ptr IcCharClass -> CUInt -> CUInt -> IO CCBool
+
+-- | Predefined character classes.
+data CharClassId
+  = ClassEmpty            -- ^ no characters
+  | ClassWhite            -- ^ white space: @[ \\t\\r\\n]@
+  | ClassNonWhite         -- ^ anything but white space
+  | ClassSeparator        -- ^ separators: @[ \\t\\r\\n,.;:/\\\\(){}[]]@
+  | ClassNonSeparator     -- ^ anything but separators (the default word characters)
+  | ClassLetter           -- ^ @[A-Za-z]@ and any non-ASCII character
+  | ClassDigit            -- ^ @[0-9]@
+  | ClassHexDigit         -- ^ @[A-Fa-f0-9]@
+  | ClassIdLetter         -- ^ @[A-Za-z0-9_-]@ and any non-ASCII character
+  | ClassFileNameLetter   -- ^ anything but @[ \\t\\r\\n`\@$><=;|&{}()[]]@
+  deriving (Eq, Show, Enum, Bounded)
+
+-- | A character class that is evaluated natively by Isocline with table lookups,
+-- instead of calling a Haskell function for every character.
+-- It starts from a predefined 'classBase' where 'classAdd' and 'classRemove' add or remove 
+-- ASCII characters. Non-ASCII characters in one of the 'classExcept' ranges get the opposite
+-- membership of the other non-ASCII characters in the base class (at most 16 ranges are used).
+-- For example, identifiers that can contain a @\'@ but no unicode punctuation:
+--
+-- > (charClass ClassIdLetter){ classAdd = "'", classExcept = [('\x2000','\x206F')] }
+--
+data CharClass = CharClass { 
+  classBase   :: CharClassId,    -- ^ the predefined class to start from
+  classAdd    :: String,         -- ^ ASCII characters to add
+  classRemove :: String,         -- ^ ASCII characters to remove
+  classExcept :: [(Char,Char)]   -- ^ inclusive ranges of non-ASCII characters that are an exception
+} deriving (Eq, Show)
+
+-- | A predefined character class.
+charClass :: CharClassId -> CharClass
+charClass base
+  = CharClass base "" "" []
+
+-- the size of an @ic_char_class_t@ (6 + 2*IC_CHAR_CLASS_MAX_RANGES 32-bit fields)
+charClassSize :: Int
+charClassSize = 4 * (6 + 2*16)
+
+withCharClass :: CharClass -> (Ptr IcCharClass -> IO a) -> IO a
+withCharClass (CharClass base add remove except) action
+  = allocaBytes charClassSize $ \ccls ->
+    do ic_char_class_init ccls (toEnum (fromEnum base))
+       when (not (null add)) $ 
+         withUTF8String add $ \cadd -> ic_char_class_set_ascii ccls cadd (cbool True)
+       when (not (null remove)) $ 
+         withUTF8String remove $ \cremove -> ic_char_class_set_ascii ccls cremove (cbool False)
+       mapM_ (\(lo,hi) -> ic_char_class_add_range ccls (toEnum (fromEnum lo)) (toEnum (fromEnum hi))) except
+       action ccls
+
+
 -- | If this returns 'True' an effort should be made to stop completing and return from the callback.
 stopCompleting :: CompletionEnv -> IO Bool
 stopCompleting (CompletionEnv rpc)
@@ -701,6 +845,152 @@ setDefaultFmtHighlighter highlight
 
 
 
+----------------------------------------------------------------------------
+-- ByteString and Text
+-- These pass strict UTF-8 encoded bytestrings (or text) to and from the 
+-- C library without converting through `String`, and completions are 
+-- submitted in a batch with a single foreign call.
+----------------------------------------------------------------------------
+
+-- | A completion entry with UTF-8 encoded strings. 
+-- (None of the strings can contain a 0 character).
+data CompletionBS = CompletionBS { 
+  replacementBS :: B.ByteString,  -- ^ actual replacement
+  displayBS :: B.ByteString,      -- ^ display of the completion in the completion menu (or empty)
+  helpBS :: B.ByteString          -- ^ help message (or empty)
+} deriving (Eq, Show)
+
+-- | Create a completion with just a (UTF-8 encoded) replacement.
+completionBS :: B.ByteString -> CompletionBS
+completionBS replacement
+  = CompletionBS replacement B.empty B.empty
+
+-- | Create a completion with just a replacement.
+completionText :: T.Text -> CompletionBS
+completionText replacement
+  = completionBS (TE.encodeUtf8 replacement)
+
+-- | @completionTextFull replacement display help@: Create a completion with a separate display and help string.
+completionTextFull :: T.Text -> T.Text -> T.Text -> CompletionBS
+completionTextFull replacement display help
+  = CompletionBS (TE.encodeUtf8 replacement) (TE.encodeUtf8 display) (TE.encodeUtf8 help)
+
+-- | @addCompletionsBS compl completions@: add multiple completions at once.
+-- All completions are packed into one buffer and passed with a single foreign call.
+-- If 'addCompletionsBS' returns 'True' keep adding completions,
+-- but if it returns 'False' an effort should be made to return from the completer
+-- callback without adding more completions.
+addCompletionsBS :: CompletionEnv -> [CompletionBS] -> IO Bool
+addCompletionsBS compl [] = return True
+addCompletionsBS (CompletionEnv rpc) completions
+  = BU.unsafeUseAsCStringLen packed $ \(centries,len) ->
+    uncbool $ ic_add_completions_packed rpc centries (clong len)
+  where
+    packed = B.concat (concatMap entry completions)
+    entry (CompletionBS replacement display help) = [replacement, nul, display, nul, help, nul]
+    nul    = B.singleton 0
+
+-- | @readlineBS prompt@: as 'readlineMaybe' but with a UTF-8 encoded prompt and result.
+-- The result is not copied but refers directly to the memory returned by Isocline.
+readlineBS :: B.ByteString -> IO (Maybe B.ByteString)
+readlineBS prompt
+  = readlinePrimBS prompt Nothing Nothing
+
+-- | @readlinePrimBS prompt mbCompleter mbHighlighter@: as 'readlinePrimMaybe' but with 
+-- UTF-8 encoded strings. The completer and highlighter get the input as a 'B.ByteString' as well.
+readlinePrimBS :: B.ByteString -> Maybe (CompletionEnv -> B.ByteString -> IO ()) -> Maybe (HighlightEnv -> B.ByteString -> IO ()) -> IO (Maybe B.ByteString)
+readlinePrimBS prompt completer highlighter
+  = B.useAsCString prompt $ \cprompt ->
+    bracket (makeCCompleterBS completer) freeFunPtr $ \ccompleter ->
+    bracket (makeCHighlighterBS highlighter) freeFunPtr $ \chighlighter ->
+    do cres <- ic_readline_ex cprompt ccompleter nullPtr chighlighter nullPtr
+       peekBSMaybe cres
+  where
+    freeFunPtr cfun = when (nullFunPtr /= cfun) (freeHaskellFunPtr cfun)
+
+-- | @readlineText prompt@: as 'readlineMaybe' but with a 'T.Text' prompt and result.
+readlineText :: T.Text -> IO (Maybe T.Text)
+readlineText prompt
+  = readlinePrimText prompt Nothing Nothing
+
+-- | @readlinePrimText prompt mbCompleter mbHighlighter@: as 'readlinePrimMaybe' but with 'T.Text' strings.
+readlinePrimText :: T.Text -> Maybe (CompletionEnv -> T.Text -> IO ()) -> Maybe (HighlightEnv -> T.Text -> IO ()) -> IO (Maybe T.Text)
+readlinePrimText prompt completer highlighter
+  = do res <- readlinePrimBS (TE.encodeUtf8 prompt) (fmap onText completer) (fmap onText highlighter)
+       return (fmap decodeUTF8 res)
+  where
+    onText f env input = f env (decodeUTF8 input)
+
+-- | @completeWordBS compl input wordChars completer@: as 'completeWordClass' but with UTF-8 encoded strings
+-- and the completions are added in a single batch.
+completeWordBS :: CompletionEnv -> B.ByteString -> CharClass -> (B.ByteString -> [CompletionBS]) -> IO ()
+completeWordBS (CompletionEnv rpc) prefx wordChars completer
+  = B.useAsCString prefx $ \cprefx ->
+    withCharClass wordChars $ \cwordChars ->
+    withCCompleterBS (Just cenvCompleter) $ \ccompleter ->
+    do ic_complete_word_class rpc cprefx ccompleter cwordChars
+  where
+    cenvCompleter cenv input
+      = do addCompletionsBS cenv (completer input)
+           return ()
+
+-- | @completeQuotedWordBS compl input wordChars completer@: as 'completeQuotedWordClass' but with 
+-- UTF-8 encoded strings and the completions are added in a single batch.
+completeQuotedWordBS :: CompletionEnv -> B.ByteString -> CharClass -> (B.ByteString -> [CompletionBS]) -> IO ()
+completeQuotedWordBS (CompletionEnv rpc) prefx wordChars completer
+  = B.useAsCString prefx $ \cprefx ->
+    withCharClass wordChars $ \cwordChars ->
+    withCCompleterBS (Just cenvCompleter) $ \ccompleter ->
+    do ic_complete_qword_ex_class rpc cprefx ccompleter cwordChars (castCharToCChar '\\') nullPtr
+  where
+    cenvCompleter cenv input
+      = do addCompletionsBS cenv (completer input)
+           return ()
+
+-- | @completeWordText compl input wordChars completer@: as 'completeWordBS' but with 'T.Text' input.
+completeWordText :: CompletionEnv -> T.Text -> CharClass -> (T.Text -> [CompletionBS]) -> IO ()
+completeWordText cenv prefx wordChars completer
+  = completeWordBS cenv (TE.encodeUtf8 prefx) wordChars (completer . decodeUTF8)
+
+-- | Use a rich text formatted highlighter from inside a highlighter callback (as 'highlightFmt') 
+-- where the highlighter returns a UTF-8 encoded 'Fmt'.
+highlightFmtBS :: (B.ByteString -> B.ByteString) -> (HighlightEnv -> B.ByteString -> IO ())
+highlightFmtBS highlight (HighlightEnv henv) input 
+  = B.useAsCString input $ \cinput ->
+    B.useAsCString (highlight input) $ \cfmt ->
+    do ic_highlight_formatted henv cinput cfmt
+
+-- | Use a rich text formatted highlighter from inside a highlighter callback (as 'highlightFmt') 
+-- where the highlighter returns a 'T.Text' 'Fmt'.
+highlightFmtText :: (T.Text -> T.Text) -> (HighlightEnv -> T.Text -> IO ())
+highlightFmtText highlight henv input
+  = highlightFmtBS (TE.encodeUtf8 . highlight . decodeUTF8) henv (TE.encodeUtf8 input)
+
+withCCompleterBS :: Maybe (CompletionEnv -> B.ByteString -> IO ()) -> (FunPtr CCompleterFun -> IO a) -> IO a
+withCCompleterBS completer action
+  = bracket (makeCCompleterBS completer) (\cfun -> when (nullFunPtr /= cfun) (freeHaskellFunPtr cfun)) action
+
+makeCCompleterBS :: Maybe (CompletionEnv -> B.ByteString -> IO ()) -> IO (FunPtr CCompleterFun)
+makeCCompleterBS Nothing = return nullFunPtr
+makeCCompleterBS (Just completer)
+  = ic_make_completer wrapper
+  where
+    wrapper :: Ptr IcCompletionEnv -> CString -> IO ()
+    wrapper rpcomp cprefx
+      = do prefx <- peekBS0 cprefx
+           completer (CompletionEnv rpcomp) prefx
+
+makeCHighlighterBS :: Maybe (HighlightEnv -> B.ByteString -> IO ()) -> IO (FunPtr CHighlightFun)
+makeCHighlighterBS Nothing = return nullFunPtr 
+makeCHighlighterBS (Just highlighter)
+  = ic_make_highlight_fun wrapper
+  where 
+    wrapper :: Ptr IcHighlightEnv -> CString -> Ptr () -> IO ()
+    wrapper henv cinput carg
+      = do input <- peekBS0 cinput
+           highlighter (HighlightEnv henv) input
+
+
 ----------------------------------------------------------------------------
 -- Print rich text
 ----------------------------------------------------------------------------
@@ -868,6 +1158,7 @@ foreign import ccall ic_enable_highlight  :: CCBool -> IO CCBool
 foreign import ccall ic_enable_history_duplicates :: CCBool -> IO CCBool
 foreign import ccall ic_enable_completion_preview :: CCBool -> IO CCBool
 foreign import ccall ic_enable_multiline_indent   :: CCBool -> IO CCBool
+foreign import ccall ic_enable_horizontal_scroll  :: CCBool -> IO CCBool
 foreign import ccall ic_enable_brace_matching     :: CCBool -> IO CCBool
 foreign import ccall ic_enable_brace_insertion    :: CCBool -> IO CCBool
 foreign import ccall ic_set_matching_braces       :: CString -> IO ()
@@ -996,6 +1287,14 @@ enableMultilineIndent :: Bool -> IO Bool
 enableMultilineIndent enable
   = do uncbool $ ic_enable_multiline_indent (cbool enable)
 
+-- | Disable or enable horizontal scrolling (disabled by default).
+-- Each input line is then shown on a single row that scrolls to keep
+-- the cursor visible, instead of wrapping over multiple rows.
+-- Returns the previous value.
+enableHorizontalScroll :: Bool -> IO Bool
+enableHorizontalScroll enable
+  = do uncbool $ ic_enable_horizontal_scroll (cbool enable)
+
 -- | Disable or enable automatic inline hinting (enabled by default)
 -- Returns the previous value.
 enableHint :: Bool -> IO Bool
@@ -1043,4 +1342,27 @@ withUTF8String :: String -> (CString -> IO a) -> IO a
 withUTF8String str action
   = do let bstr = TE.encodeUtf8 (T.pack str)
        B.useAsCString bstr action
+
+encodeUTF8 :: String -> B.ByteString
+encodeUTF8 s
+  = TE.encodeUtf8 (T.pack s)
+
+decodeUTF8 :: B.ByteString -> T.Text
+decodeUTF8 bstr
+  = TE.decodeUtf8With lenientDecode bstr
+
+-- copy a C string that is only valid during a callback
+peekBS0 :: CString -> IO B.ByteString
+peekBS0 cstr
+  = if (nullPtr == cstr) then return B.empty else B.packCString cstr
+
+-- take ownership of a string returned by Isocline without copying it
+peekBSMaybe :: CString -> IO (Maybe B.ByteString)
+peekBSMaybe cstr
+  = if (nullPtr == cstr) then return Nothing
+     else do len  <- c_strlen cstr
+             bstr <- BU.unsafePackCStringFinalizer (castPtr cstr) (fromIntegral len) (ic_free cstr)
+             return (Just bstr)
+
+foreign import ccall unsafe "string.h strlen" c_strlen :: CString -> IO CSize
        
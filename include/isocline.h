@@ -196,6 +196,15 @@ bool ic_add_completion_ex( ic_completion_env_t* cenv, const char* completion, co
 /// If `false` is returned, the callback should try to return and not add more completions (for improved latency).
 bool ic_add_completions(ic_completion_env_t* cenv, const char* prefix, const char** completions);
 
+/// In a completion callback, add a batch of completions with a single call (useful for bindings 
+/// from other languages). The `entries` buffer of `len` bytes contains a sequence of completions, each
+/// given by three 0-terminated strings: the replacement, the display, and the help (where 
+/// an empty display or help is the same as `NULL`). No filtering on a prefix is done.
+///
+/// Returns `true` if the callback should continue trying to find more possible completions.
+/// If `false` is returned, the callback should try to return and not add more completions (for improved latency).
+bool ic_add_completions_packed(ic_completion_env_t* cenv, const char* entries, long len);
+
 /// Complete a filename.
 /// Complete a filename given a semi-colon separated list of root directories `roots` and 
 /// semi-colon separated list of possible extensions (excluding directories). 
@@ -218,6 +227,41 @@ void ic_complete_filename( ic_completion_env_t* cenv, const char* prefix, char d
 /// @see ic_char_is_separator() etc.
 typedef bool (ic_is_char_class_fun_t)(const char* s, long len);
 
+/// Predefined character classes for ic_char_class_init().
+typedef enum ic_char_class_id_e {
+  IC_CHAR_CLASS_EMPTY,            ///< no characters
+  IC_CHAR_CLASS_WHITE,            ///< as ic_char_is_white()
+  IC_CHAR_CLASS_NONWHITE,         ///< as ic_char_is_nonwhite()
+  IC_CHAR_CLASS_SEPARATOR,        ///< as ic_char_is_separator()
+  IC_CHAR_CLASS_NONSEPARATOR,     ///< as ic_char_is_nonseparator() (the default word characters)
+  IC_CHAR_CLASS_LETTER,           ///< as ic_char_is_letter()
+  IC_CHAR_CLASS_DIGIT,            ///< as ic_char_is_digit()
+  IC_CHAR_CLASS_HEXDIGIT,         ///< as ic_char_is_hexdigit()
+  IC_CHAR_CLASS_IDLETTER,         ///< as ic_char_is_idletter()
+  IC_CHAR_CLASS_FILENAME_LETTER,  ///< as ic_char_is_filename_letter()
+  IC_CHAR_CLASS_COUNT
+} ic_char_class_id_t;
+
+/// Maximal number of unicode ranges in a character class.
+#define IC_CHAR_CLASS_MAX_RANGES  (16)
+
+/// A character class given by data instead of a function, so it is 
+/// evaluated natively with table lookups. This is much faster than a
+/// `ic_is_char_class_fun_t` callback when called from another language.
+/// An ASCII character is in the class if its bit is set in `ascii`. 
+/// A code point `>= 0x80` is in the class if `non_ascii` is non-zero, except if it is
+/// in one of the `ranges`; and vice versa, if `non_ascii` is zero, exactly the
+/// code points in the `ranges` are in the class.
+/// Use ic_char_class_init() to initialize, and ic_char_class_set_ascii() and
+/// ic_char_class_add_range() to customize. (Only uses `uint32_t` fields so the layout is
+/// the same on all platforms).
+typedef struct ic_char_class_s {
+  uint32_t ascii[4];                              ///< bitmap of the ASCII characters (0 to 127)
+  uint32_t non_ascii;                             ///< are code points `>= 0x80` in the class by default?
+  uint32_t range_count;                           ///< number of ranges
+  uint32_t ranges[2*IC_CHAR_CLASS_MAX_RANGES];    ///< pairs of inclusive code point ranges `[lo,hi]` (`lo >= 0x80`)
+} ic_char_class_t;
+
 
 /// Complete a _word_ (i.e. _token_). 
 /// Calls the user provided function `fun` to complete on the
@@ -262,6 +306,15 @@ void ic_complete_qword( ic_completion_env_t* cenv, const char* prefix, ic_comple
 void ic_complete_qword_ex( ic_completion_env_t* cenv, const char* prefix, ic_completer_fun_t fun, 
                                 ic_is_char_class_fun_t* is_word_char, char escape_char, const char* quote_chars );
 
+/// As ic_complete_word() but with a character class `word_chars` that is evaluated natively.
+/// If `word_chars` is NULL, the `IC_CHAR_CLASS_NONSEPARATOR` class is used.
+void ic_complete_word_class( ic_completion_env_t* cenv, const char* prefix, ic_completer_fun_t* fun, const ic_char_class_t* word_chars );
+
+/// As ic_complete_qword_ex() but with a character class `word_chars` that is evaluated natively.
+/// If `word_chars` is NULL, the `IC_CHAR_CLASS_NONSEPARATOR` class is used.
+void ic_complete_qword_ex_class( ic_completion_env_t* cenv, const char* prefix, ic_completer_fun_t* fun, 
+                                 const ic_char_class_t* word_chars, char escape_char, const char* quote_chars );
+
 /// \}
 
 //--------------------------------------------------------------
@@ -343,6 +396,14 @@ bool ic_enable_beep( bool enable );
 /// Returns the previous setting.
 bool ic_enable_color( bool enable );
 
+/// Cache the results of probing the terminal (like the actual ANSI colors) in a file
+/// (disabled by default). Entries are keyed by `TERM`, `TERM_PROGRAM`, `TERM_PROGRAM_VERSION`,
+/// and the tty; if a matching entry exists the terminal is not probed at all.
+/// If \a revalidate is true, the terminal is still probed once editing is idle and the
+/// cache is updated when the results changed. Use a \a NULL file name to disable the cache.
+/// Call this before any colored output as the terminal is probed at most once.
+void ic_set_term_cache( const char* fname, bool revalidate );
+
 /// Disable or enable duplicate entries in the history (disabled by default).
 /// Returns the previous setting.
 bool ic_enable_history_duplicates( bool enable );
@@ -361,6 +422,14 @@ bool ic_enable_completion_preview( bool enable );
 /// Returns the previous setting.
 bool ic_enable_multiline_indent(bool enable);
 
+/// Disable or enable horizontal scrolling (disabled by default).
+/// When enabled, each input line is shown on a single row that scrolls horizontally
+/// to keep the cursor visible, instead of wrapping over multiple rows. Markers
+/// indicate that a line continues beyond the left or right edge. This keeps
+/// the rendering cost independent of the input length for very long lines.
+/// Returns the previous setting.
+bool ic_enable_horizontal_scroll(bool enable);
+
 /// Disable or enable display of short help messages for history search etc.
 /// (full help is always dispayed when pressing F1 regardless of this setting)
 /// @returns the previous setting.
@@ -505,6 +574,31 @@ long ic_match_token(const char* s, long pos, ic_is_char_class_fun_t* is_token_ch
 /// while `ic_match_any_token("func x",0,&ic_char_is_letter,{"fun","func",NULL})` returns 4.
 long ic_match_any_token(const char* s, long pos, ic_is_char_class_fun_t* is_token_char, const char** tokens);
 
+
+/// Initialize a character class to one of the predefined classes.
+void ic_char_class_init( ic_char_class_t* cc, ic_char_class_id_t id );
+
+/// Add (if `in_class` is `true`) or remove the ASCII characters of `chars` to a character class.
+/// Any non-ASCII characters in `chars` are ignored (use ic_char_class_add_range() instead).
+void ic_char_class_set_ascii( ic_char_class_t* cc, const char* chars, bool in_class );
+
+/// Add an inclusive range of code points that are an exception to the default membership
+/// of non-ASCII characters (see `ic_char_class_t`). Only the part `>= 0x80` of the range is used.
+/// Returns `false` if there are already `IC_CHAR_CLASS_MAX_RANGES` ranges.
+bool ic_char_class_add_range( ic_char_class_t* cc, uint32_t lo, uint32_t hi );
+
+/// Is the (utf8) character `s` of length `len` in the character class? 
+bool ic_char_class_contains( const ic_char_class_t* cc, const char* s, long len );
+
+/// As ic_is_token() but with a character class that is evaluated natively.
+long ic_is_token_class(const char* s, long pos, const ic_char_class_t* token_chars);
+
+/// As ic_match_token() but with a character class that is evaluated natively.
+long ic_match_token_class(const char* s, long pos, const ic_char_class_t* token_chars, const char* token);
+
+/// As ic_match_any_token() but with a character class that is evaluated natively.
+long ic_match_any_token_class(const char* s, long pos, const ic_char_class_t* token_chars, const char** tokens);
+
 /// \}
 
 //--------------------------------------------------------------
@@ -594,6 +688,26 @@ int ic_term_get_color_bits( void );
 /// functional on Linux, macOS and Windows).
 bool ic_async_stop(void);
 
+/// Run expensive work on background worker threads so it does not block input.
+/// When enabled, the history file is loaded in the background, and the completer
+/// (for hints and tab completion) and the highlighter run on a worker thread; while
+/// such a task runs, the input is rendered with the previous highlighting and a
+/// key press cancels a pending completion (see `ic_stop_completing`).
+/// The completer and highlighter are never called concurrently with themselves,
+/// but they may run on another thread than the one calling `ic_readline`, so
+/// any state they share with the program must be synchronized. A custom
+/// allocator (see `ic_init_custom_alloc`) must be thread-safe as well.
+/// Call this before `ic_set_history` to load the history in the background.
+/// Default is disabled (all work is synchronous); it has no effect if
+/// isocline was built without thread support (`IC_THREADS`), or on Windows.
+/// Returns the previous setting.
+bool ic_enable_background(bool enable);
+
+/// Set the number of background worker threads (default 2, at most 16; use 0
+/// or less for the default). Takes effect immediately if background work is enabled.
+/// Returns the previous setting.
+long ic_set_background_threads(long threads);
+
 /// \}
 
 //--------------------------------------------------------------
@@ -620,6 +734,118 @@ const char* ic_strdup( const char* s );
 
 /// \}
 
+//--------------------------------------------------------------
+/// \defgroup stats Statistics
+/// Latency statistics of the line editor.
+/// Each keystroke is timed from the moment it arrives until the
+/// resulting frame is flushed to the terminal, and per phase
+/// in between. Timings are in micro seconds.
+/// \{
+
+/// Phases of handling a keystroke that are timed.
+typedef enum ic_stat_phase_e {
+  IC_STAT_WAIT,       ///< idle time waiting for a key
+  IC_STAT_DECODE,     ///< decoding the key (including escape sequences)
+  IC_STAT_EDIT,       ///< the edit operation (excluding the phases below)
+  IC_STAT_HIGHLIGHT,  ///< syntax highlighting
+  IC_STAT_BRACES,     ///< brace matching
+  IC_STAT_HINT,       ///< generating completions for a hint
+  IC_STAT_LAYOUT,     ///< computing the rows and cursor position
+  IC_STAT_RENDER,     ///< rendering the frame into the output buffer
+  IC_STAT_FLUSH,      ///< writing the output to the terminal
+  IC_STAT_KEY,        ///< total: from key arrival to the flushed frame
+  IC_STAT_COUNT
+} ic_stat_phase_t;
+
+/// Number of histogram buckets; bucket `i` counts the samples below `2^i` micro seconds
+/// (and the last bucket counts all larger samples).
+#define IC_STAT_BUCKETS  (24)
+
+/// Latency histogram of a phase.
+typedef struct ic_stat_hist_s {
+  uint64_t count;                       ///< number of samples
+  uint64_t total_us;                    ///< sum of all samples
+  uint64_t max_us;                      ///< largest sample
+  uint64_t buckets[IC_STAT_BUCKETS];    ///< log2 histogram
+} ic_stat_hist_t;
+
+/// Output written to the terminal.
+typedef struct ic_stat_output_s {
+  uint64_t bytes;         ///< bytes written
+  uint64_t writes;        ///< `write` system calls (or console writes on Windows)
+  uint64_t flushes;       ///< flushes of the output buffer
+  uint64_t esc_sgr;       ///< SGR escape sequences (colors and text attributes)
+  uint64_t esc_cursor;    ///< cursor movement escape sequences
+  uint64_t esc_erase;     ///< erase escape sequences (clear line or screen)
+  uint64_t esc_other;     ///< other escape sequences
+} ic_stat_output_t;
+
+/// Subsystems that memory allocations are accounted to.
+typedef enum ic_stat_mem_e {
+  IC_MEM_OTHER,         ///< settings and the terminal connection
+  IC_MEM_HISTORY,       ///< the history entries
+  IC_MEM_COMPLETIONS,   ///< the completion candidates
+  IC_MEM_RENDER,        ///< the edit buffers, highlighting, and the terminal output buffer
+  IC_MEM_UNDO,          ///< the undo and redo states
+  IC_MEM_BBCODE,        ///< the bbcode styles and formatting
+  IC_MEM_COUNT          ///< number of subsystems
+} ic_stat_mem_t;
+
+/// Memory allocations of a subsystem.
+typedef struct ic_stat_alloc_s {
+  uint64_t mallocs;       ///< calls to allocate 
+  uint64_t reallocs;      ///< calls to reallocate
+  uint64_t frees;         ///< calls to free
+  uint64_t bytes;         ///< total bytes requested (by allocation and reallocation)
+  uint64_t live_bytes;    ///< bytes currently allocated
+  uint64_t peak_bytes;    ///< largest `live_bytes` 
+} ic_stat_alloc_t;
+
+/// Statistics of the line editor.
+typedef struct ic_stats_s {
+  uint64_t       keys;                  ///< keystrokes handled
+  uint64_t       frames;                ///< frames rendered
+  uint64_t       frames_degraded;       ///< frames rendered at reduced quality (to stay within the frame budget)
+  ic_stat_hist_t phases[IC_STAT_COUNT]; ///< latency per phase
+  ic_stat_output_t output;              ///< total output of the session
+  ic_stat_output_t frame;               ///< output of the last rendered frame
+  uint64_t       frame_bytes_max;       ///< largest output of a single frame in bytes
+  ic_stat_alloc_t memory[IC_MEM_COUNT]; ///< memory allocations per subsystem
+  uint64_t       memory_peak;           ///< largest total of bytes allocated at any time
+} ic_stats_t;
+
+/// Get a copy of the current statistics.
+void ic_get_stats( ic_stats_t* stats );
+
+/// Reset all statistics to zero 
+/// (except for the bytes currently allocated which become the new peak).
+void ic_reset_stats( void );
+
+/// Estimate the latency at percentile \a p (between 0.0 and 1.0) of a histogram, 
+/// e.g. `ic_stat_percentile(&stats.phases[IC_STAT_KEY], 0.99)` for the p99 keystroke latency.
+/// Returns the upper bound in micro seconds of the bucket that contains the percentile 
+/// (at most the maximal sample), or 0 if there are no samples.
+uint64_t ic_stat_percentile( const ic_stat_hist_t* hist, double p );
+
+/// Show the output counters of the previous frame and the keystroke latency live, below 
+/// the input while editing (disabled by default). This is meant for debugging only.
+/// This is also enabled by setting the environment variable `ISOCLINE_STATS=2`.
+/// Returns the previous setting.
+bool ic_enable_stats_overlay( bool enable );
+
+/// Print a summary of the statistics to `stderr` when the program exits (disabled by default).
+/// This is also enabled by setting the environment variable `ISOCLINE_STATS=1`.
+/// Returns the previous setting.
+bool ic_enable_stats_dump( bool enable );
+
+/// Write out the buffered debug messages and trace events (to `stderr`).
+/// Tracing is enabled by setting the environment variable `ISOCLINE_DEBUG=1`; events 
+/// are recorded in an in-memory ring buffer that is otherwise written out when the 
+/// editor waits for input, and at exit.
+void ic_trace_flush( void );
+
+/// \}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,368 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+-----------------------------------------------------------------------------*/
+#pragma once
+#ifndef IC_ISOCLINE_HPP
+#define IC_ISOCLINE_HPP
+
+/*! \file isocline.hpp
+Header-only C++17 interface to isocline.
+
+Completers and highlighters are any callables (usually lambdas) that
+receive the input as a `std::string_view`:
+```
+ic::session s{ [](ic::completions& out, std::string_view prefix) {
+                  out.complete_word(prefix, [](ic::completions& out, std::string_view word) {
+                    for (const char* kw : {"print", "println", "prompt"}) {
+                      if (std::string_view(kw).substr(0, word.size()) == word) { out.add(kw); }
+                    }
+                  });
+                },
+               [](ic::highlighter& hl, std::string_view input) {
+                  if (input.substr(0,5) == "print") { hl.style(0, 5, "keyword"); }
+                } };
+while (ic::line input = s.readline("prompt")) {
+  printf("you wrote: %s\n", input.c_str());
+}
+```
+Each callable is called from a function that is instantiated for its type
+and passed as the C function pointer, so there is no further indirection
+(like `std::function`) per call. Strings passed to isocline are copied into
+a stack buffer to terminate them with a 0, and only allocate if they are longer
+than 255 bytes. Callbacks should not throw exceptions.
+*/
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include "isocline.h"
+
+namespace ic {
+
+namespace detail {
+
+  // A 0-terminated copy of a string view that only allocates for long strings.
+  class cstring {
+  public:
+    explicit cstring(std::string_view s) { copy(s); }
+
+    // use `z` directly if `s` is a view of the whole 0-terminated string `z` of length `zlen`.
+    cstring(std::string_view s, const char* z, size_t zlen) {
+      if (z != nullptr && s.data() == z && s.size() == zlen) { ptr_ = z; }
+      else { copy(s); }
+    }
+    cstring(const cstring&) = delete;
+    cstring& operator=(const cstring&) = delete;
+
+    const char* c_str() const noexcept { return ptr_; }
+    const char* c_str_or_null() const noexcept { return (ptr_[0] == 0 ? nullptr : ptr_); }
+
+  private:
+    void copy(std::string_view s) {
+      if (s.size() < sizeof(small_)) {
+        if (!s.empty()) { std::memcpy(small_, s.data(), s.size()); }
+        small_[s.size()] = 0;
+        ptr_ = small_;
+      }
+      else {
+        large_.assign(s.data(), s.size());
+        ptr_ = large_.c_str();
+      }
+    }
+
+    char        small_[256];
+    std::string large_;
+    const char* ptr_ = nullptr;
+  };
+
+  template<class F>
+  inline constexpr bool is_null_v = std::is_null_pointer_v<std::decay_t<F>>;
+
+  template<class F> void completer_fun( ic_completion_env_t* cenv, const char* prefix ) noexcept;
+  template<class F> void highlighter_fun( ic_highlight_env_t* henv, const char* input, void* arg ) noexcept;
+
+  // Word completers have no argument pointer: the current one is passed in a thread local.
+  template<class F>
+  struct word_completer {
+    static inline thread_local F* current = nullptr;
+    static void fun( ic_completion_env_t* cenv, const char* prefix ) noexcept;
+  };
+
+}  // namespace detail
+
+
+//--------------------------------------------------------------
+// Completion
+//--------------------------------------------------------------
+
+/// The completion sink passed to a completer.
+class completions {
+public:
+  completions( ic_completion_env_t* cenv, const char* prefix ) noexcept
+    : cenv_(cenv), prefix_(prefix), prefix_len_(prefix == nullptr ? 0 : std::strlen(prefix)) {}
+
+  /// The underlying C completion environment.
+  ic_completion_env_t* get() const noexcept { return cenv_; }
+
+  /// Add a completion with an optional `display` and `help` (empty for the default).
+  /// Returns `false` if no more completions should be added (see ic_add_completion_ex()).
+  bool add( std::string_view replacement, std::string_view display = {}, std::string_view help = {} ) {
+    detail::cstring crepl(replacement);
+    detail::cstring cdisplay(display);
+    detail::cstring chelp(help);
+    return ic_add_completion_ex(cenv_, crepl.c_str(), cdisplay.c_str_or_null(), chelp.c_str_or_null());
+  }
+
+  /// Add a primitive completion (see ic_add_completion_prim()).
+  bool add_prim( std::string_view replacement, std::string_view display, std::string_view help,
+                 long delete_before, long delete_after ) {
+    detail::cstring crepl(replacement);
+    detail::cstring cdisplay(display);
+    detail::cstring chelp(help);
+    return ic_add_completion_prim(cenv_, crepl.c_str(), cdisplay.c_str_or_null(), chelp.c_str_or_null(),
+                                  delete_before, delete_after);
+  }
+
+  /// Add all `candidates` (convertible to `std::string_view`) that start with `prefix`.
+  /// Returns `false` if no more completions should be added.
+  template<class Range>
+  bool add_all( std::string_view prefix, const Range& candidates ) {
+    for (const auto& candidate : candidates) {
+      const std::string_view c(candidate);
+      if (c.substr(0, prefix.size()) == prefix && !add(c)) return false;
+    }
+    return true;
+  }
+
+  /// Should the completer stop adding completions? (for improved latency)
+  bool stop() const noexcept { return ic_stop_completing(cenv_); }
+
+  /// Are there any completions already?
+  bool has_completions() const noexcept { return ic_has_completions(cenv_); }
+
+  /// Complete the word before the cursor: `f(completions&, std::string_view word)` is called
+  /// with just the current word. The `word_chars` are the word characters
+  /// (`IC_CHAR_CLASS_NONSEPARATOR` if `nullptr`). See ic_complete_word_class().
+  template<class F>
+  void complete_word( std::string_view prefix, F&& f, const ic_char_class_t* word_chars = nullptr ) {
+    using G = std::remove_reference_t<F>;
+    detail::cstring cprefix(prefix, prefix_, prefix_len_);
+    G* prev = detail::word_completer<G>::current;
+    detail::word_completer<G>::current = &f;
+    ic_complete_word_class(cenv_, cprefix.c_str(), &detail::word_completer<G>::fun, word_chars);
+    detail::word_completer<G>::current = prev;
+  }
+
+  /// Complete a quoted word before the cursor (see ic_complete_qword_ex_class()).
+  template<class F>
+  void complete_qword( std::string_view prefix, F&& f, const ic_char_class_t* word_chars = nullptr,
+                       char escape_char = '\\', const char* quote_chars = nullptr ) {
+    using G = std::remove_reference_t<F>;
+    detail::cstring cprefix(prefix, prefix_, prefix_len_);
+    G* prev = detail::word_completer<G>::current;
+    detail::word_completer<G>::current = &f;
+    ic_complete_qword_ex_class(cenv_, cprefix.c_str(), &detail::word_completer<G>::fun, word_chars, escape_char, quote_chars);
+    detail::word_completer<G>::current = prev;
+  }
+
+  /// Complete a file name (see ic_complete_filename()).
+  void complete_filename( std::string_view prefix, char dir_separator = 0,
+                          const char* roots = nullptr, const char* extensions = nullptr ) {
+    detail::cstring cprefix(prefix, prefix_, prefix_len_);
+    ic_complete_filename(cenv_, cprefix.c_str(), dir_separator, roots, extensions);
+  }
+
+private:
+  ic_completion_env_t* cenv_;
+  const char*          prefix_;
+  size_t               prefix_len_;
+};
+
+
+//--------------------------------------------------------------
+// Highlighting
+//--------------------------------------------------------------
+
+/// The highlight environment passed to a highlighter.
+class highlighter {
+public:
+  highlighter( ic_highlight_env_t* henv, const char* input ) noexcept : henv_(henv), input_(input) {}
+
+  /// The underlying C highlight environment.
+  ic_highlight_env_t* get() const noexcept { return henv_; }
+
+  /// Set the style of `count` bytes starting at `pos` (see ic_highlight()).
+  void style( long pos, long count, const char* style ) noexcept {
+    ic_highlight(henv_, pos, count, style);
+  }
+  void style( long pos, long count, std::string_view style ) {
+    detail::cstring cstyle(style);
+    ic_highlight(henv_, pos, count, cstyle.c_str());
+  }
+
+  /// Highlight the input with a bbcode `formatted` version of it (see ic_highlight_formatted()).
+  void formatted( std::string_view formatted ) {
+    detail::cstring cformatted(formatted);
+    ic_highlight_formatted(henv_, input_, cformatted.c_str());
+  }
+
+private:
+  ic_highlight_env_t* henv_;
+  const char*         input_;
+};
+
+
+//--------------------------------------------------------------
+// Readline
+//--------------------------------------------------------------
+
+/// A line of input returned by readline that is owned (and freed with ic_free()).
+/// It is empty (and `false`) on end-of-file or an error (ctrl+d/ctrl+c).
+class line {
+public:
+  line() noexcept = default;
+  explicit line( char* s ) noexcept : s_(s) {}
+  line( line&& other ) noexcept : s_(other.release()) {}
+  line& operator=( line&& other ) noexcept {
+    if (this != &other) { reset(other.release()); }
+    return *this;
+  }
+  line( const line& ) = delete;
+  line& operator=( const line& ) = delete;
+  ~line() { reset(nullptr); }
+
+  explicit operator bool() const noexcept { return (s_ != nullptr); }
+  std::string_view view() const noexcept { return (s_ == nullptr ? std::string_view() : std::string_view(s_)); }
+  const char* c_str() const noexcept { return (s_ == nullptr ? "" : s_); }
+  std::string str() const { return std::string(view()); }
+
+  /// Release ownership (free the result with ic_free()).
+  char* release() noexcept { char* s = s_; s_ = nullptr; return s; }
+
+private:
+  void reset( char* s ) noexcept {
+    if (s_ != nullptr) { ic_free(s_); }
+    s_ = s;
+  }
+  char* s_ = nullptr;
+};
+
+/// Read input from the user (see ic_readline()).
+inline line readline( std::string_view prompt ) {
+  detail::cstring cprompt(prompt);
+  return line(ic_readline(cprompt.c_str()));
+}
+
+/// Read input with a completer `completer(completions&, std::string_view prefix)` and
+/// a highlighter `highlighter(highlighter&, std::string_view input)` for this call only.
+/// Either can be `nullptr` to use the default (see ic_readline_ex()).
+template<class Completer, class Highlighter = std::nullptr_t>
+line readline( std::string_view prompt, Completer&& completer, Highlighter&& highlighter = nullptr ) {
+  detail::cstring cprompt(prompt);
+  ic_completer_fun_t* cfun = nullptr;
+  void* carg = nullptr;
+  if constexpr (!detail::is_null_v<Completer>) {
+    cfun = &detail::completer_fun<std::remove_reference_t<Completer>>;
+    carg = const_cast<void*>(static_cast<const void*>(&completer));
+  }
+  ic_highlight_fun_t* hfun = nullptr;
+  void* harg = nullptr;
+  if constexpr (!detail::is_null_v<Highlighter>) {
+    hfun = &detail::highlighter_fun<std::remove_reference_t<Highlighter>>;
+    harg = const_cast<void*>(static_cast<const void*>(&highlighter));
+  }
+  return line(ic_readline_ex(cprompt.c_str(), cfun, carg, hfun, harg));
+}
+
+
+//--------------------------------------------------------------
+// Sessions
+//--------------------------------------------------------------
+
+/// A session owns a completer and highlighter (or `nullptr` for the default)
+/// that are used for each of its `readline` calls. The global defaults are not changed.
+/// A session can not be copied or moved as isocline refers to its callables while reading.
+template<class Completer = std::nullptr_t, class Highlighter = std::nullptr_t>
+class session {
+public:
+  explicit session( Completer completer = nullptr, Highlighter highlighter = nullptr )
+    : completer_(std::move(completer)), highlighter_(std::move(highlighter)) {}
+  session( const session& ) = delete;
+  session& operator=( const session& ) = delete;
+
+  /// Read input from the user with the completer and highlighter of this session.
+  line readline( std::string_view prompt ) {
+    return ic::readline(prompt, completer_, highlighter_);
+  }
+
+  Completer&   completer() noexcept   { return completer_; }
+  Highlighter& highlighter() noexcept { return highlighter_; }
+
+private:
+  Completer   completer_;
+  Highlighter highlighter_;
+};
+
+template<class Completer>
+session( Completer ) -> session<Completer, std::nullptr_t>;
+
+template<class Completer, class Highlighter>
+session( Completer, Highlighter ) -> session<Completer, Highlighter>;
+
+
+/// Open a global style for the lifetime of this object (see ic_style_open()).
+class style {
+public:
+  explicit style( const char* fmt ) { ic_style_open(fmt); }
+  style( const style& ) = delete;
+  style& operator=( const style& ) = delete;
+  ~style() { ic_style_close(); }
+};
+
+/// Initialize the terminal for the `ic_term_xxx` functions for the lifetime
+/// of this object (see ic_term_init()).
+class terminal {
+public:
+  terminal() { ic_term_init(); }
+  terminal( const terminal& ) = delete;
+  terminal& operator=( const terminal& ) = delete;
+  ~terminal() { ic_term_done(); }
+};
+
+
+//--------------------------------------------------------------
+// Callback dispatch
+//--------------------------------------------------------------
+
+namespace detail {
+
+  template<class F>
+  void completer_fun( ic_completion_env_t* cenv, const char* prefix ) noexcept {
+    F& f = *static_cast<F*>(ic_completion_arg(cenv));
+    completions out(cenv, prefix);
+    f(out, std::string_view(prefix));
+  }
+
+  template<class F>
+  void highlighter_fun( ic_highlight_env_t* henv, const char* input, void* arg ) noexcept {
+    F& f = *static_cast<F*>(arg);
+    highlighter hl(henv, input);
+    f(hl, std::string_view(input));
+  }
+
+  template<class F>
+  void word_completer<F>::fun( ic_completion_env_t* cenv, const char* prefix ) noexcept {
+    completions out(cenv, prefix);
+    (*current)(out, std::string_view(prefix));
+  }
+
+}  // namespace detail
+
+}  // namespace ic
+
+#endif // IC_ISOCLINE_HPP
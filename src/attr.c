@@ -220,6 +220,17 @@ ic_private ssize_t attrbuf_len( attrbuf_t* ab ) {
   return (ab==NULL ? 0 : ab->count);
 }
 
+// Set the length; only attributes beyond the current length are initialized (to `attr_none`).
+ic_private void attrbuf_resize( attrbuf_t* ab, ssize_t len ) {
+  if (ab == NULL || len < 0) return;
+  if (len <= ab->count) { ab->count = len; return; }
+  if (!attrbuf_ensure_capacity(ab,len)) return;
+  for(ssize_t i = ab->count; i < len; i++) {
+    ab->attrs[i] = attr_none();
+  }
+  ab->count = len;
+}
+
 ic_private const attr_t* attrbuf_attrs( attrbuf_t* ab, ssize_t expected_len ) {
   assert(expected_len <= ab->count );
   // expand if needed
@@ -261,13 +272,21 @@ ic_private void attrbuf_update_at( attrbuf_t* ab, ssize_t pos, ssize_t count, at
 }
 
 ic_private void attrbuf_insert_at( attrbuf_t* ab, ssize_t pos, ssize_t count, attr_t attr ) {
-  if (pos < 0 || pos > ab->count || count <= 0) return;
+  if (ab==NULL || pos < 0 || pos > ab->count || count <= 0) return;
   if (!attrbuf_ensure_extra(ab,count)) return;  
   ic_memmove( ab->attrs + pos + count, ab->attrs + pos, (ab->count - pos)*ssizeof(attr_t) );
   ab->count += count;
   attrbuf_set_at( ab, pos, count, attr );
 }
 
+ic_private void attrbuf_copy_from( attrbuf_t* ab, attrbuf_t* from, ssize_t count ) {
+  if (ab==NULL || from==NULL || count <= 0) return;
+  if (count > from->count) { count = from->count; }
+  if (!attrbuf_ensure_capacity(ab, count)) return;
+  ic_memcpy( ab->attrs, from->attrs, count*ssizeof(attr_t) );
+  if (ab->count < count) { ab->count = count; }
+}
+
 
 // note: must allow ab == NULL!
 ic_private ssize_t attrbuf_append_n( stringbuf_t* sb, attrbuf_t* ab, const char* s, ssize_t len, attr_t attr ) {
@@ -289,6 +308,6 @@ ic_private void attrbuf_delete_at( attrbuf_t* ab, ssize_t pos, ssize_t count ) {
   if (pos + count > ab->count) { count = ab->count - pos; }
   if (count == 0) return;
   assert(pos + count <= ab->count);
-  ic_memmove( ab->attrs + pos, ab->attrs + pos + count, ab->count - (pos + count) );
+  ic_memmove( ab->attrs + pos, ab->attrs + pos + count, (ab->count - (pos + count))*ssizeof(attr_t) );
   ab->count -= count;
 }
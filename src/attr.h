@@ -57,12 +57,14 @@ ic_private attrbuf_t*     attrbuf_new( alloc_t* mem );
 ic_private void           attrbuf_free( attrbuf_t* ab );  // ab can be NULL
 ic_private void           attrbuf_clear( attrbuf_t* ab ); // ab can be NULL
 ic_private ssize_t        attrbuf_len( attrbuf_t* ab);    // ab can be NULL
+ic_private void           attrbuf_resize( attrbuf_t* ab, ssize_t len ); // new attributes are `attr_none`
 ic_private const attr_t*  attrbuf_attrs( attrbuf_t* ab, ssize_t expected_len );
 ic_private ssize_t        attrbuf_append_n( stringbuf_t* sb, attrbuf_t* ab, const char* s, ssize_t len, attr_t attr );
 
 ic_private void           attrbuf_set_at( attrbuf_t* ab, ssize_t pos, ssize_t count, attr_t attr );
 ic_private void           attrbuf_update_at( attrbuf_t* ab, ssize_t pos, ssize_t count, attr_t attr );
 ic_private void           attrbuf_insert_at( attrbuf_t* ab, ssize_t pos, ssize_t count, attr_t attr );
+ic_private void           attrbuf_copy_from( attrbuf_t* ab, attrbuf_t* from, ssize_t count );  // set the first `count` attributes
 
 ic_private attr_t         attrbuf_attr_at( attrbuf_t* ab, ssize_t pos );   
 ic_private void           attrbuf_delete_at( attrbuf_t* ab, ssize_t pos, ssize_t count );
@@ -67,6 +67,7 @@ struct bbcode_s {
   stringbuf_t*  out;              // print buffer
   attrbuf_t*    out_attrs;
   stringbuf_t*  vout;             // vprintf buffer 
+  bool          shared_styles;    // are the styles owned by another bbcode? (see `bbcode_new_view`)
 };
 
 
@@ -85,12 +86,30 @@ ic_private bbcode_t* bbcode_new( alloc_t* mem, term_t* term ) {
   return bb;
 }
 
+// A bbcode parser with its own tag stack that shares the styles of `bb`;
+// used to format on a worker thread (see `highlight_task_submit`).
+// It cannot print, and the styles of `bb` must not change while it is in use.
+ic_private bbcode_t* bbcode_new_view( alloc_t* mem, const bbcode_t* bb ) {
+  bbcode_t* view = mem_zalloc_tp(mem,bbcode_t);
+  if (view==NULL) return NULL;
+  view->mem = mem;
+  view->term = bb->term;
+  view->styles = bb->styles;
+  view->styles_count = bb->styles_count;
+  view->styles_capacity = bb->styles_count;
+  view->shared_styles = true;
+  return view;
+}
+
 ic_private void bbcode_free( bbcode_t* bb ) {
-  for(ssize_t i = 0; i < bb->styles_count; i++) {
-    mem_free(bb->mem, bb->styles[i].name);
+  if (bb == NULL) return;
+  if (!bb->shared_styles) {
+    for(ssize_t i = 0; i < bb->styles_count; i++) {
+      mem_free(bb->mem, bb->styles[i].name);
+    }
+    mem_free(bb->mem, bb->styles);
   }
   mem_free(bb->mem, bb->tags);
-  mem_free(bb->mem, bb->styles);
   sbuf_free(bb->vout);
   sbuf_free(bb->out);
   attrbuf_free(bb->out_attrs);
@@ -98,6 +117,8 @@ ic_private void bbcode_free( bbcode_t* bb ) {
 }
 
 ic_private void bbcode_style_add( bbcode_t* bb, const char* style_name, attr_t attr ) {
+  assert(!bb->shared_styles);
+  if (bb->shared_styles) return;
   if (bb->styles_count >= bb->styles_capacity) {
     ssize_t newlen = bb->styles_capacity + 32;
     style_t* p = mem_realloc_tp( bb->mem, style_t, bb->styles, newlen );
@@ -404,6 +425,33 @@ static const style_t builtin_styles[] = {
   { NULL, { { IC_COLOR_NONE, IC_NONE, IC_NONE, IC_COLOR_NONE, IC_NONE, IC_NONE } } }
 };
 
+// Default styles used by isocline; precompiled so we do not parse them at startup.
+// These can be redefined by the user (as user defined styles are checked first).
+static const style_t default_styles[] = {
+  { "ic-prompt",     { { IC_ANSI_GREEN,      IC_NONE, IC_NONE, IC_COLOR_NONE, IC_NONE, IC_NONE } } },
+  { "ic-info",       { { IC_ANSI_DARKGRAY,   IC_NONE, IC_NONE, IC_COLOR_NONE, IC_NONE, IC_NONE } } },
+  { "ic-diminish",   { { IC_ANSI_LIGHTGRAY,  IC_NONE, IC_NONE, IC_COLOR_NONE, IC_NONE, IC_NONE } } },
+  { "ic-emphasis",   { { IC_RGB(0xffffd7),   IC_NONE, IC_NONE, IC_COLOR_NONE, IC_NONE, IC_NONE } } },
+  { "ic-hint",       { { IC_ANSI_DARKGRAY,   IC_NONE, IC_NONE, IC_COLOR_NONE, IC_NONE, IC_NONE } } },
+  { "ic-error",      { { IC_RGB(0xd70000),   IC_NONE, IC_NONE, IC_COLOR_NONE, IC_NONE, IC_NONE } } },
+  { "ic-bracematch", { { IC_ANSI_WHITE,      IC_NONE, IC_NONE, IC_COLOR_NONE, IC_NONE, IC_NONE } } }, // or #F7DC6F
+  { "keyword",       { { IC_RGB(0x569cd6),   IC_NONE, IC_NONE, IC_COLOR_NONE, IC_NONE, IC_NONE } } },
+  { "control",       { { IC_RGB(0xc586c0),   IC_NONE, IC_NONE, IC_COLOR_NONE, IC_NONE, IC_NONE } } },
+  { "number",        { { IC_RGB(0xb5cea8),   IC_NONE, IC_NONE, IC_COLOR_NONE, IC_NONE, IC_NONE } } },
+  { "string",        { { IC_RGB(0xce9178),   IC_NONE, IC_NONE, IC_COLOR_NONE, IC_NONE, IC_NONE } } },
+  { "comment",       { { IC_RGB(0x6a9955),   IC_NONE, IC_NONE, IC_COLOR_NONE, IC_NONE, IC_NONE } } },
+  { "type",          { { IC_RGB(0x008b8b),   IC_NONE, IC_NONE, IC_COLOR_NONE, IC_NONE, IC_NONE } } }, // darkcyan
+  { "constant",      { { IC_RGB(0x569cd6),   IC_NONE, IC_NONE, IC_COLOR_NONE, IC_NONE, IC_NONE } } },
+  { NULL,            { { IC_COLOR_NONE,      IC_NONE, IC_NONE, IC_COLOR_NONE, IC_NONE, IC_NONE } } }
+};
+
+static const style_t* styles_find( const style_t* styles, const char* name ) {
+  for( const style_t* style = styles; style->name != NULL; style++) {
+    if (strcmp(style->name,name) == 0) return style;
+  }
+  return NULL;
+}
+
 static void attr_update_with_styles( tag_t* tag, const char* attr_name, const char* value, 
                                              bool usebgcolor, const style_t* styles, ssize_t count ) 
 {
@@ -427,13 +475,13 @@ static void attr_update_with_styles( tag_t* tag, const char* attr_name, const ch
       return;
     }    
   }
-  // check builtin styles; todo: binary search?
-  for( const style_t* style = builtin_styles; style->name != NULL; style++) {
-    if (strcmp(style->name,attr_name) == 0) {
-      tag->attr = attr_update_with(tag->attr,style->attr);
-      if (tag->name != NULL) tag->name = style->name;
-      return;
-    }
+  // check default and builtin styles; todo: binary search?
+  const style_t* style = styles_find(default_styles, attr_name);
+  if (style == NULL) { style = styles_find(builtin_styles, attr_name); }
+  if (style != NULL) {
+    tag->attr = attr_update_with(tag->attr,style->attr);
+    if (tag->name != NULL) tag->name = style->name;
+    return;
   }
   // check colors as a style
   ssize_t lo = 0;
@@ -805,8 +853,28 @@ ic_private void bbcode_append( bbcode_t* bb, const char* s, stringbuf_t* out, at
 ic_private void bbcode_print( bbcode_t* bb, const char* s ) {
   if (bb->out == NULL || bb->out_attrs == NULL || s == NULL) return;
   assert(sbuf_len(bb->out) == 0 && attrbuf_len(bb->out_attrs) == 0);
+  if (term_is_nocolor(bb->term)) {
+    // no colors (or not a terminal): skip building attributes and write the plain text
+    bbcode_append( bb, s, bb->out, NULL );
+    if (term_get_buffer_mode(bb->term) != BUFFERED) {
+      term_write_borrow_n( bb->term, sbuf_string(bb->out), sbuf_len(bb->out) );
+    }
+    else {
+      term_write_n( bb->term, sbuf_string(bb->out), sbuf_len(bb->out) );
+    }
+    sbuf_clear(bb->out);
+    return;
+  }
   bbcode_append( bb, s, bb->out, bb->out_attrs );
-  term_write_formatted( bb->term, sbuf_string(bb->out), attrbuf_attrs(bb->out_attrs,sbuf_len(bb->out)) );
+  // outside a buffered frame the output is written before we clear it, so we can borrow it
+  const char* out = sbuf_string(bb->out);
+  const attr_t* attrs = attrbuf_attrs(bb->out_attrs,sbuf_len(bb->out));
+  if (term_get_buffer_mode(bb->term) != BUFFERED) {
+    term_write_formatted_borrow_n( bb->term, out, attrs, sbuf_len(bb->out) );
+  }
+  else {
+    term_write_formatted( bb->term, out, attrs );
+  }
   attrbuf_clear(bb->out_attrs);
   sbuf_clear(bb->out);
 }
@@ -16,6 +16,7 @@ struct bbcode_s;
 typedef struct bbcode_s bbcode_t;
 
 ic_private bbcode_t* bbcode_new( alloc_t* mem, term_t* term );
+ic_private bbcode_t* bbcode_new_view( alloc_t* mem, const bbcode_t* bb );  // shares the styles of `bb` (read-only)
 ic_private void bbcode_free( bbcode_t* bb );
 
 ic_private void bbcode_style_add( bbcode_t* bb, const char* style_name, attr_t attr );
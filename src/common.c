@@ -5,12 +5,21 @@
   found in the "LICENSE" file at the root of this distribution.
 -----------------------------------------------------------------------------*/
 
+#if !defined(_XOPEN_SOURCE)
+#define  _XOPEN_SOURCE  700    // so clock_gettime is visible
+#endif
 #include <string.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include "common.h"
 
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
 
 //-------------------------------------------------------------
 // String wrappers for ssize_t
@@ -257,46 +266,23 @@ fail:
 
 
 //-------------------------------------------------------------
-// Debug
+// Time
 //-------------------------------------------------------------
 
-#if defined(IC_NO_DEBUG_MSG) 
-// nothing
-#elif !defined(IC_DEBUG_TO_FILE)
-ic_private void debug_msg(const char* fmt, ...) {
-  if (getenv("ISOCLINE_DEBUG")) {
-    va_list args;
-    va_start(args, fmt);
-    vfprintf(stderr, fmt, args);
-    va_end(args);
-  }
+#if defined(_WIN32)
+ic_private int64_t ic_time_us(void) {
+  static LARGE_INTEGER freq;
+  if (freq.QuadPart == 0) { QueryPerformanceFrequency(&freq); }
+  LARGE_INTEGER t;
+  QueryPerformanceCounter(&t);
+  // split to avoid overflow
+  return ((t.QuadPart / freq.QuadPart) * 1000000) + (((t.QuadPart % freq.QuadPart) * 1000000) / freq.QuadPart);
 }
 #else
-ic_private void debug_msg(const char* fmt, ...) {
-  static int debug_init;
-  static const char* debug_fname = "isocline.debug.txt";
-  // initialize?
-  if (debug_init==0) {
-    debug_init = -1;
-    const char* rdebug = getenv("ISOCLINE_DEBUG");
-    if (rdebug!=NULL && strcmp(rdebug,"1") == 0) {
-      FILE* fdbg = fopen(debug_fname, "w");
-      if (fdbg!=NULL) {
-        debug_init = 1;
-        fclose(fdbg);
-      }
-    }
-  }
-  if (debug_init <= 0) return;
-
-  // write debug messages
-  FILE* fdbg = fopen(debug_fname, "a");
-  if (fdbg==NULL) return;
-  va_list args;
-  va_start(args, fmt);
-  vfprintf(fdbg, fmt, args);
-  fclose(fdbg);
-  va_end(args);
+ic_private int64_t ic_time_us(void) {
+  struct timespec t;
+  if (clock_gettime(CLOCK_MONOTONIC, &t) != 0) return 0;
+  return ((int64_t)t.tv_sec * 1000000) + ((int64_t)t.tv_nsec / 1000);
 }
 #endif
 
@@ -305,8 +291,93 @@ ic_private void debug_msg(const char* fmt, ...) {
 // Allocation
 //-------------------------------------------------------------
 
+// Each block is preceded by a header with its size and subsystem so
+// frees and reallocations can be accounted without any lookup.
+// (two words keep the alignment of the underlying allocator)
+typedef struct mem_header_s {
+  size_t size;
+  size_t tag;
+} mem_header_t;
+
+typedef struct mem_stats_s {
+  ic_stat_alloc_t tags[IC_MEM_COUNT];
+  uint64_t        live;   // total live bytes
+  uint64_t        peak;
+} mem_stats_t;
+
+// the allocators for each subsystem and their statistics are allocated at once
+typedef struct mem_block_s {
+  alloc_t      tagged[IC_MEM_COUNT];
+  mem_stats_t  stats;
+} mem_block_t;
+
+ic_private alloc_t* mem_new( ic_malloc_fun_t* _malloc, ic_realloc_fun_t* _realloc, ic_free_fun_t* _free ) {
+  mem_block_t* block = (mem_block_t*)_malloc(sizeof(mem_block_t));
+  if (block == NULL) return NULL;
+  memset(block, 0, sizeof(mem_block_t));
+  for (ssize_t i = 0; i < IC_MEM_COUNT; i++) {
+    alloc_t* mem = &block->tagged[i];
+    mem->malloc  = _malloc;
+    mem->realloc = _realloc;
+    mem->free    = _free;
+    mem->tag     = (ic_stat_mem_t)i;
+    mem->tagged  = block->tagged;
+    mem->stats   = &block->stats;
+  }
+  return &block->tagged[IC_MEM_OTHER];
+}
+
+ic_private void mem_delete( alloc_t* mem ) {
+  if (mem == NULL) return;
+  mem->free(mem->tagged);  // the start of the block
+}
+
+ic_private alloc_t* mem_tagged( alloc_t* mem, ic_stat_mem_t tag ) {
+  if (mem == NULL || mem->tagged == NULL || (unsigned)tag >= IC_MEM_COUNT) return mem;
+  return &mem->tagged[tag];
+}
+
+ic_private void mem_get_stats( const alloc_t* mem, ic_stats_t* stats ) {
+  for (ssize_t i = 0; i < IC_MEM_COUNT; i++) {
+    stats->memory[i] = mem->stats->tags[i];
+  }
+  stats->memory_peak = mem->stats->peak;
+}
+
+ic_private void mem_reset_stats( alloc_t* mem ) {
+  for (ssize_t i = 0; i < IC_MEM_COUNT; i++) {
+    ic_stat_alloc_t* st = &mem->stats->tags[i];
+    const uint64_t live = st->live_bytes;
+    memset(st, 0, sizeof(*st));
+    st->live_bytes = st->peak_bytes = live;
+  }
+  mem->stats->peak = mem->stats->live;
+}
+
+static void mem_account_alloc( mem_stats_t* stats, size_t tag, size_t size ) {
+  ic_stat_alloc_t* st = &stats->tags[tag];
+  st->bytes += size;
+  st->live_bytes += size;
+  if (st->live_bytes > st->peak_bytes) { st->peak_bytes = st->live_bytes; }
+  stats->live += size;
+  if (stats->live > stats->peak) { stats->peak = stats->live; }
+}
+
+static void mem_account_free( mem_stats_t* stats, size_t tag, size_t size ) {
+  stats->tags[tag].live_bytes -= size;
+  stats->live -= size;
+}
+
 ic_private void* mem_malloc(alloc_t* mem, ssize_t sz) {
-  return mem->malloc(to_size_t(sz));
+  const size_t size = to_size_t(sz);
+  if (size > SIZE_MAX - sizeof(mem_header_t)) return NULL;
+  mem_header_t* h = (mem_header_t*)mem->malloc(sizeof(mem_header_t) + size);
+  if (h == NULL) return NULL;
+  h->size = size;
+  h->tag  = (size_t)mem->tag;
+  mem->stats->tags[h->tag].mallocs++;
+  mem_account_alloc(mem->stats, h->tag, size);
+  return (h + 1);
 }
 
 ic_private void* mem_zalloc(alloc_t* mem, ssize_t sz) {
@@ -316,13 +387,45 @@ ic_private void* mem_zalloc(alloc_t* mem, ssize_t sz) {
 }
 
 ic_private void* mem_realloc(alloc_t* mem, void* p, ssize_t newsz) {
-  return mem->realloc(p, to_size_t(newsz));
+  if (p == NULL) return mem_malloc(mem, newsz);
+  const size_t size = to_size_t(newsz);
+  if (size > SIZE_MAX - sizeof(mem_header_t)) return NULL;
+  mem_header_t* h = ((mem_header_t*)p) - 1;
+  const size_t oldsize = h->size;
+  h = (mem_header_t*)mem->realloc(h, sizeof(mem_header_t) + size);
+  if (h == NULL) return NULL;
+  h->size = size;  // keeps the original tag
+  mem->stats->tags[h->tag].reallocs++;
+  mem_account_free(mem->stats, h->tag, oldsize);
+  mem_account_alloc(mem->stats, h->tag, size);
+  return (h + 1);
 }
 
 ic_private void mem_free(alloc_t* mem, const void* p) {
+  if (p == NULL) return;
+  mem_header_t* h = ((mem_header_t*)p) - 1;
+  mem->stats->tags[h->tag].frees++;
+  mem_account_free(mem->stats, h->tag, h->size);
+  mem->free(h);
+}
+
+ic_private void* mem_raw_malloc(alloc_t* mem, ssize_t sz) {
+  return mem->malloc(to_size_t(sz));
+}
+
+ic_private void mem_raw_free(alloc_t* mem, const void* p) {
   mem->free((void*)p);
 }
 
+ic_private char* mem_raw_strdup(alloc_t* mem, const char* s) {
+  if (s==NULL) return NULL;
+  ssize_t n = ic_strlen(s);
+  char* p = (char*)mem_raw_malloc(mem, n+1);
+  if (p == NULL) return NULL;
+  ic_memcpy(p, s, n+1);
+  return p;
+}
+
 ic_private char* mem_strdup(alloc_t* mem, const char* s) {
   if (s==NULL) return NULL;
   ssize_t n = ic_strlen(s);
@@ -142,6 +142,13 @@ ic_private ic_color_t ic_rgbx(ssize_t r, ssize_t g, ssize_t b);
 
 
 
+//-------------------------------------------------------------
+// Time
+//-------------------------------------------------------------
+
+ic_private int64_t ic_time_us(void);   // monotonic time in micro seconds
+
+
 //-------------------------------------------------------------
 // Debug
 //-------------------------------------------------------------
@@ -164,12 +171,23 @@ typedef struct ic_env_s ic_env_t;
 // Allocation
 //-------------------------------------------------------------
 
+struct mem_stats_s;
+
 typedef struct alloc_s {
-  ic_malloc_fun_t*  malloc;
-  ic_realloc_fun_t* realloc;
-  ic_free_fun_t*    free;
+  ic_malloc_fun_t*    malloc;
+  ic_realloc_fun_t*   realloc;
+  ic_free_fun_t*      free;
+  ic_stat_mem_t       tag;       // allocations are accounted to this subsystem
+  struct alloc_s*     tagged;    // allocators for each subsystem (`IC_MEM_COUNT`)
+  struct mem_stats_s* stats;     // shared by all tagged allocators
 } alloc_t;
 
+ic_private alloc_t* mem_new( ic_malloc_fun_t* _malloc, ic_realloc_fun_t* _realloc, ic_free_fun_t* _free );
+ic_private void     mem_delete( alloc_t* mem );
+ic_private alloc_t* mem_tagged( alloc_t* mem, ic_stat_mem_t tag );  // allocator that accounts to `tag`
+ic_private void     mem_get_stats( const alloc_t* mem, ic_stats_t* stats );
+ic_private void     mem_reset_stats( alloc_t* mem );
+
 
 ic_private void* mem_malloc( alloc_t* mem, ssize_t sz );
 ic_private void* mem_zalloc( alloc_t* mem, ssize_t sz );
@@ -178,6 +196,12 @@ ic_private void  mem_free( alloc_t* mem, const void* p );
 ic_private char* mem_strdup( alloc_t* mem, const char* s);
 ic_private char* mem_strndup( alloc_t* mem, const char* s, ssize_t n);
 
+// Allocations handed to the user (like the result of `ic_readline`) can be freed
+// with plain `free`, so they have no header and are not accounted.
+ic_private void* mem_raw_malloc( alloc_t* mem, ssize_t sz );
+ic_private void  mem_raw_free( alloc_t* mem, const void* p );
+ic_private char* mem_raw_strdup( alloc_t* mem, const char* s );
+
 #define mem_zalloc_tp(mem,tp)        (tp*)mem_zalloc(mem,ssizeof(tp))
 #define mem_malloc_tp_n(mem,tp,n)    (tp*)mem_malloc(mem,(n)*ssizeof(tp))
 #define mem_zalloc_tp_n(mem,tp,n)    (tp*)mem_zalloc(mem,(n)*ssizeof(tp))
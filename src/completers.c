@@ -22,7 +22,7 @@
 // free variables for word completion
 typedef struct word_closure_s {
   long                  delete_before_adjust;
-  void*                 prev_env;
+  void*                 prev_closure;
   ic_completion_fun_t*  prev_complete;
 } word_closure_t;
 
@@ -31,22 +31,20 @@ typedef struct word_closure_s {
 static bool token_add_completion_ex(ic_env_t* env, void* closure, const char* replacement, const char* display, const char* help, long delete_before, long delete_after) {
   word_closure_t* wenv = (word_closure_t*)(closure);
   // call the previous completer with an adjusted delete-before
-  return (*wenv->prev_complete)(env, wenv->prev_env, replacement, display, help, wenv->delete_before_adjust + delete_before, delete_after);
+  return (*wenv->prev_complete)(env, wenv->prev_closure, replacement, display, help, wenv->delete_before_adjust + delete_before, delete_after);
 }
 
 
-ic_public void ic_complete_word(ic_completion_env_t* cenv, const char* prefix, ic_completer_fun_t* fun,
-                                    ic_is_char_class_fun_t* is_word_char) 
+static void complete_word(ic_completion_env_t* cenv, const char* prefix, ic_completer_fun_t* fun,
+                                    const char_pred_t* is_word_char) 
 {
-  if (is_word_char == NULL) is_word_char = &ic_char_is_nonseparator;
-  
   ssize_t len = ic_strlen(prefix);
   ssize_t pos = len; // will be start of the 'word' (excluding a potential start quote)
   while (pos > 0) {
     // go back one code point
     ssize_t ofs = str_prev_ofs(prefix, pos, NULL);
     if (ofs <= 0) break;
-    if (!(*is_word_char)(prefix + (pos - ofs), (long)ofs)) { 
+    if (!char_pred_is(is_word_char, prefix + (pos - ofs), ofs)) { 
       break;
     }
     pos -= ofs;
@@ -60,7 +58,7 @@ ic_public void ic_complete_word(ic_completion_env_t* cenv, const char* prefix, i
   word_closure_t wenv;
   wenv.delete_before_adjust = (long)(len - pos);
   wenv.prev_complete = cenv->complete;
-  wenv.prev_env = cenv->env;
+  wenv.prev_closure = cenv->closure;
   cenv->complete = &token_add_completion_ex;
   cenv->closure = &wenv;
 
@@ -69,7 +67,30 @@ ic_public void ic_complete_word(ic_completion_env_t* cenv, const char* prefix, i
 
   // restore the original environment
   cenv->complete = wenv.prev_complete;
-  cenv->closure = wenv.prev_env;
+  cenv->closure = wenv.prev_closure;
+}
+
+ic_public void ic_complete_word(ic_completion_env_t* cenv, const char* prefix, ic_completer_fun_t* fun,
+                                    ic_is_char_class_fun_t* is_word_char) 
+{
+  if (is_word_char == NULL) {
+    ic_complete_word_class(cenv, prefix, fun, NULL);
+    return;
+  }
+  const char_pred_t pred = { is_word_char, NULL };
+  complete_word(cenv, prefix, fun, &pred);
+}
+
+ic_public void ic_complete_word_class(ic_completion_env_t* cenv, const char* prefix, ic_completer_fun_t* fun,
+                                         const ic_char_class_t* word_chars) 
+{
+  ic_char_class_t nonsep;
+  if (word_chars == NULL) {
+    ic_char_class_init(&nonsep, IC_CHAR_CLASS_NONSEPARATOR);
+    word_chars = &nonsep;
+  }
+  const char_pred_t pred = { NULL, word_chars };
+  complete_word(cenv, prefix, fun, &pred);
 }
 
 
@@ -83,8 +104,8 @@ typedef struct qword_closure_s {
   char         quote;
   long         delete_before_adjust;
   stringbuf_t* sbuf;
-  void*        prev_env;
-  ic_is_char_class_fun_t* is_word_char;
+  void*        prev_closure;
+  const char_pred_t*      is_word_char;
   ic_completion_fun_t*    prev_complete;
 } qword_closure_t;
 
@@ -104,7 +125,7 @@ static bool qword_add_completion_ex(ic_env_t* env, void* closure, const char* re
     ssize_t next;
     while ( (next = sbuf_next_ofs(wenv->sbuf, pos, NULL)) > 0 ) 
     {
-      if (!(*wenv->is_word_char)(sbuf_string(wenv->sbuf) + pos, (long)next)) { // strchr(wenv->non_word_char, sbuf_char_at( wenv->sbuf, pos )) != NULL) {
+      if (!char_pred_is(wenv->is_word_char, sbuf_string(wenv->sbuf) + pos, next)) { // strchr(wenv->non_word_char, sbuf_char_at( wenv->sbuf, pos )) != NULL) {
         sbuf_insert_char_at( wenv->sbuf, wenv->escape_char, pos);
         pos++;
       }
@@ -112,7 +133,7 @@ static bool qword_add_completion_ex(ic_env_t* env, void* closure, const char* re
     }
   }
   // and call the previous completion function
-  return (*wenv->prev_complete)( env, wenv->prev_env, sbuf_string(wenv->sbuf), display, help, wenv->delete_before_adjust + delete_before, delete_after );  
+  return (*wenv->prev_complete)( env, wenv->prev_closure, sbuf_string(wenv->sbuf), display, help, wenv->delete_before_adjust + delete_before, delete_after );  
 }
 
 
@@ -121,9 +142,8 @@ ic_public void ic_complete_qword( ic_completion_env_t* cenv, const char* prefix,
 }
 
 
-ic_public void ic_complete_qword_ex( ic_completion_env_t* cenv, const char* prefix, ic_completer_fun_t* fun, 
-                                        ic_is_char_class_fun_t* is_word_char, char escape_char, const char* quote_chars ) {
-  if (is_word_char == NULL) is_word_char = &ic_char_is_nonseparator ;  
+static void complete_qword( ic_completion_env_t* cenv, const char* prefix, ic_completer_fun_t* fun, 
+                                const char_pred_t* is_word_char, char escape_char, const char* quote_chars ) {
   if (quote_chars == NULL) quote_chars = "'\"";
 
   ssize_t len = ic_strlen(prefix);
@@ -140,7 +160,7 @@ ic_public void ic_complete_qword_ex( ic_completion_env_t* cenv, const char* pref
     pos = 0; 
     while(pos < len) {
       if (prefix[pos] == escape_char && prefix[pos+1] != 0 && 
-           !(*is_word_char)(prefix + pos + 1, 1)) // strchr(non_word_char, prefix[pos+1]) != NULL
+           !char_pred_is(is_word_char, prefix + pos + 1, 1)) // strchr(non_word_char, prefix[pos+1]) != NULL
       {       
         pos++; // skip escape and next char
       }
@@ -155,7 +175,7 @@ ic_public void ic_complete_qword_ex( ic_completion_env_t* cenv, const char* pref
         qpos_close = pos;
         qcount++;
       }
-      else if (!(*is_word_char)(prefix + pos, 1)) { //  strchr(non_word_char, prefix[pos]) != NULL) {
+      else if (!char_pred_is(is_word_char, prefix + pos, 1)) { //  strchr(non_word_char, prefix[pos]) != NULL) {
         qpos_close = -1;
       }
       ssize_t ofs = str_next_ofs( prefix, len, pos, NULL );
@@ -180,7 +200,7 @@ ic_public void ic_complete_qword_ex( ic_completion_env_t* cenv, const char* pref
       // go back one code point
       ssize_t ofs = str_prev_ofs(prefix, pos, NULL );
       if (ofs <= 0) break;
-      if (!(*is_word_char)(prefix + (pos - ofs), (long)ofs)) { // strchr(non_word_char, prefix[pos - ofs]) != NULL) {
+      if (!char_pred_is(is_word_char, prefix + (pos - ofs), ofs)) { // strchr(non_word_char, prefix[pos - ofs]) != NULL) {
         // non word char, break if it is not escaped
         if (pos <= ofs || prefix[pos - ofs - 1] != escape_char) break; 
         // otherwise go on
@@ -194,7 +214,7 @@ ic_public void ic_complete_qword_ex( ic_completion_env_t* cenv, const char* pref
   // if (len == pos) return;
 
   // allocate new unescaped word prefix
-  char* word = mem_strndup( cenv->env->mem, prefix + pos, (quote==0 ? len - pos : quote_len));
+  char* word = mem_strndup( cenv->mem, prefix + pos, (quote==0 ? len - pos : quote_len));
   if (word == NULL) return;
 
   if (quote == 0) {
@@ -205,7 +225,7 @@ ic_public void ic_complete_qword_ex( ic_completion_env_t* cenv, const char* pref
       ssize_t ofs = str_next_ofs(word, wlen, wpos, NULL);
       if (ofs <= 0) break;
       if (word[wpos] == escape_char && word[wpos+1] != 0 &&
-           !(*is_word_char)(word + wpos + 1, (long)ofs)) // strchr(non_word_char, word[wpos+1]) != NULL) {
+           !char_pred_is(is_word_char, word + wpos + 1, ofs)) // strchr(non_word_char, word[wpos+1]) != NULL) {
       {
         ic_memmove(word + wpos, word + wpos + 1, wlen - wpos /* including 0 */);
       }
@@ -236,9 +256,9 @@ ic_public void ic_complete_qword_ex( ic_completion_env_t* cenv, const char* pref
   wenv.escape_char    = escape_char;
   wenv.delete_before_adjust = (long)(len - pos);
   wenv.prev_complete  = cenv->complete;
-  wenv.prev_env       =  cenv->env;
-  wenv.sbuf = sbuf_new(cenv->env->mem);
-  if (wenv.sbuf == NULL) { mem_free(cenv->env->mem, word); return; }
+  wenv.prev_closure   = cenv->closure;
+  wenv.sbuf = sbuf_new(cenv->mem);
+  if (wenv.sbuf == NULL) { mem_free(cenv->mem, word); return; }
   cenv->complete = &qword_add_completion_ex;
   cenv->closure = &wenv;
 
@@ -247,10 +267,31 @@ ic_public void ic_complete_qword_ex( ic_completion_env_t* cenv, const char* pref
 
   // restore the original environment
   cenv->complete = wenv.prev_complete;
-  cenv->closure = wenv.prev_env;
+  cenv->closure = wenv.prev_closure;
 
   sbuf_free(wenv.sbuf);
-  mem_free(cenv->env->mem, word);  
+  mem_free(cenv->mem, word);  
+}
+
+ic_public void ic_complete_qword_ex( ic_completion_env_t* cenv, const char* prefix, ic_completer_fun_t* fun, 
+                                        ic_is_char_class_fun_t* is_word_char, char escape_char, const char* quote_chars ) {
+  if (is_word_char == NULL) {
+    ic_complete_qword_ex_class(cenv, prefix, fun, NULL, escape_char, quote_chars);
+    return;
+  }
+  const char_pred_t pred = { is_word_char, NULL };
+  complete_qword(cenv, prefix, fun, &pred, escape_char, quote_chars);
+}
+
+ic_public void ic_complete_qword_ex_class( ic_completion_env_t* cenv, const char* prefix, ic_completer_fun_t* fun, 
+                                              const ic_char_class_t* word_chars, char escape_char, const char* quote_chars ) {
+  ic_char_class_t nonsep;
+  if (word_chars == NULL) {
+    ic_char_class_init(&nonsep, IC_CHAR_CLASS_NONSEPARATOR);
+    word_chars = &nonsep;
+  }
+  const char_pred_t pred = { NULL, word_chars };
+  complete_qword(cenv, prefix, fun, &pred, escape_char, quote_chars);
 }
 
 
@@ -293,11 +334,11 @@ static bool ls_colors_init(void) {
     cli_color = -1;
     return false;
   }
-  cli_color = 1;
   s = getenv("LS_COLORS");
   if (s != NULL) { ls_colors = s;  }
   s = getenv("LSCOLORS");
   if (s != NULL) { lscolors = s; }  
+  cli_color = 1;  // set last as the completer may run on a worker thread
   return true;
 }
 
@@ -556,7 +597,7 @@ static bool filename_complete_indir( ic_completion_env_t* cenv, stringbuf_t* dir
   dir_cursor d = 0;
   dir_entry entry;
   bool cont = true;
-  if (os_findfirst(cenv->env->mem, sbuf_string(dir), &d, &entry)) {
+  if (os_findfirst(cenv->mem, sbuf_string(dir), &d, &entry)) {
     do {
       const char* name = os_direntry_name(&entry);
       if (name != NULL && strcmp(name, ".") != 0 && strcmp(name, "..") != 0 && 
@@ -601,9 +642,9 @@ typedef struct filename_closure_s {
 static void filename_completer( ic_completion_env_t* cenv, const char* prefix ) {
   if (prefix == NULL) return;
   filename_closure_t* fclosure = (filename_closure_t*)cenv->arg;  
-  stringbuf_t* root_dir   = sbuf_new(cenv->env->mem);
-  stringbuf_t* dir_prefix = sbuf_new(cenv->env->mem);
-  stringbuf_t* display    = sbuf_new(cenv->env->mem);  
+  stringbuf_t* root_dir   = sbuf_new(cenv->mem);
+  stringbuf_t* dir_prefix = sbuf_new(cenv->mem);
+  stringbuf_t* display    = sbuf_new(cenv->mem);  
   if (root_dir!=NULL && dir_prefix != NULL && display != NULL) 
   {
     // split prefix in dir_prefix / base.
@@ -671,5 +712,7 @@ ic_public void ic_complete_filename( ic_completion_env_t* cenv, const char* pref
   fclosure.roots = roots; 
   fclosure.extensions = extensions;
   cenv->arg = &fclosure;
-  ic_complete_qword_ex( cenv, prefix, &filename_completer, &ic_char_is_filename_letter, '\\', "'\"");  
+  ic_char_class_t filename_letters;
+  ic_char_class_init(&filename_letters, IC_CHAR_CLASS_FILENAME_LETTER);
+  ic_complete_qword_ex_class( cenv, prefix, &filename_completer, &filename_letters, '\\', "'\"");  
 }
@@ -35,6 +35,7 @@ struct completions_s {
   ssize_t len;
   completion_t* elems;
   alloc_t* mem;
+  pool_task_t* task;   // generating in the background for this task (if not NULL)
 };
 
 static void default_filename_completer( ic_completion_env_t* cenv, const char* prefix );
@@ -71,6 +72,16 @@ ic_private void completions_clear(completions_t* cms) {
   }
 }
 
+// Completions that are generated on a worker thread for `task`
+ic_private completions_t* completions_new_task(alloc_t* mem, ic_completer_fun_t* completer, void* arg, pool_task_t* task) {
+  completions_t* cms = completions_new(mem);
+  if (cms == NULL) return NULL;
+  cms->completer = completer;
+  cms->completer_arg = arg;
+  cms->task = task;
+  return cms;
+}
+
 static void completions_push(completions_t* cms, const char* replacement, const char* display, const char* help, ssize_t delete_before, ssize_t delete_after) 
 {
   if (cms->count >= cms->len) {
@@ -90,6 +101,14 @@ static void completions_push(completions_t* cms, const char* replacement, const
   cms->count++;
 }
 
+ic_private void completions_assign(completions_t* cms, const completions_t* from) {
+  completions_clear(cms);
+  for (ssize_t i = 0; i < from->count; i++) {
+    const completion_t* cm = from->elems + i;
+    completions_push(cms, cm->replacement, cm->display, cm->help, cm->delete_before, cm->delete_after);
+  }
+}
+
 ic_private ssize_t completions_count(completions_t* cms) {
   return cms->count;
 }
@@ -104,6 +123,10 @@ static bool completions_contains(completions_t* cms, const char* replacement) {
 
 ic_private bool completions_add(completions_t* cms, const char* replacement, const char* display, const char* help, ssize_t delete_before, ssize_t delete_after) {
   if (cms->completer_max <= 0) return false;
+  if (cms->task != NULL && pool_task_cancelled(cms->task)) {
+    cms->completer_max = 0;   // stop completing
+    return false;
+  }
   cms->completer_max--;
   //debug_msg("completion: add: %d,%d, %s\n", delete_before, delete_after, replacement);
   if (!completions_contains(cms,replacement)) {
@@ -155,15 +178,20 @@ ic_private void completions_get_completer(completions_t* cms, ic_completer_fun_t
 
 
 ic_public void* ic_completion_arg( const ic_completion_env_t* cenv ) {
-  return (cenv == NULL ? NULL : cenv->env->completions->completer_arg);
+  return (cenv == NULL ? NULL : cenv->completions->completer_arg);
 }
 
 ic_public bool ic_has_completions( const ic_completion_env_t* cenv ) {
-  return (cenv == NULL ? false : cenv->env->completions->count > 0);
+  return (cenv == NULL ? false : cenv->completions->count > 0);
 }
 
 ic_public bool ic_stop_completing( const ic_completion_env_t* cenv) {
-  return (cenv == NULL ? true : cenv->env->completions->completer_max <= 0);
+  if (cenv == NULL) return true;
+  completions_t* cms = cenv->completions;
+  if (cms->completer_max > 0 && cms->task != NULL && pool_task_cancelled(cms->task)) {
+    cms->completer_max = 0;
+  }
+  return (cms->completer_max <= 0);
 }
 
 
@@ -270,6 +298,26 @@ ic_public bool ic_add_completions(ic_completion_env_t* cenv, const char* prefix,
   return true;
 }
 
+ic_public bool ic_add_completions_packed(ic_completion_env_t* cenv, const char* entries, long len) {
+  if (entries == NULL || len <= 0) return true;
+  const char* p = entries;
+  const char* const end = entries + len;
+  while (p < end) {
+    // split the replacement, display, and help
+    const char* fields[3];
+    for (int i = 0; i < 3; i++) {
+      const char* z = (p < end ? (const char*)memchr(p, 0, to_size_t(end - p)) : NULL);
+      if (z == NULL) { debug_msg("completions: truncated packed entry\n"); return true; }
+      fields[i] = p;
+      p = z + 1;
+    }
+    if (!ic_add_completion_ex(cenv, fields[0], (fields[1][0] == 0 ? NULL : fields[1]), (fields[2][0] == 0 ? NULL : fields[2]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
 ic_public bool ic_add_completion(ic_completion_env_t* cenv, const char* replacement) {
   return ic_add_completion_ex(cenv, replacement, NULL, NULL);
 }
@@ -283,12 +331,13 @@ ic_public bool ic_add_completion_prim(ic_completion_env_t* cenv, const char* rep
 }
 
 static bool prim_add_completion(ic_env_t* env, void* funenv, const char* replacement, const char* display, const char* help, long delete_before, long delete_after) {
-  ic_unused(funenv);
-  return completions_add(env->completions, replacement, display, help, delete_before, delete_after);
+  ic_unused(env);
+  return completions_add((completions_t*)funenv, replacement, display, help, delete_before, delete_after);
 }
 
 ic_public void ic_set_default_completer(ic_completer_fun_t* completer, void* arg) {
   ic_env_t* env = ic_get_env(); if (env == NULL) return;
+  ic_env_init_edit(env);
   completions_set_completer(env->completions, completer, arg);
 }
 
@@ -299,11 +348,13 @@ ic_private ssize_t completions_generate(struct ic_env_s* env, completions_t* cms
   // set up env
   ic_completion_env_t cenv;
   cenv.env = env;
+  cenv.completions = cms;
+  cenv.mem = cms->mem;
   cenv.input = input,
   cenv.cursor = (long)pos;
   cenv.arg = cms->completer_arg;
   cenv.complete = &prim_add_completion;
-  cenv.closure  = NULL;
+  cenv.closure  = cms;
   const char* prefix = mem_strndup(cms->mem, input, pos);
   cms->completer_max = max;
   
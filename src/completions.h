@@ -10,6 +10,7 @@
 
 #include "common.h"
 #include "stringbuf.h"
+#include "pool.h"
 
 
 //-------------------------------------------------------------
@@ -23,6 +24,8 @@ typedef struct completions_s completions_t;
 ic_private completions_t* completions_new(alloc_t* mem);
 ic_private void        completions_free(completions_t* cms);
 ic_private void        completions_clear(completions_t* cms);
+ic_private completions_t* completions_new_task(alloc_t* mem, ic_completer_fun_t* completer, void* arg, pool_task_t* task);  // stops when `task` is cancelled
+ic_private void        completions_assign(completions_t* cms, const completions_t* from);
 ic_private bool        completions_add(completions_t* cms , const char* replacement, const char* display, const char* help, ssize_t delete_before, ssize_t delete_after);
 ic_private ssize_t     completions_count(completions_t* cms);
 ic_private ssize_t     completions_generate(struct ic_env_s* env, completions_t* cms , const char* input, ssize_t pos, ssize_t max);
@@ -42,6 +45,8 @@ typedef bool (ic_completion_fun_t)( ic_env_t* env, void* funenv, const char* rep
 
 struct ic_completion_env_s {
   ic_env_t*   env;       // the isocline environment
+  completions_t* completions;  // the completions that are generated
+  alloc_t*    mem;       // allocator (the task allocator when running in the background)
   const char* input;     // current full input
   long        cursor;    // current cursor position
   void*       arg;       // argument given to `ic_set_completer`
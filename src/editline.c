@@ -16,12 +16,30 @@
 #include "completions.h"
 #include "undo.h"
 #include "highlight.h"
+#include "trace.h"
 
 //-------------------------------------------------------------
 // The editor state
 //-------------------------------------------------------------
 
-
+// Stages of rendering a frame whose cost we measure
+typedef enum stage_e {
+  STAGE_HINT,       // generating a hint (completion)
+  STAGE_HIGHLIGHT,  // syntax highlighting
+  STAGE_BRACES,     // brace matching
+  STAGE_RENDER,     // layout and terminal output
+  STAGE_COUNT
+} stage_t;
+
+// Render quality degrades when a frame exceeds its time budget; each 
+// level `n` (partially) disables stage `n-1` on top of the previous levels.
+typedef enum degrade_e {
+  DEGRADE_NONE,       // full quality
+  DEGRADE_HINT,       // no hints
+  DEGRADE_HIGHLIGHT,  // only highlight the visible region
+  DEGRADE_BRACES,     // no brace matching
+  DEGRADE_MAX = DEGRADE_BRACES
+} degrade_t;
 
 // editor state
 typedef struct editor_s {
@@ -33,6 +51,8 @@ typedef struct editor_s {
   ssize_t       cur_rows;     // current used rows to display our content (including extra content)
   ssize_t       cur_row;      // current row that has the cursor (0 based, relative to the prompt)
   ssize_t       termw;
+  ssize_t       hscroll;      // first visible offset in the cursor line (in horizontal scroll mode)
+  ssize_t       hscroll_line; // start of the line that contains `hscroll` (or -1 if the input changed)
   bool          modified;     // has a modification happened? (used for history navigation for example)  
   bool          disable_undo; // temporarily disable auto undo (for history search)
   ssize_t       history_idx;  // current index in the history 
@@ -43,6 +63,23 @@ typedef struct editor_s {
   // caches
   attrbuf_t*    attrs;        // reuse attribute buffers 
   attrbuf_t*    attrs_extra; 
+  // render quality
+  degrade_t     degrade;      // current degradation level
+  ssize_t       degrade_frames;         // frames rendered at the current (degraded) level
+  int64_t       frame_cost;             // cost of the current frame so far (in micro seconds)
+  int64_t       cost[STAGE_COUNT];      // last measured cost of each stage (in micro seconds)
+  ssize_t       cost_len[STAGE_COUNT];  // input bytes processed in that measurement
+  // statistics
+  ic_stats_t*   stats;                  // latency statistics (in the environment)
+  int64_t       op_cost;                // cost of the measured stages during the current edit operation
+  // background tasks (see `edit_poll_tasks`)
+  pool_task_t*  hl_task;      // pending highlight task
+  stringbuf_t*  hl_input;     // input of the last highlight result
+  attrbuf_t*    hl_attrs;     // and its attributes
+  bool          hl_waiting;   // are we waiting for the highlight task during a refresh?
+  pool_task_t*  complete_task;   // pending completer task (for a hint or tab completion)
+  bool          hint_resubmit;   // generate a hint once the (cancelled) completer task is done
+  bool          task_refresh;    // refresh as a background result arrived
 } editor_t;
 
 
@@ -54,8 +91,10 @@ typedef struct editor_s {
 //-------------------------------------------------------------
 static char* edit_line( ic_env_t* env, const char* prompt_text );  // defined at bottom
 static void edit_refresh(ic_env_t* env, editor_t* eb);
+static bool edit_highlight_background(ic_env_t* env, editor_t* eb);
 
 ic_private char* ic_editline(ic_env_t* env, const char* prompt_text) {
+  term_probe_caps(env->term);  // before raw mode so the probe can read the responses
   tty_start_raw(env->tty);
   term_start_raw(env->term);
   char* line = edit_line(env,prompt_text);
@@ -74,7 +113,7 @@ ic_private char* ic_editline(ic_env_t* env, const char* prompt_text) {
 // capture the current edit state
 static void editor_capture(editor_t* eb, editstate_t** es ) {
   if (!eb->disable_undo) {
-    editstate_capture( eb->mem, es, sbuf_string(eb->input), eb->pos );
+    editstate_capture( mem_tagged(eb->mem, IC_MEM_UNDO), es, sbuf_string(eb->input), eb->pos );
   }
 }
 
@@ -90,6 +129,11 @@ static void editor_undo_forget(editor_t* eb) {
   mem_free(eb->mem, input);
 }
 
+// called when the input is modified to invalidate cached positions
+static void editor_input_changed(editor_t* eb) {
+  eb->hscroll_line = -1;
+}
+
 static void editor_restore(editor_t* eb, editstate_t** from, editstate_t** to ) {
   if (eb->disable_undo) return;
   if (*from == NULL) return;
@@ -97,6 +141,7 @@ static void editor_restore(editor_t* eb, editstate_t** from, editstate_t** to )
   if (to != NULL) { editor_capture( eb, to ); }
   if (!editstate_restore( eb->mem, from, &input, &eb->pos )) return;
   sbuf_replace( eb->input, input );
+  editor_input_changed(eb);
   mem_free(eb->mem, input);
   eb->modified = false;
 }
@@ -111,6 +156,7 @@ static void editor_redo_restore(editor_t* eb ) {
 }
 
 static void editor_start_modify(editor_t* eb ) {
+  editor_input_changed(eb);
   editor_undo_capture(eb);
   editstate_done(eb->mem, &eb->redo);  // clear redo
   eb->modified = true;
@@ -142,24 +188,44 @@ static void edit_get_prompt_width( ic_env_t* env, editor_t* eb, bool in_extra, s
   }
 }
 
+// the width used to wrap the input into rows (0 for no wrapping in horizontal scroll mode)
+static ssize_t edit_wrap_width( ic_env_t* env, editor_t* eb ) {
+  return (env->hscroll ? 0 : eb->termw);
+}
+
 static ssize_t edit_get_rowcol( ic_env_t* env, editor_t* eb, rowcol_t* rc ) {
   ssize_t promptw, cpromptw;
   edit_get_prompt_width(env, eb, false, &promptw, &cpromptw);
-  return sbuf_get_rc_at_pos( eb->input, eb->termw, promptw, cpromptw, eb->pos, rc );
+  return sbuf_get_rc_at_pos( eb->input, edit_wrap_width(env,eb), promptw, cpromptw, eb->pos, rc );
 }
 
-static void edit_set_pos_at_rowcol( ic_env_t* env, editor_t* eb, ssize_t row, ssize_t col ) {
+// Like `edit_get_rowcol` but only lays out the lines around the cursor that are needed to move
+// one row up or down; the row is relative to the line start `*start` (see `sbuf_get_rc_at_pos_near`).
+// The cursor is on the first row only if `rc->row == 0`, and on the last row if `rc->row + 1` 
+// equals the returned row count.
+static ssize_t edit_get_rowcol_near( ic_env_t* env, editor_t* eb, rowcol_t* rc, ssize_t* start ) {
   ssize_t promptw, cpromptw;
   edit_get_prompt_width(env, eb, false, &promptw, &cpromptw);
-  ssize_t pos = sbuf_get_pos_at_rc( eb->input, eb->termw, promptw, cpromptw, row, col );
+  return sbuf_get_rc_at_pos_near( eb->input, edit_wrap_width(env,eb), 2, promptw, cpromptw, eb->pos, rc, start );
+}
+
+static void edit_set_pos_at_rowcol( ic_env_t* env, editor_t* eb, ssize_t start, ssize_t row, ssize_t col ) {
+  ssize_t promptw, cpromptw;
+  edit_get_prompt_width(env, eb, false, &promptw, &cpromptw);
+  ssize_t pos = sbuf_get_pos_at_rc_from( eb->input, start, edit_wrap_width(env,eb), promptw, cpromptw, row, col );
   if (pos < 0) return;
   eb->pos = pos;
   edit_refresh(env, eb);
 }
 
 static bool edit_pos_is_at_row_end( ic_env_t* env, editor_t* eb ) {
+  if (env->hscroll) {
+    // each line is a single row
+    return (eb->pos == str_line_end(sbuf_string(eb->input), sbuf_len(eb->input), eb->pos));
+  }
   rowcol_t rc;
-  edit_get_rowcol( env, eb, &rc );
+  ssize_t start;
+  edit_get_rowcol_near( env, eb, &rc, &start );
   return rc.last_on_row;
 }
 
@@ -194,6 +260,7 @@ typedef struct refresh_info_s {
   editor_t*   eb;
   attrbuf_t*  attrs;
   bool        in_extra;
+  ssize_t     start;       // offset of the first laid out row (at a line start)
   ssize_t     first_row;
   ssize_t     last_row;
 } refresh_info_t;
@@ -212,14 +279,14 @@ static bool edit_refresh_rows_iter(
   if (row > info->last_row)  return true; // should not occur
   
   // term_clear_line(term);
-  edit_write_prompt(info->env, info->eb, row, info->in_extra);
+  edit_write_prompt(info->env, info->eb, (info->start > 0 ? row + 1 : row), info->in_extra);
 
-  //' write output
+  //' write output (the input stays valid until the frame is flushed so we can borrow it)
   if (info->attrs == NULL || (info->env->no_highlight && info->env->no_bracematch)) {
-    term_write_n( term, s + row_start, row_len );
+    term_write_borrow_n( term, s + row_start, row_len );
   }
   else {
-    term_write_formatted_n( term, s + row_start, attrbuf_attrs(info->attrs, row_start + row_len) + row_start, row_len );
+    term_write_formatted_borrow_n( term, s + row_start, attrbuf_attrs(info->attrs, row_start + row_len) + row_start, row_len );
   }
 
   // write line ending
@@ -242,7 +309,7 @@ static bool edit_refresh_rows_iter(
 
 static void edit_refresh_rows(ic_env_t* env, editor_t* eb, stringbuf_t* input, attrbuf_t* attrs,
                                ssize_t promptw, ssize_t cpromptw, bool in_extra, 
-                                ssize_t first_row, ssize_t last_row) 
+                                ssize_t start, ssize_t first_row, ssize_t last_row) 
 {
   if (input == NULL) return;
   refresh_info_t info;
@@ -250,28 +317,368 @@ static void edit_refresh_rows(ic_env_t* env, editor_t* eb, stringbuf_t* input, a
   info.eb         = eb;
   info.attrs      = attrs;
   info.in_extra   = in_extra;
+  info.start      = start;
+  info.first_row  = first_row;
+  info.last_row   = last_row;
+  sbuf_for_each_row_from( input, start, eb->termw, promptw, cpromptw, &edit_refresh_rows_iter, &info, NULL);
+}
+
+//-------------------------------------------------------------
+// Refresh: horizontal scrolling
+// Each input line is shown on a single row: the cursor line 
+// starts at `eb->hscroll` and other lines at their start, where
+// a dimmed `<` or `>` marks that a line continues beyond the edge.
+// Only the lines around the cursor that fit the terminal are laid
+// out, and a row takes at most the terminal width to render.
+//-------------------------------------------------------------
+
+typedef struct hscroll_row_s {
+  ssize_t start;      // first visible offset
+  ssize_t len;        // visible length in bytes
+  ssize_t width;      // column width of the row (including the prompt and markers)
+  bool    left;       // does the line continue on the left?
+  bool    right;      // does the line continue on the right?
+} hscroll_row_t;
+
+typedef struct hscroll_view_s {
+  ssize_t first;      // offset of the first visible line
+  bool    at_top;     // is the first visible line the first line of the input?
+  ssize_t rows;       // visible rows
+  ssize_t cur_row;    // row of the cursor
+  ssize_t cur_col;    // column of the cursor (excluding the prompt)
+} hscroll_view_t;
+
+typedef bool (hscroll_row_fun_t)(ic_env_t* env, editor_t* eb, ssize_t row, const hscroll_row_t* hr, bool first_line, void* arg);
+
+// take the characters from `start` that fit in `avail` columns (but not beyond the line end)
+static ssize_t str_take_line_fit( const char* s, ssize_t len, ssize_t start, ssize_t avail, ssize_t* width ) {
+  ssize_t pos = start;
+  ssize_t w = 0;
+  while (pos < len && s[pos] != '\n') {
+    // advance over printable ascii in bulk (one column per byte); the last byte of the run 
+    // is left to `str_next_ofs` as it groups a following stray continuation byte with it.
+    const ssize_t ascii = str_ascii_prefix(s + pos, len - pos) - 1;
+    if (ascii > 0 && w < avail) {
+      const ssize_t n = (ascii < avail - w ? ascii : avail - w);
+      pos += n;
+      w += n;
+      continue;
+    }
+    ssize_t cw;
+    ssize_t next = str_next_ofs(s, len, pos, &cw);
+    if (next <= 0 || w + cw > avail) break;
+    w += cw;
+    pos += next;
+  }
+  *width = w;
+  return (pos - start);
+}
+
+static void edit_hscroll_row( const char* s, ssize_t len, ssize_t line_start, ssize_t start, 
+                              ssize_t startw, ssize_t termw, hscroll_row_t* hr ) 
+{
+  ssize_t avail = termw - startw - 2;  // like wrapped rows, leave room for the cursor
+  hr->left = (start > line_start);
+  if (hr->left) avail--;
+  if (avail < 1) avail = 1;
+  ssize_t w;
+  ssize_t n = str_take_line_fit(s, len, start, avail, &w);
+  hr->right = (start + n < len && s[start + n] != '\n');
+  if (hr->right) {
+    n = str_take_line_fit(s, len, start, avail - 1, &w);
+  }
+  hr->start = start;
+  hr->len   = n;
+  hr->width = startw + w + (hr->left ? 1 : 0) + (hr->right ? 1 : 0);
+}
+
+// The start of the cursor line. Scanning back over a long line is expensive so we reuse the
+// start of the line of the scroll offset if the input did not change and there is no newline 
+// between the scroll offset and the cursor (which is usually close by).
+static ssize_t edit_hscroll_line_start( editor_t* eb, const char* s, ssize_t len ) {
+  const ssize_t hs = eb->hscroll;
+  if (eb->hscroll_line >= 0 && eb->hscroll_line <= hs && hs <= len && sbuf_len(eb->hint) == 0) {  // the hint is inserted at the cursor
+    const ssize_t lo = (hs < eb->pos ? hs : eb->pos);
+    const ssize_t hi = (hs < eb->pos ? eb->pos : hs);
+    if (memchr(s + lo, '\n', to_size_t(hi - lo)) == NULL) return eb->hscroll_line;
+  }
+  return str_line_start(s, eb->pos);
+}
+
+// determine the visible lines and update the horizontal scroll offset so the cursor is visible
+static void edit_hscroll_layout( ic_env_t* env, editor_t* eb, ssize_t termw, ssize_t promptw, ssize_t cpromptw, hscroll_view_t* view ) 
+{
+  const char*   s   = sbuf_string(eb->input);
+  const ssize_t len = sbuf_len(eb->input);
+  const ssize_t ls  = edit_hscroll_line_start(eb, s, len);
+  ssize_t avail = termw - (ls == 0 ? promptw : cpromptw) - 2 - 2;  // leave room for both markers
+  if (avail < 1) avail = 1;
+
+  // keep the current offset if the cursor is still visible
+  ssize_t hs = eb->hscroll;
+  ssize_t w  = -1;   // width from `hs` to the cursor
+  if (hs >= ls && hs <= eb->pos && (hs == len || ((uint8_t)s[hs] & 0xC0) != 0x80)) {
+    ssize_t n = str_take_line_fit(s, eb->pos, hs, avail, &w);  // up to the cursor
+    if (hs + n < eb->pos) w = -1;
+  }
+  if (w < 0) {
+    // scroll such that the cursor is at one third (going left) or two thirds (going right)
+    const ssize_t target = (eb->pos < hs ? avail/3 : (2*avail)/3);
+    hs = eb->pos;
+    w  = 0;
+    while (hs > ls) {
+      ssize_t cw;
+      ssize_t prev = str_prev_ofs(s, hs, &cw);
+      if (prev <= 0 || w + cw > target) break;
+      hs -= prev;
+      w  += cw;
+    }
+  }
+  eb->hscroll      = hs;
+  eb->hscroll_line = ls;
+  view->cur_col = w + (hs > ls ? 1 : 0);
+
+  // show the lines around the cursor that fit in the terminal
+  const ssize_t termh = term_get_height(env->term);
+  ssize_t first = ls;
+  ssize_t above = 0;
+  while (first > 0 && above < termh - 1) {
+    first = str_line_start(s, first - 1);
+    above++;
+  }
+  ssize_t below = 0;
+  ssize_t le = str_line_end(s, len, eb->pos);
+  while (le < len && above + below + 1 < termh) {
+    le = str_line_end(s, len, le + 1);
+    below++;
+  }
+  view->first   = first;
+  view->at_top  = (first == 0);
+  view->rows    = above + below + 1;
+  view->cur_row = above;
+}
+
+static void edit_hscroll_for_each_row( ic_env_t* env, editor_t* eb, ssize_t termw, ssize_t promptw, ssize_t cpromptw, 
+                                       const hscroll_view_t* view, hscroll_row_fun_t* fun, void* arg ) 
+{
+  const char*   s   = sbuf_string(eb->input);
+  const ssize_t len = sbuf_len(eb->input);
+  ssize_t line = view->first;
+  for (ssize_t row = 0; row < view->rows; row++) {
+    const bool first_line = (row == 0 && view->at_top);
+    hscroll_row_t hr;
+    edit_hscroll_row(s, len, line, (row == view->cur_row ? eb->hscroll : line), (first_line ? promptw : cpromptw), termw, &hr);
+    if (fun(env, eb, row, &hr, first_line, arg)) break;
+    line = str_line_end(s, len, hr.start + hr.len) + 1;
+  }
+}
+
+static bool edit_hscroll_refresh_row( ic_env_t* env, editor_t* eb, ssize_t row, const hscroll_row_t* hr, bool first_line, void* arg ) {
+  const refresh_info_t* info = (const refresh_info_t*)arg;
+  term_t* term = env->term;
+  if (row < info->first_row) return false;
+  if (row > info->last_row)  return true;
+
+  edit_write_prompt(env, eb, (first_line ? 0 : 1), false);
+  if (hr->left) { bbcode_print(env->bbcode, "[ic-dim]<"); }
+  const char* s = sbuf_string(eb->input);
+  if (info->attrs == NULL || (env->no_highlight && env->no_bracematch)) {
+    term_write_borrow_n( term, s + hr->start, hr->len );
+  }
+  else {
+    term_write_formatted_borrow_n( term, s + hr->start, attrbuf_attrs(info->attrs, hr->start + hr->len) + hr->start, hr->len );
+  }
+  if (hr->right) { bbcode_print(env->bbcode, "[ic-dim]>"); }
+  term_clear_to_end_of_line(term);
+  if (row < info->last_row) {
+    term_writeln(term, "");
+  }
+  return (row >= info->last_row);
+}
+
+static void edit_hscroll_refresh_rows( ic_env_t* env, editor_t* eb, const hscroll_view_t* view, ssize_t promptw, ssize_t cpromptw,
+                                       ssize_t first_row, ssize_t last_row )
+{
+  refresh_info_t info;
+  info.env        = env;
+  info.eb         = eb;
+  info.attrs      = eb->attrs;
+  info.in_extra   = false;
+  info.start      = 0;
   info.first_row  = first_row;
   info.last_row   = last_row;
-  sbuf_for_each_row( input, eb->termw, promptw, cpromptw, &edit_refresh_rows_iter, &info, NULL);
+  edit_hscroll_for_each_row(env, eb, eb->termw, promptw, cpromptw, view, &edit_hscroll_refresh_row, &info);
+}
+
+typedef struct hscroll_wrap_s {
+  const hscroll_view_t* view;
+  ssize_t newtermw;
+  ssize_t promptw;
+  ssize_t cpromptw;
+  ssize_t rows;
+  ssize_t cur_row;
+} hscroll_wrap_t;
+
+static bool edit_hscroll_wrap_row( ic_env_t* env, editor_t* eb, ssize_t row, const hscroll_row_t* hr, bool first_line, void* arg ) {
+  ic_unused(env); ic_unused(eb);
+  hscroll_wrap_t* wrap = (hscroll_wrap_t*)arg;
+  if (row == wrap->view->cur_row) {
+    const ssize_t col = wrap->view->cur_col + (first_line ? wrap->promptw : wrap->cpromptw);
+    wrap->cur_row = wrap->rows + col / wrap->newtermw;
+  }
+  wrap->rows += (hr->width <= wrap->newtermw ? 1 : (hr->width + wrap->newtermw - 1) / wrap->newtermw);
+  return false;
+}
+
+// rows after the terminal hard-wrapped the rows we rendered for `termw` to the new width
+static ssize_t edit_hscroll_wrapped_rows( ic_env_t* env, editor_t* eb, ssize_t termw, ssize_t newtermw, 
+                                          ssize_t promptw, ssize_t cpromptw, rowcol_t* rc ) 
+{
+  hscroll_view_t view;
+  edit_hscroll_layout(env, eb, termw, promptw, cpromptw, &view);
+  hscroll_wrap_t wrap;
+  wrap.view     = &view;
+  wrap.newtermw = (newtermw <= 0 ? 1 : newtermw);
+  wrap.promptw  = promptw;
+  wrap.cpromptw = cpromptw;
+  wrap.rows     = 0;
+  wrap.cur_row  = 0;
+  edit_hscroll_for_each_row(env, eb, termw, promptw, cpromptw, &view, &edit_hscroll_wrap_row, &wrap);
+  rc->row = wrap.cur_row;
+  return wrap.rows;
 }
 
 
+//-------------------------------------------------------------
+// Refresh: render quality
+// We measure the cost of each stage of a frame. If a frame 
+// exceeds the budget, the next frames degrade one level further 
+// (see `degrade_t`). A level is restored once the estimated cost 
+// of the restored stage (scaled to the current input length) 
+// fits comfortably in the budget again.
+//-------------------------------------------------------------
+
+#define IC_FRAME_BUDGET_US  (8000)   // time budget of a frame (8ms)
+#define IC_DEGRADE_RETRY    (64)     // after this many degraded frames, measure the full quality again
+
+// record the latency of a phase in the statistics; returns the current time
+static int64_t edit_stat_done( editor_t* eb, ic_stat_phase_t phase, int64_t start ) {
+  const int64_t now = ic_time_us();
+  stats_add(&eb->stats->phases[phase], now - start);
+  return now;
+}
+
+static void edit_stage_done( editor_t* eb, stage_t stage, int64_t start, ssize_t len ) {
+  const int64_t cost = ic_time_us() - start;
+  eb->cost[stage] = cost;
+  eb->cost_len[stage] = len;
+  eb->frame_cost += cost;
+  eb->op_cost += cost;
+  // the render stage is recorded in finer phases in `edit_refresh`
+  static const ic_stat_phase_t phases[STAGE_COUNT] = { IC_STAT_HINT, IC_STAT_HIGHLIGHT, IC_STAT_BRACES, IC_STAT_COUNT };
+  if (phases[stage] != IC_STAT_COUNT) {
+    stats_add(&eb->stats->phases[phases[stage]], cost);
+  }
+}
+
+static void edit_degrade_update( editor_t* eb ) {
+  const int64_t cost = eb->frame_cost;
+  eb->frame_cost = 0;
+  if (cost > IC_FRAME_BUDGET_US) {
+    if (eb->degrade < DEGRADE_MAX) {
+      eb->degrade = (degrade_t)(eb->degrade + 1);
+      eb->degrade_frames = 0;
+      ic_trace(degrade, eb->degrade, cost);
+    }
+  }
+  else if (eb->degrade > DEGRADE_NONE) {
+    // estimate the cost of the stage that would be restored
+    const stage_t stage = (stage_t)(eb->degrade - 1);
+    const ssize_t len = sbuf_len(eb->input);
+    int64_t restore = eb->cost[stage];
+    if (eb->cost_len[stage] > 0) {
+      restore = (restore * len) / eb->cost_len[stage];
+    }
+    eb->degrade_frames++;
+    if (eb->degrade_frames >= IC_DEGRADE_RETRY) {
+      restore = 0;  // it may have been a transient slow down, try again
+    }
+    if (cost + restore <= IC_FRAME_BUDGET_US/2) {
+      eb->degrade = (degrade_t)(eb->degrade - 1);
+      eb->degrade_frames = 0;
+      ic_trace(degrade, eb->degrade, cost);
+    }
+  }
+}
+
+// A byte range around the cursor that contains the visible input in wrapped mode
+// (with at most 4 bytes per column); used when only the visible region is highlighted.
+static void edit_visible_range( ic_env_t* env, editor_t* eb, ssize_t* from, ssize_t* to ) {
+  const char* s = sbuf_string(eb->input);
+  const ssize_t len = sbuf_len(eb->input);
+  const ssize_t extent = 4 * eb->termw * term_get_height(env->term);
+  ssize_t start = (eb->pos > extent ? eb->pos - extent : 0);
+  ssize_t end   = (len - eb->pos > extent ? eb->pos + extent : len);
+  while (start > 0 && utf8_is_cont((uint8_t)s[start])) { start--; }
+  while (end < len && utf8_is_cont((uint8_t)s[end])) { end++; }
+  *from = start;
+  *to = end;
+}
+
+
+//-------------------------------------------------------------
+// Refresh the edit line
+//-------------------------------------------------------------
+
+// debug overlay with the output of the previous frame and the key latency
+static void edit_append_stats_overlay(ic_env_t* env, editor_t* eb, stringbuf_t* extra) {
+  const ic_stats_t* stats = eb->stats;
+  const ic_stat_output_t* frame = &stats->frame;
+  const ic_stat_hist_t* keys = &stats->phases[IC_STAT_KEY];
+  char buf[256];
+  snprintf(buf, sizeof(buf), 
+            "[ic-info]frame %llu: %llu bytes, %llu writes, esc: %llu sgr, %llu cursor, %llu erase | key p50 %lluus, p99 %lluus[/ic-info]",
+            (unsigned long long)stats->frames, (unsigned long long)frame->bytes, (unsigned long long)frame->writes, 
+            (unsigned long long)frame->esc_sgr, (unsigned long long)frame->esc_cursor, (unsigned long long)frame->esc_erase,
+            (unsigned long long)ic_stat_percentile(keys, 0.50), (unsigned long long)ic_stat_percentile(keys, 0.99));
+  if (sbuf_len(extra) > 0 && sbuf_string(extra)[sbuf_len(extra)-1] != '\n') {
+    attrbuf_append_n(extra, eb->attrs_extra, "\n", 1, attr_none());
+  }
+  bbcode_append(env->bbcode, buf, extra, eb->attrs_extra);
+}
+
 static void edit_refresh(ic_env_t* env, editor_t* eb) 
 {
+  const ic_stat_output_t output_start = *term_get_counters(env->term);
+
   // calculate the new cursor row and total rows needed
   ssize_t promptw, cpromptw;
   edit_get_prompt_width( env, eb, false, &promptw, &cpromptw );
   
-  if (eb->attrs != NULL) {
-    highlight( env->mem, env->bbcode, sbuf_string(eb->input), eb->attrs, 
-                 (env->no_highlight ? NULL : env->highlighter), env->highlighter_arg );
+  if (eb->attrs != NULL && !edit_highlight_background(env, eb)) {   // not on a worker thread?
+    int64_t start = ic_time_us();
+    if (eb->degrade >= DEGRADE_HIGHLIGHT) {
+      ssize_t from, to;
+      edit_visible_range(env, eb, &from, &to);
+      highlight_range( eb->mem, env->bbcode, sbuf_string(eb->input), sbuf_len(eb->input), from, to, eb->attrs, 
+                         (env->no_highlight ? NULL : env->highlighter), env->highlighter_arg );
+      edit_stage_done(eb, STAGE_HIGHLIGHT, start, to - from);
+    }
+    else {
+      highlight( eb->mem, env->bbcode, sbuf_string(eb->input), eb->attrs, 
+                   (env->no_highlight ? NULL : env->highlighter), env->highlighter_arg );
+      edit_stage_done(eb, STAGE_HIGHLIGHT, start, sbuf_len(eb->input));
+    }
   }
 
   // highlight matching braces
-  if (eb->attrs != NULL && !env->no_bracematch) {
+  if (eb->attrs != NULL && !env->no_bracematch && eb->degrade < DEGRADE_BRACES) {
+    int64_t start = ic_time_us();
     highlight_match_braces(sbuf_string(eb->input), eb->attrs, eb->pos, ic_env_get_match_braces(env),  
                               bbcode_style(env->bbcode,"ic-bracematch"), bbcode_style(env->bbcode,"ic-error"));
+    edit_stage_done(eb, STAGE_BRACES, start, sbuf_len(eb->input));
   }
+  const int64_t render_start = ic_time_us();
 
   // insert hint  
   if (sbuf_len(eb->hint) > 0) {
@@ -283,19 +690,36 @@ static void edit_refresh(ic_env_t* env, editor_t* eb)
 
   // render extra (like a completion menu)
   stringbuf_t* extra = NULL;
-  if (sbuf_len(eb->extra) > 0) {
+  if (sbuf_len(eb->extra) > 0 || env->stats_overlay) {
     extra = sbuf_new(eb->mem);
     if (extra != NULL) {
       if (sbuf_len(eb->hint_help) > 0) {
         bbcode_append(env->bbcode, sbuf_string(eb->hint_help), extra, eb->attrs_extra);
       }
       bbcode_append(env->bbcode, sbuf_string(eb->extra), extra, eb->attrs_extra);
+      if (env->stats_overlay) { edit_append_stats_overlay(env, eb, extra); }
     }
   }
 
   // calculate rows and row/col position
+  const ssize_t termh = term_get_height(env->term);
   rowcol_t rc = { 0 };
-  const ssize_t rows_input = sbuf_get_rc_at_pos( eb->input, eb->termw, promptw, cpromptw, eb->pos, &rc );
+  ssize_t start = 0;   // offset where the layout starts
+  hscroll_view_t hview;
+  ssize_t rows_input;
+  ssize_t cur_promptw;
+  if (env->hscroll) {
+    edit_hscroll_layout( env, eb, eb->termw, promptw, cpromptw, &hview );
+    rows_input  = hview.rows;
+    rc.row      = hview.cur_row;
+    rc.col      = hview.cur_col;
+    cur_promptw = (rc.row == 0 && hview.at_top ? promptw : cpromptw);
+  }
+  else {
+    // only lay out the lines around the cursor that can be visible; rows are relative to `start`
+    rows_input  = sbuf_get_rc_at_pos_near( eb->input, eb->termw, termh, promptw, cpromptw, eb->pos, &rc, &start );
+    cur_promptw = (rc.row == 0 && start == 0 ? promptw : cpromptw);
+  }
   rowcol_t rc_extra = { 0 };
   ssize_t rows_extra = 0;
   if (extra != NULL) { 
@@ -305,7 +729,6 @@ static void edit_refresh(ic_env_t* env, editor_t* eb)
   debug_msg("edit: refresh: rows %zd, cursor: %zd,%zd (previous rows %zd, cursor row %zd)\n", rows, rc.row, rc.col, eb->cur_rows, eb->cur_row);
   
   // only render at most terminal height rows
-  const ssize_t termh = term_get_height(env->term);
   ssize_t first_row = 0;                 // first visible row 
   ssize_t last_row = rows - 1;           // last visible row
   if (rows > termh) {
@@ -314,8 +737,9 @@ static void edit_refresh(ic_env_t* env, editor_t* eb)
     last_row = first_row + termh - 1;
   }
   assert(last_row - first_row < termh);
+  const int64_t layout_done = edit_stat_done(eb, IC_STAT_LAYOUT, render_start);
   
-  // reduce flicker
+  // render the frame into a single (synchronized) write to reduce flicker
   buffer_mode_t bmode = term_set_buffer_mode(env->term, BUFFERED);        
 
   // back up to the first line
@@ -324,12 +748,17 @@ static void edit_refresh(ic_env_t* env, editor_t* eb)
   // term_clear_lines_to_end(env->term);  // gives flicker in old Windows cmd prompt 
 
   // render rows
-  edit_refresh_rows( env, eb, eb->input, eb->attrs, promptw, cpromptw, false, first_row, last_row );  
+  if (env->hscroll) {
+    edit_hscroll_refresh_rows( env, eb, &hview, promptw, cpromptw, first_row, last_row );
+  }
+  else {
+    edit_refresh_rows( env, eb, eb->input, eb->attrs, promptw, cpromptw, false, start, first_row, last_row );  
+  }
   if (rows_extra > 0) {
     assert(extra != NULL);
     const ssize_t first_rowx = (first_row > rows_input ? first_row - rows_input : 0);
     const ssize_t last_rowx = last_row - rows_input; assert(last_rowx >= 0);
-    edit_refresh_rows(env, eb, extra, eb->attrs_extra, 0, 0, true, first_rowx, last_rowx);
+    edit_refresh_rows(env, eb, extra, eb->attrs_extra, 0, 0, true, 0, first_rowx, last_rowx);
   }
     
   // overwrite trailing rows we do not use anymore  
@@ -347,24 +776,38 @@ static void edit_refresh(ic_env_t* env, editor_t* eb)
   // move cursor back to edit position
   term_start_of_line(env->term);
   term_up(env->term, first_row + rrows - 1 - rc.row );
-  term_right(env->term, rc.col + (rc.row == 0 ? promptw : cpromptw));
+  term_right(env->term, rc.col + cur_promptw);
 
-  // and refresh
-  term_flush(env->term);
-
-  // stop buffering
+  // stop buffering; this writes the whole frame at once
+  const int64_t flush_start = edit_stat_done(eb, IC_STAT_RENDER, layout_done);
   term_set_buffer_mode(env->term, bmode);
+  edit_stat_done(eb, IC_STAT_FLUSH, flush_start);
+  stats_output_diff(term_get_counters(env->term), &output_start, &eb->stats->frame);
+  if (eb->stats->frame.bytes > eb->stats->frame_bytes_max) { eb->stats->frame_bytes_max = eb->stats->frame.bytes; }
+  ic_trace(frame, rows, eb->stats->frame.bytes);
 
   // restore input by removing the hint
   sbuf_delete_at(eb->input, eb->pos, sbuf_len(eb->hint));
   sbuf_delete_at(eb->extra, 0, sbuf_len(eb->hint_help));
-  attrbuf_clear(eb->attrs);
+  if (eb->degrade >= DEGRADE_HIGHLIGHT) {
+    // keep the attributes sized to the input so the next frame only resets the visible range
+    attrbuf_delete_at(eb->attrs, eb->pos, sbuf_len(eb->hint));
+  }
+  else {
+    attrbuf_clear(eb->attrs);
+  }
   attrbuf_clear(eb->attrs_extra);
   sbuf_free(extra);
 
   // update previous
   eb->cur_rows = rows;
   eb->cur_row = rc.row;
+
+  // adapt the render quality for the next frame
+  eb->stats->frames++;
+  if (eb->degrade > DEGRADE_NONE) { eb->stats->frames_degraded++; }
+  edit_stage_done(eb, STAGE_RENDER, render_start, sbuf_len(eb->input));
+  edit_degrade_update(eb);
 }
 
 // clear current output
@@ -393,12 +836,33 @@ static void edit_clear_screen(ic_env_t* env, editor_t* eb ) {
 }
 
 
+#define IC_RESIZE_DEBOUNCE_MS  (50)    // coalesce resize events that follow each other within this time
+#define IC_RESIZE_MAX_WAIT_MS  (250)   // but reflow at least this often during a continuous resize
+
+// Wait for a burst of resize events (like when dragging a window edge) to settle.
+// Returns the minimal width seen in between (or 0 if unknown).
+static ssize_t edit_resize_settle(ic_env_t* env) {
+  ssize_t minw = term_peek_width(env->term);
+  const int64_t start = ic_time_us();
+  while (ic_time_us() - start < 1000*IC_RESIZE_MAX_WAIT_MS && tty_term_resize_wait(env->tty, IC_RESIZE_DEBOUNCE_MS)) {
+    const ssize_t w = term_peek_width(env->term);
+    if (w > 0 && (minw <= 0 || w < minw)) { minw = w; }
+  }
+  return minw;
+}
+
 // refresh after a terminal window resized (but before doing further edit operations!)
 static bool edit_resize(ic_env_t* env, editor_t* eb ) {
+  // reflow once at the final size of a burst of resizes
+  ssize_t minw = edit_resize_settle(env);
+
   // update dimensions
   term_update_dim(env->term);
   ssize_t newtermw = term_get_width(env->term);
-  if (eb->termw == newtermw) return false;
+  ic_trace(resize, newtermw, term_get_height(env->term));
+  tty_record_size(env->tty, newtermw, term_get_height(env->term));
+  if (minw <= 0 || minw > newtermw) { minw = newtermw; }
+  if (eb->termw == newtermw && minw == newtermw) return false;
   
   // recalculate the row layout assuming the hardwrapping for the new terminal width
   ssize_t promptw, cpromptw;
@@ -417,13 +881,27 @@ static bool edit_resize(ic_env_t* env, editor_t* eb ) {
     }
   }
   rowcol_t rc = { 0 };
-  const ssize_t rows_input = sbuf_get_wrapped_rc_at_pos( eb->input, eb->termw, newtermw, promptw, cpromptw, eb->pos, &rc );
+  const ssize_t rows_input = (env->hscroll 
+                               ? edit_hscroll_wrapped_rows( env, eb, eb->termw, newtermw, promptw, cpromptw, &rc )
+                               : sbuf_get_wrapped_rc_at_pos( eb->input, eb->termw, newtermw, promptw, cpromptw, eb->pos, &rc ));
   rowcol_t rc_extra = { 0 };
   ssize_t rows_extra = 0;
   if (extra != NULL) {
     rows_extra = sbuf_get_wrapped_rc_at_pos(extra, eb->termw, newtermw, 0, 0, 0 /*pos*/, &rc_extra);
   }  
   ssize_t rows = rows_input + rows_extra;
+  if (minw < newtermw) {
+    // the terminal may have wrapped our output at a narrower intermediate width; 
+    // ensure we clear all rows that this could have used
+    rowcol_t rc_min = { 0 };
+    ssize_t rows_min = (env->hscroll 
+                         ? edit_hscroll_wrapped_rows( env, eb, eb->termw, minw, promptw, cpromptw, &rc_min )
+                         : sbuf_get_wrapped_rc_at_pos( eb->input, eb->termw, minw, promptw, cpromptw, eb->pos, &rc_min ));
+    if (extra != NULL) {
+      rows_min += sbuf_get_wrapped_rc_at_pos(extra, eb->termw, minw, 0, 0, 0 /*pos*/, &rc_min);
+    }
+    if (rows_min > rows) { rows = rows_min; }
+  }
   debug_msg("edit: resize: new rows: %zd, cursor row: %zd (previous: rows: %zd, cursor row %zd)\n", rows, rc.row, eb->cur_rows, eb->cur_row);
   
   // update the newly calculated row and rows
@@ -432,66 +910,76 @@ static bool edit_resize(ic_env_t* env, editor_t* eb ) {
     eb->cur_rows = rows;
   }
   eb->termw = newtermw;     
-  edit_refresh(env,eb); 
 
-  // remove hint again
+  // remove hint again (as `edit_refresh` inserts it as well)
   sbuf_delete_at(eb->input, eb->pos, sbuf_len(eb->hint));
   sbuf_free(extra);
+  edit_refresh(env,eb); 
   return true;
 } 
 
-static void editor_append_hint_help(editor_t* eb, const char* help) {
-  sbuf_clear(eb->hint_help);
+static void editor_append_hint_help(stringbuf_t* hint_help, const char* help) {
+  sbuf_clear(hint_help);
   if (help != NULL) {
-    sbuf_replace(eb->hint_help, "[ic-info]");
-    sbuf_append(eb->hint_help, help);
-    sbuf_append(eb->hint_help, "[/ic-info]\n");
+    sbuf_replace(hint_help, "[ic-info]");
+    sbuf_append(hint_help, help);
+    sbuf_append(hint_help, "[/ic-info]\n");
   }
 }
 
+// Generate a hint for `input` at `pos` into `hint` and `hint_help` using the completions `cms`.
+// This may run on a worker thread (see `edit_hint_submit`) so it only uses `mem` and `cms`.
+static void edit_generate_hint(ic_env_t* env, alloc_t* mem, completions_t* cms, const char* input, ssize_t pos,
+                                 stringbuf_t* hint, stringbuf_t* hint_help) {
+  ssize_t count = completions_generate(env, cms, input, pos, 2);
+  if (count != 1) return;
+  const char* help = NULL;
+  const char* first_hint = completions_get_hint(cms, 0, &help);
+  if (first_hint == NULL) return;
+  sbuf_replace(hint, first_hint); 
+  editor_append_hint_help(hint_help, help);
+  // do auto-tabbing?
+  if (!env->complete_autotab) return;
+  stringbuf_t* sb = sbuf_new(mem);  // temporary buffer for completion
+  if (sb == NULL) return;
+  sbuf_replace( sb, input ); 
+  const char* extra_hint = first_hint;
+  do {
+    ssize_t newpos = sbuf_insert_at( sb, extra_hint, pos );
+    if (newpos <= pos) break;
+    pos = newpos;
+    count = completions_generate(env, cms, sbuf_string(sb), pos, 2);
+    if (count == 1) {
+      const char* extra_help = NULL;
+      extra_hint = completions_get_hint(cms, 0, &extra_help);
+      if (extra_hint != NULL) {
+        editor_append_hint_help(hint_help, extra_help);
+        sbuf_append(hint, extra_hint);
+      }
+    }
+  }
+  while(count == 1);       
+  sbuf_free(sb);
+}
+
+static bool edit_hint_submit(ic_env_t* env, editor_t* eb);
+
 // refresh with possible hint
 static void edit_refresh_hint(ic_env_t* env, editor_t* eb) {
-  if (env->no_hint || env->hint_delay > 0) {
+  const bool no_hint = (env->no_hint || eb->degrade >= DEGRADE_HINT);
+  if (no_hint || env->hint_delay > 0 || env->pool != NULL) {
     // refresh without hint first
     edit_refresh(env, eb);
-    if (env->no_hint) return;
+    if (no_hint) return;
   }
+
+  // generate the hint in the background? (it is displayed once it is done)
+  if (edit_hint_submit(env, eb)) return;
     
-  // and see if we can construct a hint (displayed after a delay)
-  ssize_t count = completions_generate(env, env->completions, sbuf_string(eb->input), eb->pos, 2);
-  if (count == 1) {
-    const char* help = NULL;
-    const char* hint = completions_get_hint(env->completions, 0, &help);
-    if (hint != NULL) {
-      sbuf_replace(eb->hint, hint); 
-      editor_append_hint_help(eb, help);
-      // do auto-tabbing?
-      if (env->complete_autotab) {
-        stringbuf_t* sb = sbuf_new(env->mem);  // temporary buffer for completion
-        if (sb != NULL) { 
-          sbuf_replace( sb, sbuf_string(eb->input) ); 
-          ssize_t pos = eb->pos;
-          const char* extra_hint = hint;
-          do {
-            ssize_t newpos = sbuf_insert_at( sb, extra_hint, pos );
-            if (newpos <= pos) break;
-            pos = newpos;
-            count = completions_generate(env, env->completions, sbuf_string(sb), pos, 2);
-            if (count == 1) {
-              const char* extra_help = NULL;
-              extra_hint = completions_get_hint(env->completions, 0, &extra_help);
-              if (extra_hint != NULL) {
-                editor_append_hint_help(eb, extra_help);
-                sbuf_append(eb->hint, extra_hint);
-              }
-            }
-          }
-          while(count == 1);       
-          sbuf_free(sb);
-        }          
-      }      
-    }
-  }
+  // otherwise see if we can construct a hint now (displayed after a delay)
+  const int64_t start = ic_time_us();
+  edit_generate_hint(env, env->mem, env->completions, sbuf_string(eb->input), eb->pos, eb->hint, eb->hint_help);
+  edit_stage_done(eb, STAGE_HINT, start, sbuf_len(eb->input));
 
   if (env->hint_delay <= 0) {
     // refresh with hint directly
@@ -499,6 +987,208 @@ static void edit_refresh_hint(ic_env_t* env, editor_t* eb) {
   }
 }
 
+//-------------------------------------------------------------
+// Background tasks
+//
+// With `ic_enable_background` the completer and highlighter run on
+// worker threads. There is at most one completer task and one
+// highlight task at a time so user callbacks never run concurrently
+// with themselves; their `done` functions run on this thread when
+// the tty reports `KEY_EVENT_TASK` (see `edit_poll_tasks`).
+//-------------------------------------------------------------
+
+#define IC_HIGHLIGHT_WAIT_MS  (8)   // wait at most this long for a highlight before rendering
+
+// run the `done` functions of finished tasks and refresh if needed
+static void edit_poll_tasks(ic_env_t* env, editor_t* eb) {
+  pool_poll(env->pool);
+  if (eb->task_refresh) {
+    eb->task_refresh = false;
+    edit_refresh(env, eb);
+  }
+}
+
+static void edit_highlight_done(void* arg, const char* input, attrbuf_t* attrs) {
+  editor_t* eb = (editor_t*)arg;
+  eb->hl_task = NULL;
+  if (attrs == NULL) return;  // cancelled
+  sbuf_replace(eb->hl_input, input);
+  attrbuf_clear(eb->hl_attrs);
+  attrbuf_copy_from(eb->hl_attrs, attrs, attrbuf_len(attrs));
+  if (!eb->hl_waiting) { eb->task_refresh = true; }  // render the new highlighting (or start a new one)
+}
+
+// Highlight the input on a worker thread; returns `false` if not enabled.
+// If the highlighter is not done within a few milliseconds, the previous
+// highlighting is used for the common prefix until the result arrives.
+static bool edit_highlight_background(ic_env_t* env, editor_t* eb) {
+  if (env->pool == NULL || env->no_highlight || env->highlighter == NULL || eb->hl_input == NULL || eb->hl_attrs == NULL) return false;
+  const char* input = sbuf_string(eb->input);
+  const ssize_t len = sbuf_len(eb->input);
+  // at most twice as the pending task may be for an older input
+  for (int i = 0; i < 2 && strcmp(sbuf_string(eb->hl_input), input) != 0; i++) {
+    if (eb->hl_task == NULL) {
+      eb->hl_task = highlight_task_submit(env->pool, eb->mem, env->bbcode, input, 
+                                            env->highlighter, env->highlighter_arg, &edit_highlight_done, eb);
+      if (eb->hl_task == NULL) return false;
+    }
+    eb->hl_waiting = true;
+    const bool done = pool_wait(env->pool, eb->hl_task, IC_HIGHLIGHT_WAIT_MS);
+    eb->hl_waiting = false;
+    if (!done) break;  // refresh once it is done
+  }
+  const char* prev = sbuf_string(eb->hl_input);
+  ssize_t n = 0;
+  while (n < len && prev[n] == input[n]) { n++; }
+  attrbuf_set_at(eb->attrs, 0, len, attr_none());
+  attrbuf_copy_from(eb->attrs, eb->hl_attrs, n);
+  return true;
+}
+
+typedef struct complete_job_s {
+  ic_env_t*      env;
+  editor_t*      eb;
+  ic_completer_fun_t* completer;
+  void*          completer_arg;
+  char*          input;          // copy of the input (in the editor memory)
+  ssize_t        pos;
+  ssize_t        max;            // maximal number of completions, or 0 for a hint
+  completions_t* result;         // in the task memory
+  stringbuf_t*   hint;
+  stringbuf_t*   hint_help;
+} complete_job_t;
+
+static void edit_complete_work(pool_task_t* task, void* arg) {
+  complete_job_t* job = (complete_job_t*)arg;
+  if (pool_task_cancelled(task)) return;
+  alloc_t* mem = pool_task_mem(task);
+  completions_t* cms = completions_new_task(mem, job->completer, job->completer_arg, task);
+  if (cms == NULL) return;
+  if (job->max > 0) {
+    completions_generate(job->env, cms, job->input, job->pos, job->max);
+    job->result = cms;
+    return;
+  }
+  job->hint = sbuf_new(mem);
+  job->hint_help = sbuf_new(mem);
+  if (job->hint != NULL && job->hint_help != NULL) {
+    edit_generate_hint(job->env, mem, cms, job->input, job->pos, job->hint, job->hint_help);
+  }
+  completions_free(cms);
+}
+
+static void edit_complete_done(pool_task_t* task, void* arg) {
+  complete_job_t* job = (complete_job_t*)arg;
+  ic_env_t* env = job->env;
+  editor_t* eb = job->eb;
+  eb->complete_task = NULL;
+  const bool cancelled = pool_task_cancelled(task);
+  if (job->max > 0) {
+    if (!cancelled && job->result != NULL) { completions_assign(env->completions, job->result); }
+  }
+  else if (!cancelled && job->hint != NULL && job->hint_help != NULL && sbuf_len(job->hint) > 0 &&
+            eb->pos == job->pos && strcmp(sbuf_string(eb->input), job->input) == 0) {
+    sbuf_replace(eb->hint, sbuf_string(job->hint));
+    sbuf_replace(eb->hint_help, sbuf_string(job->hint_help));
+    if (env->hint_delay <= 0) { eb->task_refresh = true; }  // otherwise displayed after the delay
+  }
+  // free the results before the task memory is released
+  completions_free(job->result);
+  sbuf_free(job->hint);
+  sbuf_free(job->hint_help);
+  mem_free(eb->mem, job->input);
+  mem_free(eb->mem, job);
+  if (eb->hint_resubmit) {
+    eb->hint_resubmit = false;
+    edit_hint_submit(env, eb);
+  }
+}
+
+static pool_task_t* edit_complete_submit(ic_env_t* env, editor_t* eb, ssize_t max) {
+  complete_job_t* job = mem_zalloc_tp(eb->mem, complete_job_t);
+  if (job == NULL) return NULL;
+  job->env = env;
+  job->eb  = eb;
+  completions_get_completer(env->completions, &job->completer, &job->completer_arg);
+  job->input = mem_strdup(eb->mem, sbuf_string(eb->input));
+  job->pos = eb->pos;
+  job->max = max;
+  pool_task_t* task = (job->input == NULL ? NULL : pool_submit(env->pool, &edit_complete_work, &edit_complete_done, job));
+  if (task == NULL) {
+    mem_free(eb->mem, job->input);
+    mem_free(eb->mem, job);
+  }
+  return task;
+}
+
+// Generate a hint in the background; returns `false` if not enabled.
+static bool edit_hint_submit(ic_env_t* env, editor_t* eb) {
+  if (env->pool == NULL) return false;
+  if (eb->complete_task != NULL) {
+    // wait for the current completer to stop first
+    pool_cancel(env->pool, eb->complete_task);
+    eb->hint_resubmit = true;
+    return true;
+  }
+  eb->complete_task = edit_complete_submit(env, eb, 0);
+  return (eb->complete_task != NULL);
+}
+
+// Cancel a pending hint (on a key press)
+static void edit_hint_cancel(ic_env_t* env, editor_t* eb) {
+  eb->hint_resubmit = false;
+  if (eb->complete_task != NULL) { pool_cancel(env->pool, eb->complete_task); }
+}
+
+// Generate completions into `env->completions`. With background threads the
+// completer runs on a worker while we keep reading keys: a key press cancels
+// it and is pushed back to be processed as usual (and -1 is returned).
+static ssize_t edit_completions_generate(ic_env_t* env, editor_t* eb, ssize_t max) {
+  if (env->pool != NULL && eb->complete_task != NULL) {
+    edit_hint_cancel(env, eb);
+    pool_wait(env->pool, eb->complete_task, -1);
+  }
+  pool_task_t* task = (env->pool == NULL ? NULL : edit_complete_submit(env, eb, max));
+  if (task == NULL) {
+    return completions_generate(env, env->completions, sbuf_string(eb->input), eb->pos, max);
+  }
+  eb->complete_task = task;
+  if (pool_wait(env->pool, task, IC_HIGHLIGHT_WAIT_MS)) {
+    return completions_count(env->completions);
+  }
+  term_flush(env->term);
+  while (eb->complete_task != NULL) {
+    const code_t c = tty_read(env->tty);
+    if (tty_term_resize_event(env->tty)) {
+      edit_resize(env, eb);
+    }
+    if (c == KEY_EVENT_TASK) {
+      edit_poll_tasks(env, eb);
+    }
+    else if (c != KEY_EVENT_RESIZE) {
+      pool_cancel(env->pool, task);
+      tty_code_pushback(env->tty, c);
+      return -1;
+    }
+  }
+  return completions_count(env->completions);
+}
+
+// Wait for all background tasks of the editor (at the end of an edit)
+static void edit_tasks_done(ic_env_t* env, editor_t* eb) {
+  if (env->pool == NULL) return;
+  eb->hint_resubmit = false;
+  if (eb->complete_task != NULL) {
+    pool_cancel(env->pool, eb->complete_task);
+    pool_wait(env->pool, eb->complete_task, -1);
+  }
+  if (eb->hl_task != NULL) {
+    pool_cancel(env->pool, eb->hl_task);
+    pool_wait(env->pool, eb->hl_task, -1);
+  }
+  eb->task_refresh = false;
+}
+
 //-------------------------------------------------------------
 // Edit operations
 //-------------------------------------------------------------
@@ -520,8 +1210,6 @@ static void edit_cursor_left(ic_env_t* env, editor_t* eb) {
   ssize_t cwidth = 1;
   ssize_t prev = sbuf_prev(eb->input,eb->pos,&cwidth);
   if (prev < 0) return;
-  rowcol_t rc;
-  edit_get_rowcol( env, eb, &rc);  
   eb->pos = prev;  
   edit_refresh(env,eb);  
 }
@@ -530,8 +1218,6 @@ static void edit_cursor_right(ic_env_t* env, editor_t* eb) {
   ssize_t cwidth = 1;
   ssize_t next = sbuf_next(eb->input,eb->pos,&cwidth);
   if (next < 0) return;
-  rowcol_t rc;
-  edit_get_rowcol( env, eb, &rc);  
   eb->pos = next;  
   edit_refresh(env,eb);
 }
@@ -589,25 +1275,60 @@ static void edit_cursor_to_end(ic_env_t* env, editor_t* eb) {
 }
 
 
+// In horizontal scroll mode each line is a single row: move to the same column in the 
+// previous (or next) line by only scanning the cursor line and the target line.
+// Returns `false` if there is no such line.
+static bool edit_hscroll_cursor_row( ic_env_t* env, editor_t* eb, bool up ) {
+  const char*   s   = sbuf_string(eb->input);
+  const ssize_t len = sbuf_len(eb->input);
+  const ssize_t ls  = edit_hscroll_line_start(eb, s, len);
+  ssize_t target;
+  if (up) {
+    if (ls == 0) return false;
+    target = str_line_start(s, ls - 1);
+  }
+  else {
+    const ssize_t le = str_line_end(s, len, eb->pos);
+    if (le >= len) return false;
+    target = le + 1;
+  }
+  ssize_t col;
+  str_take_line_fit(s, eb->pos, ls, eb->pos - ls, &col);   // column of the cursor (at most one column per byte)
+  ssize_t w;
+  eb->pos = target + str_take_line_fit(s, len, target, col, &w);
+  edit_refresh(env, eb);
+  return true;
+}
+
 static void edit_cursor_row_up(ic_env_t* env, editor_t* eb) {
+  if (env->hscroll) {
+    if (!edit_hscroll_cursor_row(env, eb, true)) { edit_history_prev(env, eb); }
+    return;
+  }
   rowcol_t rc;
-  edit_get_rowcol( env, eb, &rc);
+  ssize_t start;
+  edit_get_rowcol_near( env, eb, &rc, &start);
   if (rc.row == 0) {
     edit_history_prev(env,eb);
   }
   else {
-    edit_set_pos_at_rowcol( env, eb, rc.row - 1, rc.col );
+    edit_set_pos_at_rowcol( env, eb, start, rc.row - 1, rc.col );
   }
 }
 
 static void edit_cursor_row_down(ic_env_t* env, editor_t* eb) {
+  if (env->hscroll) {
+    if (!edit_hscroll_cursor_row(env, eb, false)) { edit_history_next(env, eb); }
+    return;
+  }
   rowcol_t rc;
-  ssize_t rows = edit_get_rowcol( env, eb, &rc);
+  ssize_t start;
+  ssize_t rows = edit_get_rowcol_near( env, eb, &rc, &start);
   if (rc.row + 1 >= rows) {
     edit_history_next(env,eb);
   }
   else {
-    edit_set_pos_at_rowcol( env, eb, rc.row + 1, rc.col );
+    edit_set_pos_at_rowcol( env, eb, start, rc.row + 1, rc.col );
   }
 }
 
@@ -848,11 +1569,12 @@ static char* edit_line( ic_env_t* env, const char* prompt_text )
   // set up an edit buffer
   editor_t eb;
   memset(&eb, 0, sizeof(eb));
-  eb.mem      = env->mem;
-  eb.input    = sbuf_new(env->mem);
-  eb.extra    = sbuf_new(env->mem);
-  eb.hint     = sbuf_new(env->mem);
-  eb.hint_help= sbuf_new(env->mem);
+  eb.mem      = mem_tagged(env->mem, IC_MEM_RENDER);
+  eb.stats    = &env->stats;
+  eb.input    = sbuf_new(eb.mem);
+  eb.extra    = sbuf_new(eb.mem);
+  eb.hint     = sbuf_new(eb.mem);
+  eb.hint_help= sbuf_new(eb.mem);
   eb.termw    = term_get_width(env->term);  
   eb.pos      = 0;
   eb.cur_rows = 1; 
@@ -868,21 +1590,38 @@ static char* edit_line( ic_env_t* env, const char* prompt_text )
 
   // caching
   if (!(env->no_highlight && env->no_bracematch)) {
-    eb.attrs = attrbuf_new(env->mem);
-    eb.attrs_extra = attrbuf_new(env->mem);
+    eb.attrs = attrbuf_new(eb.mem);
+    eb.attrs_extra = attrbuf_new(eb.mem);
+  }
+  if (env->pool != NULL && eb.attrs != NULL) {
+    eb.hl_input = sbuf_new(eb.mem);
+    eb.hl_attrs = attrbuf_new(eb.mem);
   }
   
   // show prompt
+  tty_record_size(env->tty, eb.termw, term_get_height(env->term));
   edit_write_prompt(env, &eb, 0, false);   
 
   // always a history entry for the current input
   history_push(env->history, "");
 
   // process keys
-  code_t c;          // current key code
+  code_t c;            // current key code
+  int64_t key_start = 0;  // time the current key arrived (0 if none)
+  int64_t op_start  = 0;  // start of the edit operation for the current key
   while(true) {    
-    // read a character
+    // flush the frame; this completes the handling of the previous key
     term_flush(env->term);
+    if (key_start > 0) {
+      edit_stat_done(&eb, IC_STAT_KEY, key_start);
+      eb.stats->keys++;
+      key_start = 0;
+    }
+    term_revalidate_caps(env->term);  // once, if cached probe results were used
+    trace_flush();                     // write out trace events while we are idle
+
+    // read a character
+    const int64_t wait_start = ic_time_us();
     if (env->hint_delay <= 0 || sbuf_len(eb.hint) == 0) {
       // blocking read
       c = tty_read(env->tty);
@@ -897,22 +1636,39 @@ static char* edit_line( ic_env_t* env, const char* prompt_text )
         }
         c = tty_read(env->tty);
       }
-      else {
+      else if (c != KEY_EVENT_TASK) {
         // clear the pending hint if we got input before the delay expired
         sbuf_clear(eb.hint);
         sbuf_clear(eb.hint_help);
       }
     }
+    if (c == KEY_EVENT_TASK) {   // background tasks are done
+      edit_poll_tasks(env, &eb);
+      continue;
+    }
     
+    op_start  = ic_time_us();
+    key_start = tty_key_time(env->tty);
+    if (key_start < wait_start || key_start > op_start) { key_start = op_start; }
+    stats_add(&eb.stats->phases[IC_STAT_WAIT], key_start - wait_start);
+    stats_add(&eb.stats->phases[IC_STAT_DECODE], op_start - key_start);
+    ic_trace(key, c, op_start - key_start);
+    eb.op_cost = 0;
+
     // update terminal in case of a resize
     if (tty_term_resize_event(env->tty)) {
       edit_resize(env,&eb);            
     }
+    if (c == KEY_EVENT_RESIZE) {   // keep a current hint
+      key_start = 0;               // and do not count it as a key
+      continue;
+    }
 
     // clear hint only after a potential resize (so resize row calculations are correct)
     const bool had_hint = (sbuf_len(eb.hint) > 0);
     sbuf_clear(eb.hint);
     sbuf_clear(eb.hint_help);
+    edit_hint_cancel(env, &eb);
 
     // if the user tries to move into a hint with left-cursor or end, we complete it first
     if ((c == KEY_RIGHT || c == KEY_END) && had_hint) {
@@ -954,8 +1710,8 @@ static char* edit_line( ic_env_t* env, const char* prompt_text )
     // Editing Operations
     else switch(c) {
       // events
-      case KEY_EVENT_RESIZE:  // not used
-        edit_resize(env,&eb);
+      case KEY_EVENT_RESIZE:  // handled above
+      case KEY_EVENT_TASK:
         break;
       case KEY_EVENT_AUTOTAB:
         edit_generate_completions(env, &eb, true);
@@ -1099,6 +1855,14 @@ static char* edit_line( ic_env_t* env, const char* prompt_text )
       }
     }
 
+    // the edit operation; if it read further keys itself (like the completion menu) 
+    // we (approximately) measure from the last key read.
+    const int64_t last_key = tty_key_time(env->tty);
+    if (last_key > op_start) {
+      key_start = op_start = last_key;
+      eb.op_cost = 0;
+    }
+    stats_add(&eb.stats->phases[IC_STAT_EDIT], ic_time_us() - op_start - eb.op_cost);
   }
 
   // goto end
@@ -1109,6 +1873,11 @@ static char* edit_line( ic_env_t* env, const char* prompt_text )
   env->no_bracematch = true;
   edit_refresh(env,&eb);
   env->no_bracematch = bm;
+  edit_tasks_done(env, &eb);
+  if (key_start > 0) {
+    edit_stat_done(&eb, IC_STAT_KEY, key_start);
+    eb.stats->keys++;
+  }
   
   // save result
   char* res; 
@@ -1116,10 +1885,12 @@ static char* edit_line( ic_env_t* env, const char* prompt_text )
     res = NULL;
   }
   else if (!tty_is_utf8(env->tty)) {
-    res = sbuf_strdup_from_utf8(eb.input);
+    char* s = sbuf_strdup_from_utf8(eb.input);
+    res = mem_raw_strdup(env->mem, s);
+    mem_free(eb.mem, s);
   }
   else {
-    res = sbuf_strdup(eb.input);
+    res = mem_raw_strdup(env->mem, sbuf_string(eb.input));
   }
 
   // update history
@@ -1132,6 +1903,8 @@ static char* edit_line( ic_env_t* env, const char* prompt_text )
   editstate_done(env->mem, &eb.redo);
   attrbuf_free(eb.attrs);
   attrbuf_free(eb.attrs_extra);
+  attrbuf_free(eb.hl_attrs);
+  sbuf_free(eb.hl_input);
   sbuf_free(eb.input);
   sbuf_free(eb.extra);
   sbuf_free(eb.hint);
@@ -162,7 +162,11 @@ again:
   if (tty_term_resize_event(env->tty)) {
     edit_resize(env, eb);
   }
+  if (c == KEY_EVENT_TASK) {
+    edit_poll_tasks(env, eb);
+  }
   sbuf_clear(eb->extra);
+  if (c == KEY_EVENT_RESIZE || c == KEY_EVENT_TASK) goto again;  // stay in the menu
   
   // direct selection?
   if (c >= '1' && c <= '9') {
@@ -218,7 +222,8 @@ again:
     c = 0;
     if (more_available) {
       // generate all entries (up to the max (= 1000))
-      count = completions_generate(env, env->completions, sbuf_string(eb->input), eb->pos, IC_MAX_COMPLETIONS_TO_SHOW);
+      const ssize_t n = edit_completions_generate(env, eb, IC_MAX_COMPLETIONS_TO_SHOW);
+      if (n >= 0) { count = n; }   // or interrupted by a key
     }
     rowcol_t rc;
     edit_get_rowcol(env,eb,&rc);
@@ -254,7 +259,8 @@ again:
 static void edit_generate_completions(ic_env_t* env, editor_t* eb, bool autotab) {
   debug_msg( "edit: complete: %zd: %s\n", eb->pos, sbuf_string(eb->input) );
   if (eb->pos < 0) return;
-  ssize_t count = completions_generate(env, env->completions, sbuf_string(eb->input), eb->pos, IC_MAX_COMPLETIONS_TO_TRY);
+  ssize_t count = edit_completions_generate(env, eb, IC_MAX_COMPLETIONS_TO_TRY);
+  if (count < 0) return;  // interrupted by a key
   bool more_available = (count >= IC_MAX_COMPLETIONS_TO_TRY);
   if (count <= 0) {
     // no completions
@@ -24,6 +24,7 @@ static void edit_history_at(ic_env_t* env, editor_t* eb, int ofs )
   else {
     eb->history_idx += ofs;
     sbuf_replace(eb->input, entry);
+    editor_input_changed(eb);
     if (ofs > 0) {
       // at end of first line when scrolling up
       ssize_t end = sbuf_find_line_end(eb->input,0);
@@ -136,6 +137,7 @@ static void edit_history_search(ic_env_t* env, editor_t* eb, char* initial ) {
     sbuf_clear( eb->input );
     eb->pos = 0;
   }
+  editor_input_changed(eb);
 
   // Incremental search
 again:
@@ -160,7 +162,11 @@ again:
   if (tty_term_resize_event(env->tty)) {
     edit_resize(env, eb);
   }
+  if (c == KEY_EVENT_TASK) {
+    edit_poll_tasks(env, eb);
+  }
   sbuf_clear(eb->extra);
+  if (c == KEY_EVENT_RESIZE || c == KEY_EVENT_TASK) goto again;  // stay in the search
 
   // Process commands
   if (c == KEY_ESC || c == KEY_BELL /* ^G */ || c == KEY_CTRL_C) {
@@ -172,6 +178,7 @@ again:
     c = 0;
     editor_undo_forget(eb);
     sbuf_replace( eb->input, hentry );
+    editor_input_changed(eb);
     eb->pos = sbuf_len(eb->input);
     eb->modified = false;
     eb->history_idx = hidx;
@@ -16,6 +16,8 @@
 #include "history.h"
 #include "completions.h"
 #include "bbcode.h"
+#include "stats.h"
+#include "pool.h"
 
 //-------------------------------------------------------------
 // Environment
@@ -36,7 +38,8 @@ struct ic_env_s {
   const char*     match_braces;     // matching braces, e.g "()[]{}"
   const char*     auto_braces;      // auto insertion braces, e.g "()[]{}\"\"''"
   char            multiline_eol;    // character used for multiline input ("\") (set to 0 to disable)
-  bool            initialized;      // are we initialized?
+  bool            init_term;        // are the tty, term, and bbcode initialized?
+  bool            init_edit;        // are the history and completions initialized?
   bool            noedit;           // is rich editing possible (tty != NULL)
   bool            singleline_only;  // allow only single line editing?
   bool            complete_nopreview; // do not show completion preview for each selection in the completion menu?
@@ -48,12 +51,22 @@ struct ic_env_s {
   bool            no_bracematch;    // enable brace matching?
   bool            no_autobrace;     // enable automatic brace insertion?
   bool            no_lscolors;      // use LSCOLORS/LS_COLORS to colorize file name completions?
+  bool            hscroll;          // show each input line on a single horizontally scrolled row?
   long            hint_delay;       // delay before displaying a hint in milliseconds
+  bool            stats_dump;       // print the statistics at exit?
+  bool            stats_overlay;    // show output and latency statistics while editing?
+  ic_stats_t      stats;            // latency statistics (see `editline.c`)
+  pool_t*         pool;             // background worker threads (NULL if disabled)
+  long            background_threads; // number of worker threads when enabled
 };
 
 ic_private char*        ic_editline(ic_env_t* env, const char* prompt_text);
 
-ic_private ic_env_t*    ic_get_env(void);
+ic_private ic_env_t*    ic_get_env(void);         // subsystems are initialized lazily:
+ic_private void         ic_env_init_term(ic_env_t* env);  // tty, term, bbcode
+ic_private void         ic_env_init_edit(ic_env_t* env);  // history, completions (and term)
+ic_private ic_env_t*    ic_env_create_headless(vterm_t* vt);  // scripted input rendered to a virtual terminal
+ic_private void         ic_env_free_headless(ic_env_t* env);
 ic_private const char*  ic_env_get_auto_braces(ic_env_t* env);
 ic_private const char*  ic_env_get_match_braces(ic_env_t* env);
 
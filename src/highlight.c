@@ -11,6 +11,7 @@
 #include "stringbuf.h"
 #include "attr.h"
 #include "bbcode.h"
+#include "highlight.h"
 
 //-------------------------------------------------------------
 // Syntax highlighting
@@ -20,6 +21,7 @@ struct ic_highlight_env_s {
   attrbuf_t*    attrs;
   const char*   input;   
   ssize_t       input_len;     
+  ssize_t       offset;       // offset of `input` in the attributes
   bbcode_t*     bbcode;
   alloc_t*      mem;
   ssize_t       cached_upos;  // cached unicode position
@@ -27,21 +29,104 @@ struct ic_highlight_env_s {
 };
 
 
+static void highlight_run( alloc_t* mem, bbcode_t* bb, const char* s, ssize_t len, ssize_t offset, attrbuf_t* attrs, ic_highlight_fun_t* highlighter, void* arg ) {
+  ic_highlight_env_t henv;
+  henv.attrs = attrs;
+  henv.input = s;     
+  henv.input_len = len;
+  henv.offset = offset;
+  henv.bbcode = bb;
+  henv.mem = mem;
+  henv.cached_cpos = 0;
+  henv.cached_upos = 0;
+  (*highlighter)( &henv, s, arg );    
+}
+
 ic_private void highlight( alloc_t* mem, bbcode_t* bb, const char* s, attrbuf_t* attrs, ic_highlight_fun_t* highlighter, void* arg ) {
   const ssize_t len = ic_strlen(s);
   if (len <= 0) return;
   attrbuf_set_at(attrs,0,len,attr_none()); // fill to length of s
   if (highlighter != NULL) {
-    ic_highlight_env_t henv;
-    henv.attrs = attrs;
-    henv.input = s;     
-    henv.input_len = len;
-    henv.bbcode = bb;
-    henv.mem = mem;
-    henv.cached_cpos = 0;
-    henv.cached_upos = 0;
-    (*highlighter)( &henv, s, arg );    
+    highlight_run(mem, bb, s, len, 0, attrs, highlighter, arg);
+  }
+}
+
+// Only highlight `s[from,to)` (where `len` is the length of `s`); the highlighter sees just 
+// that part as its input. Used to highlight only the visible part of a large input: 
+// the attributes are kept sized across frames and only `[from,to)` is reset, so 
+// attributes outside the range are stale and should not be rendered.
+ic_private void highlight_range( alloc_t* mem, bbcode_t* bb, const char* s, ssize_t len, ssize_t from, ssize_t to, attrbuf_t* attrs, ic_highlight_fun_t* highlighter, void* arg ) {
+  attrbuf_resize(attrs,len);
+  if (len <= 0) return;
+  if (from < 0) from = 0;
+  if (to > len) to = len;
+  if (from >= to) return;
+  attrbuf_set_at(attrs,from,to - from,attr_none());
+  if (highlighter == NULL) return;
+  char* part = mem_strndup(mem, s + from, to - from);
+  if (part == NULL) return;
+  highlight_run(mem, bb, part, to - from, from, attrs, highlighter, arg);
+  mem_free(mem, part);
+}
+
+
+//-------------------------------------------------------------
+// Highlight in the background
+//-------------------------------------------------------------
+
+typedef struct highlight_job_s {
+  alloc_t*            mem;
+  const bbcode_t*     bbcode;        // only its styles are used (through a view)
+  char*               input;
+  ic_highlight_fun_t* highlighter;
+  void*               arg;
+  highlight_done_fun_t* done;
+  void*               done_arg;
+  attrbuf_t*          attrs;         // result (in the task memory)
+} highlight_job_t;
+
+static void highlight_task_work( pool_task_t* task, void* arg ) {
+  highlight_job_t* job = (highlight_job_t*)arg;
+  if (pool_task_cancelled(task)) return;
+  alloc_t* mem = pool_task_mem(task);
+  bbcode_t* bb = bbcode_new_view(mem, job->bbcode);
+  attrbuf_t* attrs = attrbuf_new(mem);
+  if (bb != NULL && attrs != NULL) {
+    highlight(mem, bb, job->input, attrs, job->highlighter, job->arg);
+    job->attrs = attrs;
+    attrs = NULL;
+  }
+  attrbuf_free(attrs);
+  bbcode_free(bb);
+}
+
+static void highlight_task_done( pool_task_t* task, void* arg ) {
+  highlight_job_t* job = (highlight_job_t*)arg;
+  (*job->done)(job->done_arg, job->input, (pool_task_cancelled(task) ? NULL : job->attrs));
+  attrbuf_free(job->attrs);  // before the task memory is released
+  mem_free(job->mem, job->input);
+  mem_free(job->mem, job);
+}
+
+ic_private pool_task_t* highlight_task_submit( pool_t* pool, alloc_t* mem, const bbcode_t* bb, const char* s, 
+                                               ic_highlight_fun_t* highlighter, void* arg, highlight_done_fun_t* done, void* done_arg ) 
+{
+  if (pool == NULL || highlighter == NULL || done == NULL) return NULL;
+  highlight_job_t* job = mem_zalloc_tp(mem, highlight_job_t);
+  if (job == NULL) return NULL;
+  job->mem = mem;
+  job->bbcode = bb;
+  job->input = mem_strdup(mem, s);
+  job->highlighter = highlighter;
+  job->arg = arg;
+  job->done = done;
+  job->done_arg = done_arg;
+  pool_task_t* task = (job->input == NULL ? NULL : pool_submit(pool, &highlight_task_work, &highlight_task_done, job));
+  if (task == NULL) {
+    mem_free(mem, job->input);
+    mem_free(mem, job);
   }
+  return task;
 }
 
 
@@ -100,7 +185,9 @@ static void highlight_attr(ic_highlight_env_t* henv, ssize_t pos, ssize_t count,
   if (henv==NULL) return;
   pos_adjust(henv,&pos,&count);
   if (pos < 0 || count <= 0) return;
-  attrbuf_update_at(henv->attrs, pos, count, attr);
+  if (pos + count > henv->input_len) { count = henv->input_len - pos; }
+  if (count <= 0) return;
+  attrbuf_update_at(henv->attrs, henv->offset + pos, count, attr);
 }
 
 ic_public void ic_highlight(ic_highlight_env_t* henv, long pos, long count, const char* style ) {
@@ -118,8 +205,8 @@ ic_public void ic_highlight_formatted(ic_highlight_env_t* henv, const char* s, c
     if (sbuf_len(out) != len) {
       debug_msg("highlight: formatted string content differs from the original input:\n  original: %s\n  formatted: %s\n", s, fmt);
     }
-    for( ssize_t i = 0; i < len; i++) {
-      attrbuf_update_at(henv->attrs, i, 1, attrbuf_attr_at(attrs,i));
+    for( ssize_t i = 0; i < len && i < henv->input_len; i++) {
+      attrbuf_update_at(henv->attrs, henv->offset + i, 1, attrbuf_attr_at(attrs,i));
     }
   }
   sbuf_free(out);
@@ -12,12 +12,21 @@
 #include "attr.h"
 #include "term.h"
 #include "bbcode.h"
+#include "pool.h"
 
 //-------------------------------------------------------------
 // Syntax highlighting
 //-------------------------------------------------------------
 
 ic_private void highlight( alloc_t* mem, bbcode_t* bb, const char* s, attrbuf_t* attrs, ic_highlight_fun_t* highlighter, void* arg );
+ic_private void highlight_range( alloc_t* mem, bbcode_t* bb, const char* s, ssize_t len, ssize_t from, ssize_t to, attrbuf_t* attrs, ic_highlight_fun_t* highlighter, void* arg );
+
+// Highlight on a worker thread: `done` is called on the main thread with the input and the
+// resulting attributes (which are NULL if the task was cancelled). Returns NULL on failure.
+typedef void (highlight_done_fun_t)( void* arg, const char* s, attrbuf_t* attrs );
+ic_private pool_task_t* highlight_task_submit( pool_t* pool, alloc_t* mem, const bbcode_t* bb, const char* s, 
+                                               ic_highlight_fun_t* highlighter, void* arg, highlight_done_fun_t* done, void* done_arg );
+
 ic_private void highlight_match_braces(const char* s, attrbuf_t* attrs, ssize_t cursor_pos, const char* braces, attr_t match_attr, attr_t error_attr);
 ic_private ssize_t find_matching_brace(const char* s, ssize_t cursor_pos, const char* braces, bool* is_balanced);
 
@@ -22,8 +22,14 @@ struct history_s {
   const char*  fname;         // history file
   alloc_t* mem;
   bool     allow_duplicates;   // allow duplicate entries?
+  pool_t*       pool;          // load in the background (if not NULL)
+  pool_task_t*  load_task;     // pending background load
+  pool_task_t*  task;          // set when loading in a worker (for cancellation)
 };
 
+static void history_sync( history_t* h );
+static void history_cancel_load( history_t* h );
+
 ic_private history_t* history_new(alloc_t* mem) {
   history_t* h = mem_zalloc_tp(mem,history_t);
   h->mem = mem;
@@ -32,6 +38,7 @@ ic_private history_t* history_new(alloc_t* mem) {
 
 ic_private void history_free(history_t* h) {
   if (h == NULL) return;
+  history_cancel_load(h);
   history_clear(h);
   if (h->len > 0) {
     mem_free( h->mem, h->elems );
@@ -49,7 +56,8 @@ ic_private bool history_enable_duplicates( history_t* h, bool enable ) {
   return prev;
 }
 
-ic_private ssize_t  history_count(const history_t* h) {
+ic_private ssize_t  history_count(history_t* h) {
+  history_sync(h);
   return h->count;
 }
 
@@ -107,19 +115,24 @@ static void history_remove_last_n( history_t* h, ssize_t n ) {
 }
 
 ic_private void history_remove_last(history_t* h) {
+  history_sync(h);
   history_remove_last_n(h,1);
 }
 
 ic_private void history_clear(history_t* h) {
+  history_cancel_load(h);
   history_remove_last_n( h, h->count );
 }
 
-ic_private const char* history_get( const history_t* h, ssize_t n ) {
+ic_private const char* history_get( history_t* h, ssize_t n ) {
+  history_sync(h);
   if (n < 0 || n >= h->count) return NULL;
   return h->elems[h->count - n - 1];
 }
 
-ic_private bool history_search( const history_t* h, ssize_t from /*including*/, const char* search, bool backward, ssize_t* hidx, ssize_t* hpos ) {
+// Searching stays synchronous: it is bounded by `IC_MAX_HISTORY` entries.
+ic_private bool history_search( history_t* h, ssize_t from /*including*/, const char* search, bool backward, ssize_t* hidx, ssize_t* hpos ) {
+  history_sync(h);
   const char* p = NULL;
   ssize_t i;
   if (backward) {
@@ -144,8 +157,14 @@ ic_private bool history_search( const history_t* h, ssize_t from /*including*/,
 // 
 //-------------------------------------------------------------
 
+static bool history_load_async( history_t* h );
+
 ic_private void history_load_from(history_t* h, const char* fname, long max_entries ) {
   history_clear(h);
+  mem_free(h->mem, h->fname);
+  mem_free(h->mem, h->elems);
+  h->elems = NULL;
+  h->len = 0;
   h->fname = mem_strdup(h->mem,fname);
   if (max_entries == 0) {
     assert(h->elems == NULL);
@@ -155,7 +174,110 @@ ic_private void history_load_from(history_t* h, const char* fname, long max_entr
   h->elems = (const char**)mem_zalloc_tp_n(h->mem, char*, max_entries );
   if (h->elems == NULL) return;
   h->len = max_entries;
-  history_load(h);
+  if (!history_load_async(h)) {
+    history_load(h);
+  }
+}
+
+
+//-------------------------------------------------------------
+// Load in the background
+//
+// The file is read on a worker into a separate history (using
+// the task allocator). Entries that are added in the mean time
+// are kept as the newest ones when the result is merged back on
+// the main thread; any other access waits for the load to finish.
+//-------------------------------------------------------------
+
+typedef struct history_load_s {
+  history_t*  h;
+  const char* fname;
+  ssize_t     len;
+  bool        allow_duplicates;
+  history_t*  loaded;    // allocated in the task memory
+} history_load_t;
+
+static void history_load_work( pool_task_t* task, void* arg ) {
+  history_load_t* job = (history_load_t*)arg;
+  alloc_t* mem = pool_task_mem(task);
+  history_t* lh = history_new(mem);
+  if (lh == NULL) return;
+  lh->allow_duplicates = job->allow_duplicates;
+  lh->fname = mem_strdup(mem, job->fname);
+  lh->elems = (const char**)mem_zalloc_tp_n(mem, char*, job->len);
+  if (lh->elems != NULL) { lh->len = job->len; }
+  lh->task = task;
+  history_load(lh);
+  job->loaded = lh;
+}
+
+static void history_load_done( pool_task_t* task, void* arg ) {
+  history_load_t* job = (history_load_t*)arg;
+  history_t* h = job->h;
+  h->load_task = NULL;
+  history_t* lh = job->loaded;
+  if (lh != NULL && !pool_task_cancelled(task) && h->len == job->len) {
+    // push the loaded entries first, followed by the ones that were added while loading
+    const char** added = h->elems;
+    const ssize_t added_count = h->count;
+    h->elems = (const char**)mem_zalloc_tp_n(h->mem, char*, h->len);
+    if (h->elems == NULL) {
+      h->elems = added;  // keep the added entries
+    }
+    else {
+      h->count = 0;
+      for (ssize_t i = 0; i < lh->count; i++) { history_push(h, lh->elems[i]); }
+      for (ssize_t i = 0; i < added_count; i++) {
+        history_push(h, added[i]);
+        mem_free(h->mem, added[i]);
+      }
+      mem_free(h->mem, added);
+    }
+    debug_msg("history: loaded %zd entries in the background\n", lh->count);
+  }
+  history_free(lh);
+  mem_free(h->mem, job->fname);
+  mem_free(h->mem, job);
+}
+
+static bool history_load_async( history_t* h ) {
+  if (h->pool == NULL || h->fname == NULL) return false;
+  history_load_t* job = mem_zalloc_tp(h->mem, history_load_t);
+  if (job == NULL) return false;
+  job->h = h;
+  job->fname = mem_strdup(h->mem, h->fname);
+  job->len = h->len;
+  job->allow_duplicates = h->allow_duplicates;
+  if (job->fname != NULL) {
+    h->load_task = pool_submit(h->pool, &history_load_work, &history_load_done, job);
+  }
+  if (h->load_task == NULL) {
+    mem_free(h->mem, job->fname);
+    mem_free(h->mem, job);
+    return false;
+  }
+  return true;
+}
+
+// wait for a pending load
+static void history_sync( history_t* h ) {
+  if (h->load_task != NULL) {
+    pool_wait(h->pool, h->load_task, -1);
+    assert(h->load_task == NULL);
+  }
+}
+
+static void history_cancel_load( history_t* h ) {
+  if (h->load_task != NULL) {
+    pool_cancel(h->pool, h->load_task);
+    history_sync(h);
+  }
+}
+
+ic_private void history_set_pool( history_t* h, pool_t* pool ) {
+  if (h->pool == pool) return;
+  history_sync(h);
+  h->pool = pool;
 }
 
 
@@ -245,14 +367,16 @@ ic_private void history_load( history_t* h ) {
   if (sbuf != NULL) {
     while (!feof(f)) {
       if (!history_read_entry(h,f,sbuf)) break; // error
+      if (h->task != NULL && pool_task_cancelled(h->task)) break;
     }
     sbuf_free(sbuf);
   }
   fclose(f);
 }
 
-ic_private void history_save( const history_t* h ) {
-  if (h->fname == NULL) return;
+ic_private void history_save( history_t* h ) {
+  if (h == NULL || h->fname == NULL) return;
+  history_sync(h);
   FILE* f = fopen(h->fname, "w");
   if (f == NULL) return;
   #ifndef _WIN32
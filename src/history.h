@@ -9,6 +9,7 @@
 #define IC_HISTORY_H
 
 #include "common.h"
+#include "pool.h"
 
 //-------------------------------------------------------------
 // History
@@ -21,18 +22,19 @@ ic_private history_t* history_new(alloc_t* mem);
 ic_private void     history_free(history_t* h);
 ic_private void     history_clear(history_t* h);
 ic_private bool     history_enable_duplicates( history_t* h, bool enable );
-ic_private ssize_t  history_count(const history_t* h);
+ic_private ssize_t  history_count(history_t* h);
+ic_private void     history_set_pool(history_t* h, pool_t* pool);  // load in the background if `pool != NULL`
 
 ic_private void     history_load_from(history_t* h, const char* fname, long max_entries);
 ic_private void     history_load( history_t* h );
-ic_private void     history_save( const history_t* h );
+ic_private void     history_save( history_t* h );
 
 ic_private bool     history_push( history_t* h, const char* entry );
 ic_private bool     history_update( history_t* h, const char* entry );
-ic_private const char* history_get( const history_t* h, ssize_t n );
+ic_private const char* history_get( history_t* h, ssize_t n );
 ic_private void     history_remove_last(history_t* h);
 
-ic_private bool     history_search( const history_t* h, ssize_t from, const char* search, bool backward, ssize_t* hidx, ssize_t* hpos);
+ic_private bool     history_search( history_t* h, ssize_t from, const char* search, bool backward, ssize_t* hidx, ssize_t* hpos);
 
 
 #endif // IC_HISTORY_H
@@ -34,6 +34,10 @@
 # include "tty.c"
 # include "stringbuf.c"
 # include "common.c"
+# include "stats.c"
+# include "pool.c"
+# include "trace.c"
+# include "vterm.c"
 #endif
 
 //-------------------------------------------------------------
@@ -47,6 +51,10 @@
 #include "../include/isocline.h"
 #include "common.h"
 #include "env.h"
+#include "trace.h"
+
+static ic_env_t* ic_get_env_term(void);   // environment with the terminal initialized
+static ic_env_t* ic_get_env_edit(void);   // environment with the editor initialized
 
 
 //-------------------------------------------------------------
@@ -57,7 +65,7 @@ static char*  ic_getline( alloc_t* mem );
 
 ic_public char* ic_readline(const char* prompt_text) 
 {
-  ic_env_t* env = ic_get_env();
+  ic_env_t* env = ic_get_env_edit();
   if (env == NULL) return NULL;
 #if defined(EMSCRIPTEN)
     return ic_editline(env, prompt_text);   // in editline.c
@@ -103,7 +111,9 @@ static char* ic_getline(alloc_t* mem)
       sbuf_append_char(sb, (char)c);
     }
   }
-  return sbuf_free_dup(sb);
+  char* s = (sbuf_len(sb) > 0 ? mem_raw_strdup(mem, sbuf_string(sb)) : NULL);
+  sbuf_free(sb);
+  return s;
 }
 
 
@@ -120,32 +130,32 @@ ic_public void ic_printf(const char* fmt, ...) {
 }
 
 ic_public void ic_vprintf(const char* fmt, va_list args) {
-  ic_env_t* env = ic_get_env(); if (env==NULL || env->bbcode == NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL || env->bbcode == NULL) return;
   bbcode_vprintf(env->bbcode, fmt, args);
 }
 
 ic_public void ic_print(const char* s) {
-  ic_env_t* env = ic_get_env(); if (env==NULL || env->bbcode==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL || env->bbcode==NULL) return;
   bbcode_print(env->bbcode, s);
 }
 
 ic_public void ic_println(const char* s) {
-  ic_env_t* env = ic_get_env(); if (env==NULL || env->bbcode==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL || env->bbcode==NULL) return;
   bbcode_println(env->bbcode, s);
 }
 
 void ic_style_def(const char* name, const char* fmt) {
-  ic_env_t* env = ic_get_env(); if (env==NULL || env->bbcode==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL || env->bbcode==NULL) return;
   bbcode_style_def(env->bbcode, name, fmt);
 }
 
 void ic_style_open(const char* fmt) {
-  ic_env_t* env = ic_get_env(); if (env==NULL || env->bbcode==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL || env->bbcode==NULL) return;
   bbcode_style_open(env->bbcode, fmt);
 }
 
 void ic_style_close(void) {
-  ic_env_t* env = ic_get_env(); if (env==NULL || env->bbcode==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL || env->bbcode==NULL) return;
   bbcode_style_close(env->bbcode, NULL);
 }
 
@@ -160,6 +170,42 @@ ic_public bool ic_async_stop(void) {
   return tty_async_stop(env->tty);
 }
 
+static void ic_env_stop_background(ic_env_t* env) {
+  if (env->pool == NULL) return;
+  if (env->history != NULL) { history_set_pool(env->history, NULL); }  // waits for a pending load
+  if (env->tty != NULL) { tty_set_wakeup(env->tty, -1); }
+  pool_free(env->pool);
+  env->pool = NULL;
+}
+
+static void ic_env_start_background(ic_env_t* env) {
+  if (env->pool != NULL) return;
+  env->pool = pool_new(mem_tagged(env->mem, IC_MEM_OTHER), env->background_threads);
+  if (env->pool == NULL) return;   // no thread support
+  if (env->tty != NULL) { tty_set_wakeup(env->tty, pool_wakeup_fd(env->pool)); }
+  if (env->history != NULL) { history_set_pool(env->history, env->pool); }
+}
+
+ic_public bool ic_enable_background(bool enable) {
+  ic_env_t* env = ic_get_env_edit(); if (env==NULL) return false;
+  const bool prev = (env->pool != NULL);
+  if (enable) { ic_env_start_background(env); }
+         else { ic_env_stop_background(env); }
+  return prev;
+}
+
+ic_public long ic_set_background_threads(long threads) {
+  ic_env_t* env = ic_get_env(); if (env==NULL) return 0;
+  const long prev = env->background_threads;
+  env->background_threads = (threads <= 0 ? 2 : (threads > IC_POOL_MAX_THREADS ? IC_POOL_MAX_THREADS : threads));
+  if (env->pool != NULL && env->background_threads != prev) {
+    // restart with the new number of workers
+    ic_env_stop_background(env);
+    ic_env_start_background(env);
+  }
+  return prev;
+}
+
 static void set_prompt_marker(ic_env_t* env, const char* prompt_marker, const char* cprompt_marker) {
   if (prompt_marker == NULL) prompt_marker = "> ";
   if (cprompt_marker == NULL) cprompt_marker = prompt_marker;
@@ -192,37 +238,42 @@ ic_public bool ic_enable_multiline( bool enable ) {
 }
 
 ic_public bool ic_enable_beep( bool enable ) {
-  ic_env_t* env = ic_get_env(); if (env==NULL) return false;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL) return false;
   return term_enable_beep(env->term, enable);
 }
 
 ic_public bool ic_enable_color( bool enable ) {
-  ic_env_t* env = ic_get_env(); if (env==NULL) return false;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL) return false;
   return term_enable_color( env->term, enable );
 }
 
+ic_public void ic_set_term_cache( const char* fname, bool revalidate ) {
+  ic_env_t* env = ic_get_env_term(); if (env==NULL) return;
+  term_set_cache( env->term, fname, revalidate );
+}
+
 ic_public bool ic_enable_history_duplicates( bool enable ) {
-  ic_env_t* env = ic_get_env(); if (env==NULL) return false;
+  ic_env_t* env = ic_get_env_edit(); if (env==NULL) return false;
   return history_enable_duplicates(env->history, enable);
 }
 
 ic_public void ic_set_history(const char* fname, long max_entries ) {
-  ic_env_t* env = ic_get_env(); if (env==NULL) return;
+  ic_env_t* env = ic_get_env_edit(); if (env==NULL) return;
   history_load_from(env->history, fname, max_entries );
 }
 
 ic_public void ic_history_remove_last(void) {
-  ic_env_t* env = ic_get_env(); if (env==NULL) return;
+  ic_env_t* env = ic_get_env_edit(); if (env==NULL) return;
   history_remove_last(env->history);
 }
 
 ic_public void ic_history_add( const char* entry ) {
-  ic_env_t* env = ic_get_env(); if (env==NULL) return;
+  ic_env_t* env = ic_get_env_edit(); if (env==NULL) return;
   history_push( env->history, entry );
 }
 
 ic_public void ic_history_clear(void) {
-  ic_env_t* env = ic_get_env(); if (env==NULL) return;
+  ic_env_t* env = ic_get_env_edit(); if (env==NULL) return;
   history_clear(env->history);
 }
 
@@ -247,6 +298,13 @@ ic_public bool ic_enable_multiline_indent(bool enable) {
   return !prev;
 }
 
+ic_public bool ic_enable_horizontal_scroll(bool enable) {
+  ic_env_t* env = ic_get_env(); if (env==NULL) return false;
+  bool prev = env->hscroll;
+  env->hscroll = enable;
+  return prev;
+}
+
 ic_public bool ic_enable_hint(bool enable) {
   ic_env_t* env = ic_get_env(); if (env==NULL) return false;
   bool prev = env->no_hint;
@@ -262,7 +320,7 @@ ic_public long ic_set_hint_delay(long delay_ms) {
 }
 
 ic_public void ic_set_tty_esc_delay(long initial_delay_ms, long followup_delay_ms ) {
-  ic_env_t* env = ic_get_env(); if (env==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL) return;
   if (env->tty == NULL) return;
   tty_set_esc_delay(env->tty, initial_delay_ms, followup_delay_ms);
 }
@@ -337,19 +395,19 @@ ic_public void ic_set_default_highlighter(ic_highlight_fun_t* highlighter, void*
 
 ic_public void ic_free( void* p ) {
   ic_env_t* env = ic_get_env(); if (env==NULL) return;
-  mem_free(env->mem, p);
+  mem_raw_free(env->mem, p);
 }
 
 ic_public void* ic_malloc(size_t sz) {
   ic_env_t* env = ic_get_env(); if (env==NULL) return NULL;
-  return mem_malloc(env->mem, to_ssize_t(sz));
+  return mem_raw_malloc(env->mem, to_ssize_t(sz));
 }
 
 ic_public const char* ic_strdup( const char* s ) {
   if (s==NULL) return NULL;
   ic_env_t* env = ic_get_env(); if (env==NULL) return NULL;
   ssize_t len = ic_strlen(s);
-  char* p = mem_malloc_tp_n( env->mem, char, len + 1 );
+  char* p = (char*)mem_raw_malloc( env->mem, len + 1 );
   if (p == NULL) return NULL;
   ic_memcpy( p, s, len );
   p[len] = 0;
@@ -361,31 +419,31 @@ ic_public const char* ic_strdup( const char* s ) {
 //-------------------------------------------------------------
 
 ic_public void ic_term_init(void) {
-  ic_env_t* env = ic_get_env(); if (env==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL) return;
   if (env->term==NULL) return;
   term_start_raw(env->term);
 }
 
 ic_public void ic_term_done(void) {
-  ic_env_t* env = ic_get_env(); if (env==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL) return;
   if (env->term==NULL) return;
   term_end_raw(env->term,false);
 }
 
 ic_public void ic_term_flush(void) {
-  ic_env_t* env = ic_get_env(); if (env==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL) return;
   if (env->term==NULL) return;
   term_flush(env->term);
 }
 
 ic_public void ic_term_write(const char* s) {
-  ic_env_t* env = ic_get_env(); if (env==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL) return;
   if (env->term == NULL) return;
-  term_write(env->term, s);
+  term_write_borrow_n(env->term, s, ic_strlen(s));
 }
 
 ic_public void ic_term_writeln(const char* s) {
-  ic_env_t* env = ic_get_env(); if (env==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL) return;
   if (env->term == NULL) return;
   term_writeln(env->term, s);
 }
@@ -398,64 +456,107 @@ ic_public void ic_term_writef(const char* fmt, ...) {
 }
 
 ic_public void ic_term_vwritef(const char* fmt, va_list args) {
-  ic_env_t* env = ic_get_env(); if (env==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL) return;
   if (env->term == NULL) return;
   term_vwritef(env->term, fmt, args);
 }
 
 ic_public void ic_term_reset( void )  {
-  ic_env_t* env = ic_get_env(); if (env==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL) return;
   if (env->term == NULL) return;
   term_attr_reset(env->term);
 }
 
 ic_public void ic_term_style( const char* style ) {
-  ic_env_t* env = ic_get_env(); if (env==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL) return;
   if (env->term == NULL || env->bbcode == NULL) return;
   term_set_attr( env->term, bbcode_style(env->bbcode, style));
 }
 
 ic_public int ic_term_get_color_bits(void) {
-  ic_env_t* env = ic_get_env(); 
+  ic_env_t* env = ic_get_env_term(); 
   if (env==NULL || env->term==NULL) return 4;  
   return term_get_color_bits(env->term);
 }
 
 ic_public void ic_term_bold(bool enable) {
-  ic_env_t* env = ic_get_env(); if (env==NULL || env->term==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL || env->term==NULL) return;
   term_bold(env->term, enable);
 }
 
 ic_public void ic_term_underline(bool enable) {
-  ic_env_t* env = ic_get_env(); if (env==NULL || env->term==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL || env->term==NULL) return;
   term_underline(env->term, enable);
 }
 
 ic_public void ic_term_italic(bool enable) {
-  ic_env_t* env = ic_get_env(); if (env==NULL || env->term==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL || env->term==NULL) return;
   term_italic(env->term, enable);
 }
 
 ic_public void ic_term_reverse(bool enable) {
-  ic_env_t* env = ic_get_env(); if (env==NULL || env->term==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL || env->term==NULL) return;
   term_reverse(env->term, enable);
 }
 
 ic_public void ic_term_color_ansi(bool foreground, int ansi_color) {
-  ic_env_t* env = ic_get_env(); if (env==NULL || env->term==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL || env->term==NULL) return;
   ic_color_t color = color_from_ansi256(ansi_color);
   if (foreground) { term_color(env->term, color); }
              else { term_bgcolor(env->term, color); }
 }
 
 ic_public void ic_term_color_rgb(bool foreground, uint32_t hcolor) {
-  ic_env_t* env = ic_get_env(); if (env==NULL || env->term==NULL) return;
+  ic_env_t* env = ic_get_env_term(); if (env==NULL || env->term==NULL) return;
   ic_color_t color = ic_rgb(hcolor);
   if (foreground) { term_color(env->term, color); }
              else { term_bgcolor(env->term, color); }
 }
 
 
+//-------------------------------------------------------------
+// Statistics
+//-------------------------------------------------------------
+
+static void ic_env_get_stats( ic_env_t* env, ic_stats_t* stats ) {
+  *stats = env->stats;
+  if (env->term != NULL) { stats->output = *term_get_counters(env->term); }
+  mem_get_stats(env->mem, stats);
+}
+
+ic_public void ic_get_stats( ic_stats_t* stats ) {
+  if (stats == NULL) return;
+  ic_env_t* env = ic_get_env(); 
+  if (env==NULL) { memset(stats, 0, sizeof(*stats)); return; }
+  ic_env_get_stats(env, stats);
+}
+
+static void ic_env_reset_stats( ic_env_t* env ) {
+  memset(&env->stats, 0, sizeof(env->stats));
+  if (env->term != NULL) { term_reset_counters(env->term); }
+  mem_reset_stats(env->mem);
+}
+
+ic_public void ic_reset_stats( void ) {
+  ic_env_t* env = ic_get_env(); if (env==NULL) return;
+  ic_env_reset_stats(env);
+}
+
+ic_public bool ic_enable_stats_overlay( bool enable ) {
+  ic_env_t* env = ic_get_env(); if (env==NULL) return false;
+  bool prev = env->stats_overlay;
+  env->stats_overlay = enable;
+  return prev;
+}
+
+ic_public bool ic_enable_stats_dump( bool enable ) {
+  ic_env_t* env = ic_get_env(); if (env==NULL) return false;
+  bool prev = env->stats_dump;
+  env->stats_dump = enable;
+  return prev;
+}
+
+
 //-------------------------------------------------------------
 // Readline with temporary completer and highlighter
 //-------------------------------------------------------------
@@ -464,7 +565,7 @@ ic_public char* ic_readline_ex(const char* prompt_text,
                                 ic_completer_fun_t* completer, void* completer_arg,
                                  ic_highlight_fun_t* highlighter, void* highlighter_arg )
 {
-  ic_env_t* env = ic_get_env(); if (env == NULL) return NULL;
+  ic_env_t* env = ic_get_env_edit(); if (env == NULL) return NULL;
   // save previous
   ic_completer_fun_t* prev_completer;
   void* prev_completer_arg;
@@ -490,12 +591,19 @@ static void ic_atexit(void);
 
 static void ic_env_free(ic_env_t* env) {
   if (env == NULL) return;
+  if (env->stats_dump) { 
+    ic_stats_t stats;
+    ic_env_get_stats(env, &stats);
+    stats_print(&stats); 
+  }
+  ic_env_stop_background(env);
   history_save(env->history);
   history_free(env->history);
   completions_free(env->completions);
   bbcode_free(env->bbcode);
   term_free(env->term);
   tty_free(env->tty);
+  trace_flush();
   mem_free(env->mem, env->cprompt_marker);
   mem_free(env->mem,env->prompt_marker);
   mem_free(env->mem, env->match_braces);
@@ -507,7 +615,7 @@ static void ic_env_free(ic_env_t* env) {
   mem_free(mem, env);
 
   // and finally the custom memory allocation structure
-  mem_free(mem, mem);
+  mem_delete(mem);
 }
 
 
@@ -517,52 +625,71 @@ static ic_env_t* ic_env_create( ic_malloc_fun_t* _malloc, ic_realloc_fun_t* _rea
   if (_realloc == NULL) _realloc = &realloc;
   if (_free == NULL)    _free = &free;
   // allocate
-  alloc_t* mem = (alloc_t*)_malloc(sizeof(alloc_t));
+  alloc_t* mem = mem_new(_malloc, _realloc, _free);
   if (mem == NULL) return NULL;
-  mem->malloc = _malloc;
-  mem->realloc = _realloc;
-  mem->free = _free;
   ic_env_t* env = mem_zalloc_tp(mem, ic_env_t);
   if (env==NULL) {
-    mem->free(mem);
+    mem_delete(mem);
     return NULL;
   }
   env->mem = mem;
 
-  // Initialize
-  env->tty         = tty_new(env->mem, -1);  // can return NULL
-  env->term        = term_new(env->mem, env->tty, false, false, -1 );  
-  env->history     = history_new(env->mem);
-  env->completions = completions_new(env->mem);
-  env->bbcode      = bbcode_new(env->mem, env->term);
+  // Initialize settings only; the subsystems are initialized on first use
+  // (see `ic_env_init_term` and `ic_env_init_edit`) so programs that only
+  // print do not pay for the readline setup. The default styles are 
+  // precompiled in `bbcode.c`.
   env->hint_delay  = 400;   
-  
+  env->background_threads = 2;
+  env->multiline_eol = '\\';
+  const char* stats = getenv("ISOCLINE_STATS");
+  env->stats_dump  = (stats != NULL && (strcmp(stats,"1") == 0 || strcmp(stats,"2") == 0));
+  env->stats_overlay = (stats != NULL && strcmp(stats,"2") == 0);
+  set_prompt_marker(env, NULL, NULL);
+  return env;
+}
+
+// Initialize the tty, terminal, and bbcode printer.
+ic_private void ic_env_init_term(ic_env_t* env) {
+  if (env->init_term) return;
+  env->init_term   = true;
+  env->tty         = tty_new(env->mem, -1);  // can return NULL
+  const char* record = getenv("ISOCLINE_RECORD");
+  if (record != NULL && record[0] != 0) { tty_record_start(env->tty, record); }
+  env->term        = term_new(mem_tagged(env->mem, IC_MEM_RENDER), env->tty, false, false, -1 );  
+  env->bbcode      = bbcode_new(mem_tagged(env->mem, IC_MEM_BBCODE), env->term);
+}
+
+// Create an environment that reads scripted keys (see `tty_headless_push`)
+// and renders into the virtual terminal `vt` (used for benchmarks and tests).
+ic_private ic_env_t* ic_env_create_headless(vterm_t* vt) {
+  ic_env_t* env = ic_env_create(NULL, NULL, NULL);
+  if (env == NULL) return NULL;
+  env->stats_dump  = false;
+  env->init_term   = true;
+  env->tty         = tty_new_headless(env->mem, vt);
+  env->term        = term_new_headless(mem_tagged(env->mem, IC_MEM_RENDER), env->tty, vt);
+  env->bbcode      = bbcode_new(mem_tagged(env->mem, IC_MEM_BBCODE), env->term);
+  ic_env_init_edit(env);
+  return env;
+}
+
+ic_private void ic_env_free_headless(ic_env_t* env) {
+  ic_env_free(env);
+}
+
+// Initialize the history and completions (and the terminal).
+ic_private void ic_env_init_edit(ic_env_t* env) {
+  if (env->init_edit) return;
+  env->init_edit   = true;
+  ic_env_init_term(env);
+  env->history     = history_new(mem_tagged(env->mem, IC_MEM_HISTORY));
+  env->completions = completions_new(mem_tagged(env->mem, IC_MEM_COMPLETIONS));
   if (env->tty == NULL || env->term==NULL ||
       env->completions == NULL || env->history == NULL || env->bbcode == NULL ||
       !term_is_interactive(env->term)) 
   {
     env->noedit = true;
   }
-  env->multiline_eol = '\\';
-  
-  bbcode_style_def(env->bbcode, "ic-prompt",    "ansi-green" );
-  bbcode_style_def(env->bbcode, "ic-info",      "ansi-darkgray" );
-  bbcode_style_def(env->bbcode, "ic-diminish",  "ansi-lightgray" );
-  bbcode_style_def(env->bbcode, "ic-emphasis",  "#ffffd7" );
-  bbcode_style_def(env->bbcode, "ic-hint",      "ansi-darkgray" );
-  bbcode_style_def(env->bbcode, "ic-error",     "#d70000" );
-  bbcode_style_def(env->bbcode, "ic-bracematch","ansi-white"); //  color = #F7DC6F" );
-
-  bbcode_style_def(env->bbcode, "keyword",  "#569cd6" );
-  bbcode_style_def(env->bbcode, "control",  "#c586c0" );
-  bbcode_style_def(env->bbcode, "number",   "#b5cea8" );
-  bbcode_style_def(env->bbcode, "string",   "#ce9178" );
-  bbcode_style_def(env->bbcode, "comment",  "#6A9955" );
-  bbcode_style_def(env->bbcode, "type",     "darkcyan" );
-  bbcode_style_def(env->bbcode, "constant", "#569cd6" );
-
-  set_prompt_marker(env, NULL, NULL);
-  return env;
 }
 
 static ic_env_t* rpenv;
@@ -582,6 +709,18 @@ ic_private ic_env_t* ic_get_env(void) {
   return rpenv;
 }
 
+static ic_env_t* ic_get_env_term(void) {
+  ic_env_t* env = ic_get_env();
+  if (env != NULL) { ic_env_init_term(env); }
+  return env;
+}
+
+static ic_env_t* ic_get_env_edit(void) {
+  ic_env_t* env = ic_get_env();
+  if (env != NULL) { ic_env_init_edit(env); }
+  return env;
+}
+
 ic_public void ic_init_custom_malloc( ic_malloc_fun_t* _malloc, ic_realloc_fun_t* _realloc, ic_free_fun_t* _free ) {
   assert(rpenv == NULL);
   if (rpenv != NULL) {
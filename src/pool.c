@@ -0,0 +1,462 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+-----------------------------------------------------------------------------*/
+#include <string.h>
+#include "common.h"
+#include "pool.h"
+
+#if defined(IC_THREADS) && !defined(_WIN32)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+
+//-------------------------------------------------------------
+// Each worker has a deque of tasks: it takes its own newest task
+// first, and when it runs out it steals the oldest task of another
+// worker. Tasks are coarse (a completer or highlighter call), so a
+// single lock protects all queues; it is only held for a few pointer
+// updates.
+//-------------------------------------------------------------
+
+typedef enum task_state_e {
+  TASK_QUEUED,    // in the deque of a worker
+  TASK_RUNNING,   // `work` is running (on a worker, or inline in `pool_wait`)
+  TASK_DONE       // `work` has finished (or was cancelled); waiting for `done`
+} task_state_t;
+
+struct pool_task_s {
+  pool_t*          pool;
+  pool_work_fun_t* work;
+  pool_done_fun_t* done;
+  void*            arg;
+  alloc_t*         mem;        // private allocator (only used by one thread at a time)
+  task_state_t     state;
+  bool             cancelled;
+  bool             in_done;    // is it in the completion queue?
+  ssize_t          queue;      // index of the worker deque while queued
+  pool_task_t*     next;       // next in the completion queue
+};
+
+typedef struct deque_s {
+  pool_task_t**  tasks;        // ring buffer
+  ssize_t        capacity;
+  ssize_t        top;          // index of the oldest task (which is stolen first)
+  ssize_t        count;
+} deque_t;
+
+typedef struct worker_s {
+  pool_t*        pool;
+  pthread_t      thread;
+  deque_t        deque;
+  pool_task_t*   current;      // task that is running on this worker (or NULL)
+} worker_t;
+
+struct pool_s {
+  alloc_t*        mem;
+  pthread_mutex_t lock;
+  pthread_cond_t  work_cond;   // signalled on new work (or when stopping)
+  pthread_cond_t  done_cond;   // signalled when a task is done
+  worker_t*       workers;
+  ssize_t         count;       // number of started workers
+  ssize_t         next;        // round-robin worker for the next submit
+  pool_task_t*    done_first;  // completion queue
+  pool_task_t*    done_last;
+  int             wakeup[2];   // pipe that is readable when the completion queue is non-empty
+  bool            signalled;   // is there a byte in the pipe?
+  bool            stop;
+};
+
+
+//-------------------------------------------------------------
+// Deques (with the pool lock held)
+//-------------------------------------------------------------
+
+static bool deque_push_bottom( alloc_t* mem, deque_t* dq, pool_task_t* task ) {
+  if (dq->count >= dq->capacity) {
+    const ssize_t newcap = (dq->capacity <= 0 ? 8 : 2*dq->capacity);
+    pool_task_t** newtasks = mem_malloc_tp_n(mem, pool_task_t*, newcap);
+    if (newtasks == NULL) return false;
+    for (ssize_t i = 0; i < dq->count; i++) {
+      newtasks[i] = dq->tasks[(dq->top + i) % dq->capacity];
+    }
+    mem_free(mem, dq->tasks);
+    dq->tasks = newtasks;
+    dq->capacity = newcap;
+    dq->top = 0;
+  }
+  dq->tasks[(dq->top + dq->count) % dq->capacity] = task;
+  dq->count++;
+  return true;
+}
+
+static pool_task_t* deque_pop_bottom( deque_t* dq ) {
+  if (dq->count <= 0) return NULL;
+  dq->count--;
+  return dq->tasks[(dq->top + dq->count) % dq->capacity];
+}
+
+static pool_task_t* deque_pop_top( deque_t* dq ) {
+  if (dq->count <= 0) return NULL;
+  pool_task_t* task = dq->tasks[dq->top];
+  dq->top = (dq->top + 1) % dq->capacity;
+  dq->count--;
+  return task;
+}
+
+static bool deque_remove( deque_t* dq, pool_task_t* task ) {
+  for (ssize_t i = 0; i < dq->count; i++) {
+    if (dq->tasks[(dq->top + i) % dq->capacity] != task) continue;
+    for (ssize_t j = i + 1; j < dq->count; j++) {
+      dq->tasks[(dq->top + j - 1) % dq->capacity] = dq->tasks[(dq->top + j) % dq->capacity];
+    }
+    dq->count--;
+    return true;
+  }
+  return false;
+}
+
+
+//-------------------------------------------------------------
+// Completion queue (with the pool lock held)
+//-------------------------------------------------------------
+
+static void pool_push_done( pool_t* pool, pool_task_t* task ) {
+  task->state = TASK_DONE;
+  task->in_done = true;
+  task->next = NULL;
+  if (pool->done_last == NULL) { pool->done_first = task; }
+                          else { pool->done_last->next = task; }
+  pool->done_last = task;
+  if (!pool->signalled) {
+    pool->signalled = true;
+    const char c = 'x';
+    if (write(pool->wakeup[1], &c, 1) != 1) { /* the pipe is full, so already readable */ }
+  }
+  pthread_cond_broadcast(&pool->done_cond);
+}
+
+static void pool_remove_done( pool_t* pool, pool_task_t* task ) {
+  if (!task->in_done) return;
+  pool_task_t* prev = NULL;
+  for (pool_task_t* t = pool->done_first; t != NULL; prev = t, t = t->next) {
+    if (t != task) continue;
+    if (prev == NULL) { pool->done_first = t->next; }
+                 else { prev->next = t->next; }
+    if (pool->done_last == t) { pool->done_last = prev; }
+    break;
+  }
+  task->in_done = false;
+  task->next = NULL;
+}
+
+// run `done` and free the task (on the main thread, without the lock)
+static void pool_task_finish( pool_t* pool, pool_task_t* task ) {
+  if (task->done != NULL) { (*task->done)(task, task->arg); }
+  mem_delete(task->mem);
+  mem_free(pool->mem, task);
+}
+
+
+//-------------------------------------------------------------
+// Workers
+//-------------------------------------------------------------
+
+static pool_task_t* pool_steal( pool_t* pool, worker_t* w ) {
+  const ssize_t self = w - pool->workers;
+  for (ssize_t i = 1; i < pool->count; i++) {
+    pool_task_t* task = deque_pop_top(&pool->workers[(self + i) % pool->count].deque);
+    if (task != NULL) return task;
+  }
+  return NULL;
+}
+
+static void* pool_worker( void* p ) {
+  worker_t* w = (worker_t*)p;
+  pool_t* pool = w->pool;
+  pthread_mutex_lock(&pool->lock);
+  while (!pool->stop) {
+    pool_task_t* task = deque_pop_bottom(&w->deque);
+    if (task == NULL) { task = pool_steal(pool, w); }
+    if (task == NULL) {
+      pthread_cond_wait(&pool->work_cond, &pool->lock);
+      continue;
+    }
+    task->state = TASK_RUNNING;
+    w->current = task;
+    pthread_mutex_unlock(&pool->lock);
+    (*task->work)(task, task->arg);
+    pthread_mutex_lock(&pool->lock);
+    w->current = NULL;
+    pool_push_done(pool, task);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+static bool pool_init_wakeup( pool_t* pool ) {
+  if (pipe(pool->wakeup) != 0) return false;
+  for (int i = 0; i < 2; i++) {
+    const int flags = fcntl(pool->wakeup[i], F_GETFL, 0);
+    if (flags != -1) { fcntl(pool->wakeup[i], F_SETFL, flags | O_NONBLOCK); }
+    fcntl(pool->wakeup[i], F_SETFD, FD_CLOEXEC);
+  }
+  return true;
+}
+
+ic_private pool_t* pool_new( alloc_t* mem, ssize_t threads ) {
+  if (threads <= 0) threads = 1;
+  if (threads > IC_POOL_MAX_THREADS) threads = IC_POOL_MAX_THREADS;
+  pool_t* pool = mem_zalloc_tp(mem, pool_t);
+  if (pool == NULL) return NULL;
+  pool->mem = mem;
+  pool->workers = mem_zalloc_tp_n(mem, worker_t, threads);
+  if (pool->workers == NULL || !pool_init_wakeup(pool)) {
+    mem_free(mem, pool->workers);
+    mem_free(mem, pool);
+    return NULL;
+  }
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->work_cond, NULL);
+  pthread_cond_init(&pool->done_cond, NULL);
+
+  // workers block all signals so resize and termination signals are delivered to the main thread
+  sigset_t all, prev;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &prev);
+  pthread_mutex_lock(&pool->lock);   // workers read `count` when stealing
+  for (ssize_t i = 0; i < threads; i++) {
+    worker_t* w = &pool->workers[i];
+    w->pool = pool;
+    if (pthread_create(&w->thread, NULL, &pool_worker, w) != 0) break;
+    pool->count++;
+  }
+  pthread_mutex_unlock(&pool->lock);
+  pthread_sigmask(SIG_SETMASK, &prev, NULL);
+  debug_msg("pool: started %zd worker threads\n", pool->count);
+  if (pool->count == 0) {
+    pool_free(pool);
+    return NULL;
+  }
+  return pool;
+}
+
+ic_private void pool_free( pool_t* pool ) {
+  if (pool == NULL) return;
+  // cancel everything and stop the workers (after their current task)
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = true;
+  for (ssize_t i = 0; i < pool->count; i++) {
+    worker_t* w = &pool->workers[i];
+    if (w->current != NULL) { w->current->cancelled = true; }
+    pool_task_t* task;
+    while ((task = deque_pop_top(&w->deque)) != NULL) {
+      task->cancelled = true;
+      pool_push_done(pool, task);
+    }
+  }
+  pthread_cond_broadcast(&pool->work_cond);
+  pthread_mutex_unlock(&pool->lock);
+  for (ssize_t i = 0; i < pool->count; i++) {
+    pthread_join(pool->workers[i].thread, NULL);
+  }
+  // let the owners release their task arguments
+  pool_poll(pool);
+  for (ssize_t i = 0; i < pool->count; i++) {
+    mem_free(pool->mem, pool->workers[i].deque.tasks);
+  }
+  pthread_cond_destroy(&pool->done_cond);
+  pthread_cond_destroy(&pool->work_cond);
+  pthread_mutex_destroy(&pool->lock);
+  close(pool->wakeup[0]);
+  close(pool->wakeup[1]);
+  mem_free(pool->mem, pool->workers);
+  mem_free(pool->mem, pool);
+}
+
+ic_private ssize_t pool_thread_count( const pool_t* pool ) {
+  return (pool == NULL ? 0 : pool->count);
+}
+
+ic_private int pool_wakeup_fd( const pool_t* pool ) {
+  return (pool == NULL ? -1 : pool->wakeup[0]);
+}
+
+
+//-------------------------------------------------------------
+// Tasks
+//-------------------------------------------------------------
+
+ic_private pool_task_t* pool_submit( pool_t* pool, pool_work_fun_t* work, pool_done_fun_t* done, void* arg ) {
+  if (pool == NULL || work == NULL) return NULL;
+  pool_task_t* task = mem_zalloc_tp(pool->mem, pool_task_t);
+  if (task == NULL) return NULL;
+  task->mem = mem_new(pool->mem->malloc, pool->mem->realloc, pool->mem->free);
+  if (task->mem == NULL) {
+    mem_free(pool->mem, task);
+    return NULL;
+  }
+  task->pool  = pool;
+  task->work  = work;
+  task->done  = done;
+  task->arg   = arg;
+  task->state = TASK_QUEUED;
+  pthread_mutex_lock(&pool->lock);
+  task->queue = pool->next;
+  pool->next  = (pool->next + 1) % pool->count;
+  const bool ok = deque_push_bottom(pool->mem, &pool->workers[task->queue].deque, task);
+  if (ok) { pthread_cond_signal(&pool->work_cond); }
+  pthread_mutex_unlock(&pool->lock);
+  if (!ok) {
+    mem_delete(task->mem);
+    mem_free(pool->mem, task);
+    return NULL;
+  }
+  return task;
+}
+
+ic_private void pool_cancel( pool_t* pool, pool_task_t* task ) {
+  if (pool == NULL || task == NULL) return;
+  pthread_mutex_lock(&pool->lock);
+  task->cancelled = true;
+  if (task->state == TASK_QUEUED && deque_remove(&pool->workers[task->queue].deque, task)) {
+    pool_push_done(pool, task);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+ic_private bool pool_task_cancelled( const pool_task_t* task ) {
+  if (task == NULL) return false;
+  pthread_mutex_lock(&task->pool->lock);
+  const bool cancelled = task->cancelled;
+  pthread_mutex_unlock(&task->pool->lock);
+  return cancelled;
+}
+
+ic_private alloc_t* pool_task_mem( pool_task_t* task ) {
+  return task->mem;
+}
+
+// wait for the task to be done (with the lock held)
+static bool pool_wait_done( pool_t* pool, pool_task_t* task, long timeout_ms ) {
+  if (timeout_ms < 0) {
+    while (task->state != TASK_DONE) { pthread_cond_wait(&pool->done_cond, &pool->lock); }
+    return true;
+  }
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec  += timeout_ms / 1000;
+  deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000L;
+  }
+  while (task->state != TASK_DONE) {
+    if (pthread_cond_timedwait(&pool->done_cond, &pool->lock, &deadline) == ETIMEDOUT) break;
+  }
+  return (task->state == TASK_DONE);
+}
+
+ic_private bool pool_wait( pool_t* pool, pool_task_t* task, long timeout_ms ) {
+  if (pool == NULL || task == NULL) return false;
+  pthread_mutex_lock(&pool->lock);
+  if (timeout_ms < 0 && task->state == TASK_QUEUED && deque_remove(&pool->workers[task->queue].deque, task)) {
+    // not started yet: run it right here instead of waiting for a worker
+    task->state = TASK_RUNNING;
+    pthread_mutex_unlock(&pool->lock);
+    (*task->work)(task, task->arg);
+    pthread_mutex_lock(&pool->lock);
+    task->state = TASK_DONE;
+  }
+  else if (!pool_wait_done(pool, task, timeout_ms)) {
+    pthread_mutex_unlock(&pool->lock);
+    return false;
+  }
+  pool_remove_done(pool, task);
+  pthread_mutex_unlock(&pool->lock);
+  pool_task_finish(pool, task);
+  return true;
+}
+
+ic_private ssize_t pool_poll( pool_t* pool ) {
+  if (pool == NULL) return 0;
+  pthread_mutex_lock(&pool->lock);
+  char buf[64];
+  while (read(pool->wakeup[0], buf, sizeof(buf)) > 0) { }
+  pool->signalled = false;
+  pthread_mutex_unlock(&pool->lock);
+  // take one task at a time as a `done` function may wait for another queued task
+  ssize_t count = 0;
+  while (true) {
+    pthread_mutex_lock(&pool->lock);
+    pool_task_t* task = pool->done_first;
+    if (task != NULL) { pool_remove_done(pool, task); }
+    pthread_mutex_unlock(&pool->lock);
+    if (task == NULL) break;
+    pool_task_finish(pool, task);
+    count++;
+  }
+  return count;
+}
+
+#else
+
+//-------------------------------------------------------------
+// No threads: everything stays synchronous
+//-------------------------------------------------------------
+
+ic_private pool_t* pool_new( alloc_t* mem, ssize_t threads ) {
+  ic_unused(mem); ic_unused(threads);
+  return NULL;
+}
+
+ic_private void pool_free( pool_t* pool ) {
+  ic_unused(pool);
+}
+
+ic_private ssize_t pool_thread_count( const pool_t* pool ) {
+  ic_unused(pool);
+  return 0;
+}
+
+ic_private int pool_wakeup_fd( const pool_t* pool ) {
+  ic_unused(pool);
+  return -1;
+}
+
+ic_private pool_task_t* pool_submit( pool_t* pool, pool_work_fun_t* work, pool_done_fun_t* done, void* arg ) {
+  ic_unused(pool); ic_unused(work); ic_unused(done); ic_unused(arg);
+  return NULL;
+}
+
+ic_private void pool_cancel( pool_t* pool, pool_task_t* task ) {
+  ic_unused(pool); ic_unused(task);
+}
+
+ic_private bool pool_wait( pool_t* pool, pool_task_t* task, long timeout_ms ) {
+  ic_unused(pool); ic_unused(task); ic_unused(timeout_ms);
+  return false;
+}
+
+ic_private ssize_t pool_poll( pool_t* pool ) {
+  ic_unused(pool);
+  return 0;
+}
+
+ic_private bool pool_task_cancelled( const pool_task_t* task ) {
+  ic_unused(task);
+  return false;
+}
+
+ic_private alloc_t* pool_task_mem( pool_task_t* task ) {
+  ic_unused(task);
+  return NULL;
+}
+
+#endif
@@ -0,0 +1,52 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+-----------------------------------------------------------------------------*/
+#pragma once
+#ifndef IC_POOL_H
+#define IC_POOL_H
+
+#include "common.h"
+
+//-------------------------------------------------------------
+// Worker thread pool for background tasks.
+//
+// Tasks are submitted from the main (readline) thread. The `work`
+// function runs on a worker thread and only uses the task's private
+// allocator (`pool_task_mem`) and the data in its argument. Once
+// done, the task is put in a completion queue and the wakeup handle
+// becomes readable (see `tty_set_wakeup`). The `done` function then
+// runs on the main thread in `pool_poll` or `pool_wait`; after that
+// the task handle is no longer valid.
+//
+// Only available when compiled with `IC_THREADS` (and not on Windows);
+// otherwise `pool_new` returns NULL and all work stays synchronous.
+//-------------------------------------------------------------
+
+struct pool_s;
+typedef struct pool_s pool_t;
+
+struct pool_task_s;
+typedef struct pool_task_s pool_task_t;
+
+typedef void (pool_work_fun_t)( pool_task_t* task, void* arg );  // on a worker thread
+typedef void (pool_done_fun_t)( pool_task_t* task, void* arg );  // on the main thread
+
+#define IC_POOL_MAX_THREADS  (16)
+
+ic_private pool_t*  pool_new( alloc_t* mem, ssize_t threads );  // NULL if threads are not supported
+ic_private void     pool_free( pool_t* pool );    // cancels all tasks and runs their `done` functions
+ic_private ssize_t  pool_thread_count( const pool_t* pool );
+ic_private int      pool_wakeup_fd( const pool_t* pool );  // readable when tasks are done (or -1)
+
+ic_private pool_task_t* pool_submit( pool_t* pool, pool_work_fun_t* work, pool_done_fun_t* done, void* arg ); // NULL on failure (and `done` is not called)
+ic_private void     pool_cancel( pool_t* pool, pool_task_t* task );  // a queued task never runs
+ic_private bool     pool_wait( pool_t* pool, pool_task_t* task, long timeout_ms );  // runs `done` and returns true if the task finished in time (a queued task runs inline if `timeout_ms < 0`)
+ic_private ssize_t  pool_poll( pool_t* pool );  // run the `done` functions of finished tasks
+
+ic_private bool     pool_task_cancelled( const pool_task_t* task );  // can be called from the worker
+ic_private alloc_t* pool_task_mem( pool_task_t* task );   // private allocator of the task
+
+#endif // IC_POOL_H
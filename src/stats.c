@@ -0,0 +1,120 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+-----------------------------------------------------------------------------*/
+#include <stdio.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "common.h"
+#include "stats.h"
+
+//-------------------------------------------------------------
+// Histograms
+// Bucket `i` counts samples below `2^i` micro seconds so adding
+// a sample is just a bit scan; this keeps the instrumentation
+// cheap enough to always be enabled.
+//-------------------------------------------------------------
+
+// the bucket is the bit length of `us` (the index of the highest bit plus one)
+static ssize_t stats_bucket( uint64_t us ) {
+  if (us == 0) return 0;
+  #if defined(__GNUC__) || defined(__clang__)
+  const ssize_t i = 64 - (ssize_t)__builtin_clzll(us);
+  #elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+  unsigned long idx;
+  _BitScanReverse64(&idx, us);
+  const ssize_t i = (ssize_t)idx + 1;
+  #else
+  ssize_t i = 0;
+  while (i < IC_STAT_BUCKETS - 1 && us >= ((uint64_t)1 << i)) { i++; }
+  #endif
+  return (i < IC_STAT_BUCKETS - 1 ? i : IC_STAT_BUCKETS - 1);
+}
+
+ic_private void stats_add( ic_stat_hist_t* hist, int64_t elapsed_us ) {
+  const uint64_t us = (elapsed_us < 0 ? 0 : (uint64_t)elapsed_us);
+  hist->count++;
+  hist->total_us += us;
+  if (us > hist->max_us) { hist->max_us = us; }
+  hist->buckets[stats_bucket(us)]++;
+}
+
+ic_public uint64_t ic_stat_percentile( const ic_stat_hist_t* hist, double p ) {
+  if (hist == NULL || hist->count == 0) return 0;
+  if (p < 0.0) p = 0.0;
+  if (p > 1.0) p = 1.0;
+  uint64_t rank = (uint64_t)(p * (double)hist->count);
+  if (rank >= hist->count) { rank = hist->count - 1; }
+  uint64_t seen = 0;
+  for (ssize_t i = 0; i < IC_STAT_BUCKETS; i++) {
+    seen += hist->buckets[i];
+    if (seen > rank) {
+      const uint64_t bound = ((uint64_t)1 << i);
+      return (i == IC_STAT_BUCKETS - 1 || bound > hist->max_us ? hist->max_us : bound);
+    }
+  }
+  return hist->max_us;
+}
+
+
+//-------------------------------------------------------------
+// Output counters
+//-------------------------------------------------------------
+
+ic_private void stats_output_diff( const ic_stat_output_t* after, const ic_stat_output_t* before, ic_stat_output_t* diff ) {
+  diff->bytes      = after->bytes - before->bytes;
+  diff->writes     = after->writes - before->writes;
+  diff->flushes    = after->flushes - before->flushes;
+  diff->esc_sgr    = after->esc_sgr - before->esc_sgr;
+  diff->esc_cursor = after->esc_cursor - before->esc_cursor;
+  diff->esc_erase  = after->esc_erase - before->esc_erase;
+  diff->esc_other  = after->esc_other - before->esc_other;
+}
+
+
+//-------------------------------------------------------------
+// Print a summary
+//-------------------------------------------------------------
+
+static const char* stats_phase_names[IC_STAT_COUNT] = {
+  "wait", "decode", "edit", "highlight", "braces", "hint", "layout", "render", "flush", "key"
+};
+
+static const char* stats_mem_names[IC_MEM_COUNT] = {
+  "other", "history", "completions", "render", "undo", "bbcode"
+};
+
+ic_private void stats_print( const ic_stats_t* stats ) {
+  fprintf(stderr, "isocline: keys: %llu, frames: %llu (degraded: %llu)\n",
+           (unsigned long long)stats->keys, (unsigned long long)stats->frames,
+           (unsigned long long)stats->frames_degraded);
+  fprintf(stderr, "  %-10s %10s %10s %10s %10s %10s\n", "phase (us)", "count", "mean", "p50", "p99", "max");
+  for (ssize_t i = 0; i < IC_STAT_COUNT; i++) {
+    const ic_stat_hist_t* hist = &stats->phases[i];
+    if (hist->count == 0) continue;
+    fprintf(stderr, "  %-10s %10llu %10llu %10llu %10llu %10llu\n", stats_phase_names[i],
+             (unsigned long long)hist->count, (unsigned long long)(hist->total_us / hist->count),
+             (unsigned long long)ic_stat_percentile(hist, 0.50), (unsigned long long)ic_stat_percentile(hist, 0.99),
+             (unsigned long long)hist->max_us);
+  }
+  const ic_stat_output_t* out = &stats->output;
+  fprintf(stderr, "  output: %llu bytes in %llu writes (%llu flushes), max frame %llu bytes\n",
+           (unsigned long long)out->bytes, (unsigned long long)out->writes, (unsigned long long)out->flushes,
+           (unsigned long long)stats->frame_bytes_max);
+  fprintf(stderr, "  escapes: sgr %llu, cursor %llu, erase %llu, other %llu\n",
+           (unsigned long long)out->esc_sgr, (unsigned long long)out->esc_cursor, 
+           (unsigned long long)out->esc_erase, (unsigned long long)out->esc_other);
+  fprintf(stderr, "  %-11s %10s %10s %10s %12s %10s %10s\n", "memory", "mallocs", "reallocs", "frees", "bytes", "live", "peak");
+  for (ssize_t i = 0; i < IC_MEM_COUNT; i++) {
+    const ic_stat_alloc_t* st = &stats->memory[i];
+    if (st->mallocs == 0 && st->reallocs == 0 && st->live_bytes == 0) continue;
+    fprintf(stderr, "  %-11s %10llu %10llu %10llu %12llu %10llu %10llu\n", stats_mem_names[i],
+             (unsigned long long)st->mallocs, (unsigned long long)st->reallocs, (unsigned long long)st->frees,
+             (unsigned long long)st->bytes, (unsigned long long)st->live_bytes, (unsigned long long)st->peak_bytes);
+  }
+  fprintf(stderr, "  memory peak: %llu bytes\n", (unsigned long long)stats->memory_peak);
+}
@@ -0,0 +1,22 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+-----------------------------------------------------------------------------*/
+#pragma once
+#ifndef IC_STATS_H
+#define IC_STATS_H
+
+#include "../include/isocline.h"  // ic_stats_t
+#include "common.h"
+
+//-------------------------------------------------------------
+// Latency statistics
+//-------------------------------------------------------------
+
+ic_private void stats_add( ic_stat_hist_t* hist, int64_t elapsed_us );
+ic_private void stats_output_diff( const ic_stat_output_t* after, const ic_stat_output_t* before, ic_stat_output_t* diff );
+ic_private void stats_print( const ic_stats_t* stats );   // to stderr
+
+#endif // IC_STATS_H
@@ -26,6 +26,17 @@
 #include <string.h>
 #include <inttypes.h>
 
+#if defined(__AVX2__)
+#define IC_USE_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IC_USE_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(_MSC_VER) && (defined(IC_USE_AVX2) || defined(IC_USE_SSE2))
+#include <intrin.h>
+#endif
+
 #include "common.h"
 #include "stringbuf.h"
 
@@ -81,27 +92,69 @@ static ssize_t utf8_char_width( const char* s, ssize_t n ) {
 }
 
 
+static ssize_t column_width_adjust( ssize_t w ) {
+  #ifdef _WIN32
+  return (w <= 0 ? 1 : w); // windows console seems to use at least one column
+  #else
+  return w;
+  #endif
+}
+
 // The column width of a codepoint (0, 1, or 2)
 static ssize_t char_column_width( const char* s, ssize_t n ) {
   if (s == NULL || n <= 0) return 0;
   else if ((uint8_t)(*s) < ' ') return 0;   // also for CSI escape sequences
-  else {
-    ssize_t w = utf8_char_width(s, n);
-    #ifdef _WIN32
-    return (w <= 0 ? 1 : w); // windows console seems to use at least one column
-    #else
-    return w;
-    #endif
+  else return column_width_adjust(utf8_char_width(s, n));
+}
+
+// Printable ascii prefix where each byte is a single code point; a trailing
+// stray continuation byte is grouped with the last ascii character by `str_next_ofs`.
+static ssize_t str_ascii_run( const char* s, ssize_t len ) {
+  ssize_t n = str_ascii_prefix(s, len);
+  if (n > 0 && n < len && ((uint8_t)s[n] & 0xC0) == 0x80) n--;
+  return n;
+}
+
+// Validate and decode a single well-formed utf-8 sequence and return its length 
+// and column width. Returns 0 on a malformed sequence, or if it is followed 
+// by a stray continuation byte, so the caller can fall back to `str_next_ofs`.
+static ssize_t utf8_valid_char_width( const char* s, ssize_t len, ssize_t* cwidth ) {
+  const uint8_t* u = (const uint8_t*)s;
+  int32_t c;
+  ssize_t n;
+  if (u[0] >= 0xC2 && u[0] <= 0xDF)      { n = 2; c = u[0] & 0x1F; }
+  else if (u[0] >= 0xE0 && u[0] <= 0xEF) { n = 3; c = u[0] & 0x0F; }
+  else if (u[0] >= 0xF0 && u[0] <= 0xF4) { n = 4; c = u[0] & 0x07; }
+  else return 0;
+  if (len < n) return 0;
+  for (ssize_t i = 1; i < n; i++) {
+    if ((u[i] & 0xC0) != 0x80) return 0;
+    c = (c << 6) | (u[i] & 0x3F);
   }
+  // overlong, surrogate, or out of range
+  if ((n == 3 && c < 0x800) || (n == 4 && (c < 0x10000 || c > 0x10FFFF)) || (c >= 0xD800 && c <= 0xDFFF)) return 0;
+  if (len > n && (u[n] & 0xC0) == 0x80) return 0;
+  *cwidth = column_width_adjust(wcwidth(c));
+  return n;
 }
 
+// Column width of a byte range (up to a 0 byte). Printable ascii is counted
+// in bulk (16-32 bytes at a time), well-formed utf-8 is validated and decoded 
+// in a single pass, and anything else (escape sequences, control characters, 
+// malformed utf-8) is measured as in `str_next_ofs`.
 static ssize_t str_column_width_n( const char* s, ssize_t len ) {
   if (s == NULL || len <= 0) return 0;
   ssize_t pos = 0;
   ssize_t cwidth = 0;
-  ssize_t cw;
-  ssize_t ofs;
-  while (s[pos] != 0 && (ofs = str_next_ofs(s, len, pos, &cw)) > 0) {
+  while (pos < len) {
+    const ssize_t ascii = str_ascii_run(s + pos, len - pos);
+    cwidth += ascii;
+    pos += ascii;
+    if (pos >= len || s[pos] == 0) break;
+    ssize_t cw = 0;
+    ssize_t ofs = utf8_valid_char_width(s + pos, len - pos, &cw);
+    if (ofs <= 0) { ofs = str_next_ofs(s, len, pos, &cw); }
+    if (ofs <= 0) break;
     cwidth += cw;
     pos += ofs;
   }  
@@ -227,6 +280,76 @@ static ssize_t str_limit_to_length( const char* s, ssize_t n ) {
 }
 
 
+// Length of the prefix of printable ascii (0x20 to 0x7F) which can be copied as-is;
+// stops at the first byte >= 0x80, ESC, or other control character (including 0).
+// This is the hot loop for large outputs so we scan in 32/16/8 byte strides.
+#if defined(IC_USE_AVX2) || defined(IC_USE_SSE2)
+static inline ssize_t ic_ctz(uint32_t x) {
+  #if defined(_MSC_VER)
+  unsigned long idx;
+  _BitScanForward(&idx, x);
+  return (ssize_t)idx;
+  #else
+  return (ssize_t)__builtin_ctz(x);
+  #endif
+}
+#endif
+
+ic_private ssize_t str_ascii_prefix( const char* s, ssize_t len ) {
+  if (s == NULL) return 0;
+  ssize_t i = 0;
+  #if defined(IC_USE_AVX2)
+  const __m256i lo32 = _mm256_set1_epi8(0x20);
+  for (; i + 32 <= len; i += 32) {
+    // signed compare: bytes >= 0x80 are negative and thus also below 0x20
+    const __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+    const uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(lo32, v));
+    if (mask != 0) return i + ic_ctz(mask);
+  }
+  #endif
+  #if defined(IC_USE_AVX2) || defined(IC_USE_SSE2)
+  const __m128i lo16 = _mm_set1_epi8(0x20);
+  for (; i + 16 <= len; i += 16) {
+    const __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+    const uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmplt_epi8(v, lo16));
+    if (mask != 0) return i + ic_ctz(mask);
+  }
+  #else
+  // portable: test 8 bytes at a time for a byte < 0x20 or >= 0x80
+  const uint64_t ones = UINT64_C(0x0101010101010101);
+  const uint64_t highs = UINT64_C(0x8080808080808080);
+  for (; i + 8 <= len; i += 8) {
+    uint64_t w;
+    memcpy(&w, s + i, 8);
+    if ((((w - ones*0x20) & ~w) | w) & highs) break;  // find the exact byte below
+  }
+  #endif
+  while (i < len && (uint8_t)s[i] >= 0x20 && (uint8_t)s[i] < 0x80) {
+    i++;
+  }
+  return i;
+}
+
+ic_private ssize_t str_line_start( const char* s, ssize_t pos ) {
+  // scan back 8 bytes at a time until a word contains a newline (like `memrchr`)
+  const uint64_t ones = UINT64_C(0x0101010101010101);
+  const uint64_t highs = UINT64_C(0x8080808080808080);
+  while (pos >= 8) {
+    uint64_t w;
+    memcpy(&w, s + pos - 8, 8);
+    w ^= ones * '\n';  // newline bytes become zero
+    if (((w - ones) & ~w & highs) != 0) break;  // find the exact byte below
+    pos -= 8;
+  }
+  while (pos > 0 && s[pos-1] != '\n') { pos--; }
+  return pos;
+}
+
+ic_private ssize_t str_line_end( const char* s, ssize_t len, ssize_t pos ) {
+  const char* nl = (const char*)memchr(s + pos, '\n', to_size_t(len - pos));
+  return (nl == NULL ? len : (ssize_t)(nl - s));
+}
+
 //-------------------------------------------------------------
 // String searching prev/next word, line, ws_word
 //-------------------------------------------------------------
@@ -327,17 +450,30 @@ static ssize_t str_find_ws_word_end( const char* s, ssize_t len, ssize_t pos) {
 // String row/column iteration
 //-------------------------------------------------------------
 
-// invoke a function for each terminal row; returns total row count.
-static ssize_t str_for_each_row( const char* s, ssize_t len, ssize_t termw, ssize_t promptw, ssize_t cpromptw,
-                                 row_fun_t* fun, const void* arg, void* res ) 
+// invoke a function for each terminal row starting at the line start `start`; returns 
+// the row count (from `start`). The first row has prompt width `promptw` and all others `cpromptw`.
+static ssize_t str_for_each_row_from( const char* s, ssize_t len, ssize_t start, ssize_t termw, ssize_t promptw, ssize_t cpromptw,
+                                      row_fun_t* fun, const void* arg, void* res ) 
 {
   if (s == NULL) s = "";
   ssize_t i;
   ssize_t rcount = 0;
   ssize_t rcol = 0;
-  ssize_t rstart = 0;  
+  ssize_t rstart = start;  
   ssize_t startw  = promptw; 
-  for(i = 0; i < len; ) {
+  for(i = start; i < len; ) {
+    startw = (rcount == 0 ? promptw : cpromptw);
+    // advance over printable ascii in bulk as long as it fits on the current row
+    const ssize_t ascii = str_ascii_run(s + i, len - i);
+    if (ascii > 0) {
+      const ssize_t fit = (termw == 0 ? ascii : termw - startw - 2 - rcol);
+      if (fit > 0) {
+        const ssize_t n = (ascii < fit ? ascii : fit);
+        i += n;
+        rcol += n;
+        continue;
+      }
+    }
     ssize_t w;
     ssize_t next = str_next_ofs(s, len, i, &w);    
     if (next <= 0) {
@@ -345,7 +481,6 @@ static ssize_t str_for_each_row( const char* s, ssize_t len, ssize_t termw, ssiz
       assert(false);
       break;
     }
-    startw = (rcount == 0 ? promptw : cpromptw);
     ssize_t termcol = rcol + w + startw + 1 /* for the cursor */;
     if (termw != 0 && i != 0 && termcol >= termw) {  
       // wrap
@@ -375,6 +510,13 @@ static ssize_t str_for_each_row( const char* s, ssize_t len, ssize_t termw, ssiz
   return rcount+1;
 }
 
+// invoke a function for each terminal row; returns total row count.
+static ssize_t str_for_each_row( const char* s, ssize_t len, ssize_t termw, ssize_t promptw, ssize_t cpromptw,
+                                 row_fun_t* fun, const void* arg, void* res ) 
+{
+  return str_for_each_row_from(s, len, 0, termw, promptw, cpromptw, fun, arg, res);
+}
+
 //-------------------------------------------------------------
 // String: get row/column position
 //-------------------------------------------------------------
@@ -417,6 +559,49 @@ static ssize_t str_get_rc_at_pos(const char* s, ssize_t len, ssize_t termw, ssiz
   return rows;
 }
 
+// The rows of the line at `start`. Returns in `next` the start of the next line, or -1 if this was the last line.
+static ssize_t str_line_rows( const char* s, ssize_t len, ssize_t start, ssize_t termw, ssize_t promptw, ssize_t cpromptw, 
+                              ssize_t pos, rowcol_t* rc, ssize_t* next ) 
+{
+  // include the newline as it can cause a wrap itself; the row after it belongs to the next line
+  const ssize_t end = str_line_end(s, len, start);
+  *next = (end < len ? end + 1 : -1);
+  ssize_t rows = str_for_each_row_from(s, (end < len ? end + 1 : len), start, termw, (start == 0 ? promptw : cpromptw), cpromptw, 
+                                       (rc == NULL ? NULL : &str_get_current_pos_iter), &pos, rc);
+  return (end < len ? rows - 1 : rows);
+}
+
+// Like `str_get_rc_at_pos` but only lays out the lines around `pos` that can be visible in `termh` rows:
+// lines above the cursor until `termh` rows end at the cursor, and lines below until `termh` rows follow it.
+// The rows and `rc` are relative to the returned line start `start`. If the text fits in `termh` rows, 
+// `start` is 0 and the result is equal to `str_get_rc_at_pos`.
+static ssize_t str_get_rc_at_pos_near(const char* s, ssize_t len, ssize_t termw, ssize_t termh, ssize_t promptw, ssize_t cpromptw, 
+                                      ssize_t pos, rowcol_t* rc, ssize_t* start) 
+{
+  memset(rc, 0, sizeof(*rc));
+  if (pos < 0) pos = 0;
+  if (pos > len) pos = len;
+  ssize_t next;
+  const ssize_t line = str_line_start(s, pos);
+  const ssize_t rows_line = str_line_rows(s, len, line, termw, promptw, cpromptw, pos, rc, &next);
+  // lines above
+  ssize_t first = line;
+  ssize_t above = 0;
+  while (first > 0 && above < termh - 1 - rc->row) {
+    ssize_t ignore;
+    first = str_line_start(s, first - 1);
+    above += str_line_rows(s, len, first, termw, promptw, cpromptw, -1, NULL, &ignore);
+  }
+  // lines below
+  ssize_t below = 0;
+  while (next >= 0 && below < termh) {
+    below += str_line_rows(s, len, next, termw, promptw, cpromptw, -1, NULL, &next);
+  }
+  rc->row += above;
+  *start = first;
+  return (above + rows_line + below);
+}
+
 
 
 //-------------------------------------------------------------
@@ -541,6 +726,17 @@ static ssize_t str_get_pos_at_rc(const char* s, ssize_t len, ssize_t termw, ssiz
   return pos;
 }
 
+// Like `str_get_pos_at_rc` but with `row` relative to the line start `start` (see `str_get_rc_at_pos_near`).
+static ssize_t str_get_pos_at_rc_from(const char* s, ssize_t len, ssize_t start, ssize_t termw, ssize_t promptw, ssize_t cpromptw, ssize_t row, ssize_t col) {
+  rowcol_t rc;
+  memset(&rc,0,ssizeof(rc));
+  rc.row = row;
+  rc.col = col;
+  ssize_t pos = -1;
+  str_for_each_row_from(s,len,start,termw,(start == 0 ? promptw : cpromptw),cpromptw,&str_set_pos_iter,&rc,&pos);
+  return pos;
+}
+
 
 //-------------------------------------------------------------
 // String buffer
@@ -829,11 +1025,19 @@ ic_private ssize_t sbuf_get_pos_at_rc( stringbuf_t* sbuf, ssize_t termw, ssize_t
   return str_get_pos_at_rc( sbuf->buf, sbuf->count, termw, promptw, cpromptw, row, col);
 }
 
+ic_private ssize_t sbuf_get_pos_at_rc_from( stringbuf_t* sbuf, ssize_t start, ssize_t termw, ssize_t promptw, ssize_t cpromptw, ssize_t row, ssize_t col ) {
+  return str_get_pos_at_rc_from( sbuf->buf, sbuf->count, start, termw, promptw, cpromptw, row, col);
+}
+
 // get row/col for a given position
 ic_private ssize_t sbuf_get_rc_at_pos( stringbuf_t* sbuf, ssize_t termw, ssize_t promptw, ssize_t cpromptw, ssize_t pos, rowcol_t* rc ) {
   return str_get_rc_at_pos( sbuf->buf, sbuf->count, termw, promptw, cpromptw, pos, rc);
 }
 
+ic_private ssize_t sbuf_get_rc_at_pos_near( stringbuf_t* sbuf, ssize_t termw, ssize_t termh, ssize_t promptw, ssize_t cpromptw, ssize_t pos, rowcol_t* rc, ssize_t* start ) {
+  return str_get_rc_at_pos_near( sbuf->buf, sbuf->count, termw, termh, promptw, cpromptw, pos, rc, start);
+}
+
 ic_private ssize_t sbuf_get_wrapped_rc_at_pos( stringbuf_t* sbuf, ssize_t termw, ssize_t newtermw, ssize_t promptw, ssize_t cpromptw, ssize_t pos, rowcol_t* rc ) {
   return str_get_wrapped_rc_at_pos( sbuf->buf, sbuf->count, termw, newtermw, promptw, cpromptw, pos, rc);
 }
@@ -843,6 +1047,11 @@ ic_private ssize_t sbuf_for_each_row( stringbuf_t* sbuf, ssize_t termw, ssize_t
   return str_for_each_row( sbuf->buf, sbuf->count, termw, promptw, cpromptw, fun, arg, res);
 }
 
+ic_private ssize_t sbuf_for_each_row_from( stringbuf_t* sbuf, ssize_t start, ssize_t termw, ssize_t promptw, ssize_t cpromptw, row_fun_t* fun, void* arg, void* res ) {
+  if (sbuf == NULL) return 0;
+  return str_for_each_row_from( sbuf->buf, sbuf->count, start, termw, (start == 0 ? promptw : cpromptw), cpromptw, fun, arg, res);
+}
+
 
 // Duplicate and decode from utf-8 (for non-utf8 terminals)
 ic_private char* sbuf_strdup_from_utf8(stringbuf_t* sbuf) {
@@ -990,32 +1199,97 @@ ic_public bool ic_char_is_filename_letter(const char* s, long len) {
   return ((uint8_t)c >= 0x80 || (strchr(" \t\r\n`@$><=;|&{}()[]", c) == NULL));
 }
 
-// Convenience: If this is a token start, returns the length (or <= 0 if not found).
-ic_public long ic_is_token(const char* s, long pos, ic_is_char_class_fun_t* is_token_char) {
-  if (s == NULL || pos < 0 || is_token_char == NULL) return -1;
+
+//-------------------------------------------------------------
+// Character class descriptions
+//-------------------------------------------------------------
+
+// the predicates of the predefined classes (indexed by `ic_char_class_id_t`)
+static ic_is_char_class_fun_t* const char_class_funs[IC_CHAR_CLASS_COUNT] = {
+  NULL,
+  &ic_char_is_white, &ic_char_is_nonwhite,
+  &ic_char_is_separator, &ic_char_is_nonseparator,
+  &ic_char_is_letter, &ic_char_is_digit, &ic_char_is_hexdigit,
+  &ic_char_is_idletter, &ic_char_is_filename_letter
+};
+
+// Initialize by tabulating the predicate of a predefined class (so the two always agree).
+ic_public void ic_char_class_init( ic_char_class_t* cc, ic_char_class_id_t id ) {
+  if (cc == NULL) return;
+  memset(cc, 0, sizeof(*cc));
+  if ((int)id <= IC_CHAR_CLASS_EMPTY || (int)id >= IC_CHAR_CLASS_COUNT) return;
+  ic_is_char_class_fun_t* fun = char_class_funs[id];
+  for (int c = 1; c < 0x80; c++) {
+    const char s = (char)c;
+    if (fun(&s, 1)) { cc->ascii[c >> 5] |= (1U << (c & 31)); }
+  }
+  cc->non_ascii = (fun("\xC3\xA9", 2) ? 1 : 0);  // the predefined classes treat all non-ASCII alike
+}
+
+ic_public void ic_char_class_set_ascii( ic_char_class_t* cc, const char* chars, bool in_class ) {
+  if (cc == NULL || chars == NULL) return;
+  for (const char* p = chars; *p != 0; p++) {
+    const uint8_t c = (uint8_t)*p;
+    if (c >= 0x80) continue;
+    if (in_class) { cc->ascii[c >> 5] |= (1U << (c & 31)); }
+             else { cc->ascii[c >> 5] &= ~(1U << (c & 31)); }
+  }
+}
+
+ic_public bool ic_char_class_add_range( ic_char_class_t* cc, uint32_t lo, uint32_t hi ) {
+  if (cc == NULL) return false;
+  if (lo < 0x80) { lo = 0x80; }
+  if (hi < lo) return true;  // empty
+  if (cc->range_count >= IC_CHAR_CLASS_MAX_RANGES) return false;
+  cc->ranges[2*cc->range_count]     = lo;
+  cc->ranges[2*cc->range_count + 1] = hi;
+  cc->range_count++;
+  return true;
+}
+
+ic_public bool ic_char_class_contains( const ic_char_class_t* cc, const char* s, long len ) {
+  if (cc == NULL || s == NULL || len <= 0) return false;
+  const uint8_t c = (uint8_t)*s;
+  if (c < 0x80) {
+    return (((cc->ascii[c >> 5] >> (c & 31)) & 1) != 0);
+  }
+  bool in_range = false;
+  if (cc->range_count > 0) {
+    const unicode_t u = unicode_from_qutf8((const uint8_t*)s, len, NULL);
+    const uint32_t count = (cc->range_count < IC_CHAR_CLASS_MAX_RANGES ? cc->range_count : IC_CHAR_CLASS_MAX_RANGES);
+    for (uint32_t i = 0; i < count; i++) {
+      if (u >= cc->ranges[2*i] && u <= cc->ranges[2*i + 1]) { in_range = true; break; }
+    }
+  }
+  return ((cc->non_ascii != 0) != in_range);
+}
+
+
+//-------------------------------------------------------------
+// Tokens
+//-------------------------------------------------------------
+
+static long str_is_token(const char* s, long pos, const char_pred_t* is_token_char) {
+  if (s == NULL || pos < 0) return -1;
   ssize_t len = ic_strlen(s);
   if (pos >= len) return -1;
-  if (pos > 0 && is_token_char(s + pos -1, 1)) return -1; // token start?
+  if (pos > 0 && char_pred_is(is_token_char, s + pos - 1, 1)) return -1; // token start?
   ssize_t i = pos;
   while ( i < len ) {
     ssize_t next = str_next_ofs(s, len, i, NULL);
     if (next <= 0) return -1;
-    if (!is_token_char(s + i, (long)next)) break;
+    if (!char_pred_is(is_token_char, s + i, next)) break;
     i += next;
   }
   return (long)(i - pos);
 }
 
-
 static int ic_strncmp(const char* s1, const char* s2, ssize_t n) {
   return strncmp(s1, s2, to_size_t(n));
 }
 
-// Convenience: Does this match the specified token? 
-// Ensures not to match prefixes or suffixes, and returns the length of the match (in bytes).
-// E.g. `ic_match_token("function",0,&ic_char_is_letter,"fun")` returns 0.
-ic_public long ic_match_token(const char* s, long pos, ic_is_char_class_fun_t* is_token_char, const char* token) {
-  long n = ic_is_token(s, pos, is_token_char);
+static long str_match_token(const char* s, long pos, const char_pred_t* is_token_char, const char* token) {
+  long n = str_is_token(s, pos, is_token_char);
   if (n > 0 && token != NULL && n == ic_strlen(token) && ic_strncmp(s + pos, token, n) == 0) {
     return n;
   }
@@ -1024,13 +1298,8 @@ ic_public long ic_match_token(const char* s, long pos, ic_is_char_class_fun_t* i
   }
 }
 
-
-// Convenience: Do any of the specified tokens match? 
-// Ensures not to match prefixes or suffixes, and returns the length of the match (in bytes).
-// Ensures not to match prefixes or suffixes. 
-// E.g. `ic_match_any_token("function",0,&ic_char_is_letter,{"fun","func",NULL})` returns 0.
-ic_public long ic_match_any_token(const char* s, long pos, ic_is_char_class_fun_t* is_token_char, const char** tokens) {
-  long n = ic_is_token(s, pos, is_token_char);
+static long str_match_any_token(const char* s, long pos, const char_pred_t* is_token_char, const char** tokens) {
+  long n = str_is_token(s, pos, is_token_char);
   if (n <= 0 || tokens == NULL) return 0;
   for (const char** token = tokens; *token != NULL; token++) {
     if (n == ic_strlen(*token) && ic_strncmp(s + pos, *token, n) == 0) {
@@ -1040,3 +1309,49 @@ ic_public long ic_match_any_token(const char* s, long pos, ic_is_char_class_fun_
   return 0;
 }
 
+// Convenience: If this is a token start, returns the length (or <= 0 if not found).
+ic_public long ic_is_token(const char* s, long pos, ic_is_char_class_fun_t* is_token_char) {
+  if (is_token_char == NULL) return -1;
+  const char_pred_t pred = { is_token_char, NULL };
+  return str_is_token(s, pos, &pred);
+}
+
+// Convenience: Does this match the specified token? 
+// Ensures not to match prefixes or suffixes, and returns the length of the match (in bytes).
+// E.g. `ic_match_token("function",0,&ic_char_is_letter,"fun")` returns 0.
+ic_public long ic_match_token(const char* s, long pos, ic_is_char_class_fun_t* is_token_char, const char* token) {
+  if (is_token_char == NULL) return 0;
+  const char_pred_t pred = { is_token_char, NULL };
+  return str_match_token(s, pos, &pred, token);
+}
+
+
+// Convenience: Do any of the specified tokens match? 
+// Ensures not to match prefixes or suffixes, and returns the length of the match (in bytes).
+// Ensures not to match prefixes or suffixes. 
+// E.g. `ic_match_any_token("function",0,&ic_char_is_letter,{"fun","func",NULL})` returns 0.
+ic_public long ic_match_any_token(const char* s, long pos, ic_is_char_class_fun_t* is_token_char, const char** tokens) {
+  if (is_token_char == NULL) return 0;
+  const char_pred_t pred = { is_token_char, NULL };
+  return str_match_any_token(s, pos, &pred, tokens);
+}
+
+// The same with a character class description.
+ic_public long ic_is_token_class(const char* s, long pos, const ic_char_class_t* token_chars) {
+  if (token_chars == NULL) return -1;
+  const char_pred_t pred = { NULL, token_chars };
+  return str_is_token(s, pos, &pred);
+}
+
+ic_public long ic_match_token_class(const char* s, long pos, const ic_char_class_t* token_chars, const char* token) {
+  if (token_chars == NULL) return 0;
+  const char_pred_t pred = { NULL, token_chars };
+  return str_match_token(s, pos, &pred, token);
+}
+
+ic_public long ic_match_any_token_class(const char* s, long pos, const ic_char_class_t* token_chars, const char** tokens) {
+  if (token_chars == NULL) return 0;
+  const char_pred_t pred = { NULL, token_chars };
+  return str_match_any_token(s, pos, &pred, tokens);
+}
+
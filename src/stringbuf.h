@@ -88,9 +88,16 @@ typedef struct rowcol_s {
 // find row/col position
 ic_private ssize_t sbuf_get_pos_at_rc( stringbuf_t* sbuf, ssize_t termw, ssize_t promptw, ssize_t cpromptw, 
                                        ssize_t row, ssize_t col );
+// find row/col position where `row` is relative to the line start `start` (see `sbuf_get_rc_at_pos_near`)
+ic_private ssize_t sbuf_get_pos_at_rc_from( stringbuf_t* sbuf, ssize_t start, ssize_t termw, ssize_t promptw, ssize_t cpromptw, 
+                                            ssize_t row, ssize_t col );
 // get row/col for a given position
 ic_private ssize_t sbuf_get_rc_at_pos( stringbuf_t* sbuf, ssize_t termw, ssize_t promptw, ssize_t cpromptw, 
                                        ssize_t pos, rowcol_t* rc );
+// get row/col for a given position, laying out only the lines around it that can be visible
+// in `termh` rows; rows are relative to the returned line start `*start`
+ic_private ssize_t sbuf_get_rc_at_pos_near( stringbuf_t* sbuf, ssize_t termw, ssize_t termh, ssize_t promptw, ssize_t cpromptw, 
+                                            ssize_t pos, rowcol_t* rc, ssize_t* start );
 
 ic_private ssize_t sbuf_get_wrapped_rc_at_pos( stringbuf_t* sbuf, ssize_t termw, ssize_t newtermw, ssize_t promptw, ssize_t cpromptw, 
                                        ssize_t pos, rowcol_t* rc );
@@ -103,6 +110,8 @@ typedef bool (row_fun_t)(const char* s,
 
 ic_private ssize_t sbuf_for_each_row( stringbuf_t* sbuf, ssize_t termw, ssize_t promptw, ssize_t cpromptw, 
                                       row_fun_t* fun, void* arg, void* res );
+ic_private ssize_t sbuf_for_each_row_from( stringbuf_t* sbuf, ssize_t start, ssize_t termw, ssize_t promptw, ssize_t cpromptw, 
+                                           row_fun_t* fun, void* arg, void* res );
 
 
 //-------------------------------------------------------------
@@ -115,7 +124,25 @@ ic_private bool    skip_csi_esc( const char* s, ssize_t len, ssize_t* esclen );
 ic_private ssize_t str_column_width( const char* s );
 ic_private ssize_t str_prev_ofs( const char* s, ssize_t pos, ssize_t* cwidth );
 ic_private ssize_t str_next_ofs( const char* s, ssize_t len, ssize_t pos, ssize_t* cwidth );
+ic_private ssize_t str_ascii_prefix( const char* s, ssize_t len );  // printable ascii prefix
+ic_private ssize_t str_line_start( const char* s, ssize_t pos );               // offset after the previous newline
+ic_private ssize_t str_line_end( const char* s, ssize_t len, ssize_t pos );    // offset of the next newline (or `len`)
 ic_private ssize_t str_skip_until_fit( const char* s, ssize_t max_width);  // tail that fits
 ic_private ssize_t str_take_while_fit( const char* s, ssize_t max_width);  // prefix that fits
 
+
+//-------------------------------------------------------------
+// Character class predicates: either a user callback or a
+// character class description that is evaluated natively.
+//-------------------------------------------------------------
+
+typedef struct char_pred_s {
+  ic_is_char_class_fun_t* fun;
+  const ic_char_class_t*  cc;    // used if not NULL
+} char_pred_t;
+
+static inline bool char_pred_is( const char_pred_t* pred, const char* s, ssize_t len ) {
+  return (pred->cc != NULL ? ic_char_class_contains(pred->cc, s, (long)len) : (*pred->fun)(s, (long)len));
+}
+
 #endif // IC_STRINGBUF_H
@@ -14,6 +14,8 @@
 #include "tty.h"
 #include "term.h"
 #include "stringbuf.h" // str_next_ofs
+#include "trace.h"
+#include "vterm.h"
 
 #if defined(_WIN32)
 #include <windows.h>
@@ -22,6 +24,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>    // writev
 #if defined(__linux__)
 #include <linux/kd.h>
 #endif
@@ -38,6 +41,18 @@ typedef enum palette_e {
   ANSIRGB      // direct rgb colors supported (ESC[38;2;<r>;<g>;<b>m)
 } palette_t;
 
+// Large runs of plain text are not copied into the output buffer but 
+// borrowed: we record where they are inserted in the buffer and on a flush
+// the buffer fragments and borrowed runs are written with a single `writev`.
+#define IC_BORROW_MIN   (128)   // minimal text run length that is borrowed instead of copied
+#define IC_BORROW_MAX   (64)    // maximal borrowed runs before a flush (then we copy again)
+
+typedef struct borrow_s {
+  ssize_t       at;                 // insertion offset in the output buffer
+  const char*   s;                  // borrowed text (not owned)
+  ssize_t       len;
+} borrow_t;
+
 // The terminal screen
 struct term_s {
   int           fd_out;             // output handle
@@ -47,12 +62,22 @@ struct term_s {
   bool          nocolor;            // show colors?
   bool          silent;             // enable beep?
   bool          is_utf8;            // utf-8 output? determined by the tty
+  bool          sync_update;        // wrap buffered frames in synchronized output mode (DEC 2026)?
+  bool          probe_pending;      // are the capabilities (ansi colors) still to be probed?
+  bool          probe_dim;          // query the dimensions together with the capabilities?
+  bool          probe_revalidate;   // probe again when idle (after using cached results)?
+  bool          cache_revalidate;   // revalidate cached results?
+  char*         cache_fname;        // file to cache probe results (or NULL)
   attr_t   attr;               // current text attributes
   palette_t     palette;            // color support
   buffer_mode_t bufmode;            // buffer mode
   stringbuf_t*  buf;                // buffer for buffered output
+  borrow_t      borrows[IC_BORROW_MAX]; // borrowed text runs inserted in `buf`
+  ssize_t       borrow_count;
   tty_t*        tty;                // used on posix to get the cursor position
+  vterm_t*      vterm;              // if not NULL, output goes to this virtual terminal (not owned)
   alloc_t*      mem;                // allocator
+  ic_stat_output_t counters;        // output statistics
   #ifdef _WIN32
   HANDLE        hcon;               // output console handler
   WORD          hcon_default_attr;  // default text attributes
@@ -65,7 +90,9 @@ struct term_s {
 };
 
 static bool term_write_direct(term_t* term, const char* s, ssize_t n );
-static void term_append_buf(term_t* term, const char* s, ssize_t n);
+static bool term_write_direct_borrowed(term_t* term);
+static void term_end_borrow(term_t* term);
+static void term_append_buf(term_t* term, const char* s, ssize_t n, bool borrow);
 
 //-------------------------------------------------------------
 // Colors
@@ -77,23 +104,28 @@ static void term_append_buf(term_t* term, const char* s, ssize_t n);
 // Helpers
 //-------------------------------------------------------------
 
+// cursor movements are formatted directly into the buffer (bypassing `term_append_esc`) so we count them here
 ic_private void term_left(term_t* term, ssize_t n) {
   if (n <= 0) return;
+  term->counters.esc_cursor++;
   term_writef( term, IC_CSI "%zdD", n );
 }
 
 ic_private void term_right(term_t* term, ssize_t n) {
   if (n <= 0) return;
+  term->counters.esc_cursor++;
   term_writef( term, IC_CSI "%zdC", n );
 }
 
 ic_private void term_up(term_t* term, ssize_t n) {
   if (n <= 0) return;
+  term->counters.esc_cursor++;
   term_writef( term, IC_CSI "%zdA", n );
 }
 
 ic_private void term_down(term_t* term, ssize_t n) {
   if (n <= 0) return;
+  term->counters.esc_cursor++;
   term_writef( term, IC_CSI "%zdB", n );
 }
 
@@ -217,10 +249,15 @@ ic_private void term_write_formatted( term_t* term, const char* s, const attr_t*
   term_write_formatted_n( term, s, attrs, ic_strlen(s));
 }
 
-ic_private void term_write_formatted_n( term_t* term, const char* s, const attr_t* attrs, ssize_t len ) {
+static void term_write_formatted_ex( term_t* term, const char* s, const attr_t* attrs, ssize_t len, bool borrow ) {
   if (attrs == NULL) {
     // write directly
-    term_write(term,s);
+    term_append_buf(term, s, ic_strlen(s), borrow);
+  }
+  else if (term->nocolor) {
+    // no colors: write the text straight through without tracking attributes
+    const char* end = (const char*)memchr(s, 0, to_size_t(len));
+    term_append_buf(term, s, (end == NULL ? len : end - s), borrow);
   }
   else {
     // ensure raw mode from now on
@@ -235,7 +272,7 @@ ic_private void term_write_formatted_n( term_t* term, const char* s, const attr_
     while( i+n < len && s[i+n] != 0 ) {
       if (!attr_is_eq(attr,attrs[i+n])) {
         if (n > 0) { 
-          term_write_n( term, s+i, n );
+          term_append_buf( term, s+i, n, borrow );
           i += n;
           n = 0;
         }
@@ -245,7 +282,7 @@ ic_private void term_write_formatted_n( term_t* term, const char* s, const attr_
       n++;    
     }
     if (n > 0) {
-      term_write_n( term, s+i, n );
+      term_append_buf( term, s+i, n, borrow );
       i += n;
       n = 0;    
     }
@@ -254,6 +291,16 @@ ic_private void term_write_formatted_n( term_t* term, const char* s, const attr_
   }
 }
 
+ic_private void term_write_formatted_n( term_t* term, const char* s, const attr_t* attrs, ssize_t len ) {
+  term_write_formatted_ex(term, s, attrs, len, false);
+}
+
+// Write formatted without copying large text runs; see `term_write_borrow_n`.
+ic_private void term_write_formatted_borrow_n( term_t* term, const char* s, const attr_t* attrs, ssize_t len ) {
+  term_write_formatted_ex(term, s, attrs, len, true);
+  term_end_borrow(term);
+}
+
 //-------------------------------------------------------------
 // Write to the terminal
 // The buffered functions are used to reduce cursor flicker
@@ -282,7 +329,16 @@ ic_private void term_write(term_t* term, const char* s) {
 ic_private void term_write_n(term_t* term, const char* s, ssize_t n) {
   if (s == NULL || n <= 0) return;
   // write to buffer to reduce flicker and to process escape sequences (this may flush too)
-  term_append_buf(term, s, n);  
+  term_append_buf(term, s, n, false);  
+}
+
+// Write without copying large runs of plain text into the output buffer. 
+// The string `s` must stay valid until the next flush: inside a BUFFERED 
+// frame that is the end of the frame; otherwise we flush before returning.
+ic_private void term_write_borrow_n(term_t* term, const char* s, ssize_t n) {
+  if (s == NULL || n <= 0) return;
+  term_append_buf(term, s, n, true);
+  term_end_borrow(term);
 }
 
 
@@ -292,18 +348,59 @@ ic_private void term_write_n(term_t* term, const char* s, ssize_t n) {
 
 
 ic_private void term_flush(term_t* term) {
-  if (sbuf_len(term->buf) > 0) {
+  const uint64_t bytes = term->counters.bytes;
+  const ssize_t  borrowed = term->borrow_count;
+  if (term->borrow_count > 0) {
+    term->counters.flushes++;
+    term_write_direct_borrowed(term);
+    term->borrow_count = 0;
+    sbuf_clear(term->buf);
+  }
+  else if (sbuf_len(term->buf) > 0) {
+    term->counters.flushes++;
     //term_show_cursor(term,false);
     term_write_direct(term, sbuf_string(term->buf), sbuf_len(term->buf));
     //term_show_cursor(term,true);
     sbuf_clear(term->buf);
   }  
+  if (term->counters.bytes != bytes) {
+    ic_trace(flush, term->counters.bytes - bytes, borrowed);
+  }
+}
+
+// Borrowed text is only valid during the write call unless we are in a BUFFERED frame.
+static void term_end_borrow(term_t* term) {
+  if (term->borrow_count > 0 && term->bufmode != BUFFERED) {
+    term_flush(term);
+  }
+}
+
+ic_private const ic_stat_output_t* term_get_counters(const term_t* term) {
+  return &term->counters;
+}
+
+ic_private void term_reset_counters(term_t* term) {
+  memset(&term->counters, 0, sizeof(term->counters));
 }
 
+ic_private buffer_mode_t term_get_buffer_mode(const term_t* term) {
+  return term->bufmode;
+}
+
+// A BUFFERED region is a single frame: it is never flushed partially and,
+// if supported, wrapped in a synchronized update (DEC mode 2026) so the terminal
+// renders it atomically. Leaving the BUFFERED mode writes the frame at once.
 ic_private buffer_mode_t term_set_buffer_mode(term_t* term, buffer_mode_t mode) {
   buffer_mode_t oldmode = term->bufmode;
   if (oldmode != mode) {
-    if (mode == UNBUFFERED) {
+    if (mode == BUFFERED) {
+      if (term->sync_update) { sbuf_append(term->buf, IC_CSI "?2026h"); }
+    }
+    else if (oldmode == BUFFERED) {
+      if (term->sync_update) { sbuf_append(term->buf, IC_CSI "?2026l"); }
+      term_flush(term);
+    }
+    else if (mode == UNBUFFERED) {
       term_flush(term);
     }
     term->bufmode = mode;
@@ -312,6 +409,7 @@ ic_private buffer_mode_t term_set_buffer_mode(term_t* term, buffer_mode_t mode)
 }
 
 static void term_check_flush(term_t* term, bool contains_nl) {
+  if (term->bufmode == BUFFERED) return;  // the whole frame is flushed at once
   if (term->bufmode == UNBUFFERED || 
       sbuf_len(term->buf) > 4000 ||
       (term->bufmode == LINEBUFFERED && contains_nl)) 
@@ -320,6 +418,27 @@ static void term_check_flush(term_t* term, bool contains_nl) {
   }  
 }
 
+// Does the terminal support synchronized output (DEC private mode 2026)?
+// Most terminals ignore unknown private modes, but we only enable it for terminals 
+// known to implement it to be safe.
+static bool term_detect_sync_update(void) {
+  const char* eterm   = getenv("TERM");
+  const char* program = getenv("TERM_PROGRAM");
+  if (ic_contains(eterm,"dumb") || ic_contains(eterm,"linux")) return false;
+  if (getenv("WT_SESSION") != NULL) return true;            // Windows terminal
+  if (getenv("ITERM_SESSION_ID") != NULL) return true;      // iTerm2
+  if (getenv("KITTY_WINDOW_ID") != NULL) return true;       // kitty
+  if (getenv("WEZTERM_EXECUTABLE") != NULL) return true;    // WezTerm
+  if (getenv("ALACRITTY_WINDOW_ID") != NULL) return true;   // alacritty
+  if (ic_contains(program,"vscode") || ic_contains(program,"WezTerm") || ic_contains(program,"iTerm") ||
+      ic_contains(program,"ghostty") || ic_contains(program,"contour") || ic_contains(program,"mintty") ||
+      ic_contains(program,"tmux")) {
+    return true;
+  }
+  return (ic_contains(eterm,"kitty") || ic_contains(eterm,"alacritty") || ic_contains(eterm,"foot") ||
+          ic_contains(eterm,"wezterm") || ic_contains(eterm,"ghostty") || ic_contains(eterm,"contour"));
+}
+
 //-------------------------------------------------------------
 // Init
 //-------------------------------------------------------------
@@ -343,6 +462,7 @@ ic_private term_t* term_new(alloc_t* mem, tty_t* tty, bool nocolor, bool silent,
   term->buf     = sbuf_new(mem);  
   term->bufmode = LINEBUFFERED;
   term->attr    = attr_default();
+  term->sync_update = (isatty(term->fd_out) != 0 && term_detect_sync_update());
 
   // respect NO_COLOR
   if (getenv("NO_COLOR") != NULL) {
@@ -393,15 +513,16 @@ ic_private term_t* term_new(alloc_t* mem, tty_t* tty, bool nocolor, bool silent,
   if (env_lines != NULL)   { ic_atoz(env_lines, &term->height); }
   
   // initialize raw terminal output and terminal dimensions
+  // (the ansi colors are probed lazily so a cache can be set first)
+  term->probe_pending = (term->palette < ANSIRGB);
   term_init_raw(term);
-  term_update_dim(term);
   term_attr_reset(term);  // ensure we are at default settings
 
   return term;
 }
 
 ic_private bool term_is_interactive(const term_t* term) {
-  ic_unused(term);
+  if (term->vterm != NULL) return true;
   // check dimensions (0 is used for debuggers)
   // if (term->width <= 0) return false; 
   
@@ -422,6 +543,10 @@ ic_private bool term_enable_beep(term_t* term, bool enable) {
   return prev;
 }
 
+ic_private bool term_is_nocolor(const term_t* term) {
+  return term->nocolor;
+}
+
 ic_private bool term_enable_color(term_t* term, bool enable) {
   bool prev = !term->nocolor;
   term->nocolor = !enable;
@@ -433,6 +558,7 @@ ic_private void term_free(term_t* term) {
   term_flush(term);
   term_end_raw(term, true);
   sbuf_free(term->buf); term->buf = NULL;
+  mem_free(term->mem, term->cache_fname);
   mem_free(term->mem, term);
 }
 
@@ -444,10 +570,21 @@ ic_private void term_free(term_t* term) {
 //-------------------------------------------------------------
 
 static void term_append_esc(term_t* term, const char* const s, ssize_t len) {
-  if (s[1]=='[' && s[len-1] == 'm') {    
+  const char final = s[len-1];
+  if (s[1]=='[' && final == 'm') {    
     // it is a CSI SGR sequence: ESC[ ... m
-    if (term->nocolor) return;       // ignore escape sequences if nocolor is set
+    if (term->nocolor) return;       // strip without parsing if nocolor is set
     term->attr = attr_update_with(term->attr, attr_from_esc_sgr(s,len));
+    term->counters.esc_sgr++;
+  }
+  else if (s[1]=='[' && final != 0 && strchr("ABCDEFGHdf", final) != NULL) {
+    term->counters.esc_cursor++;
+  }
+  else if (s[1]=='[' && (final == 'J' || final == 'K')) {
+    term->counters.esc_erase++;
+  }
+  else {
+    term->counters.esc_other++;
   }
   // and write out the escape sequence as-is
   sbuf_append_n(term->buf, s, len);
@@ -475,26 +612,56 @@ static void term_append_utf8(term_t* term, const char* s, ssize_t len) {
   }
 }
 
-static void term_append_buf( term_t* term, const char* s, ssize_t len ) {
+// Borrow a text run instead of copying it into the output buffer.
+static bool term_append_borrow(term_t* term, const char* s, ssize_t len) {
+  if (term->borrow_count >= IC_BORROW_MAX) return false;
+  borrow_t* b = &term->borrows[term->borrow_count++];
+  b->at  = sbuf_len(term->buf);
+  b->s   = s;
+  b->len = len;
+  return true;
+}
+
+// Return the length of the run of text at `s` that can be written as-is:
+// ascii, the `\a` to `\r` control characters, and (non-raw) utf-8 sequences.
+static ssize_t term_plain_run(const char* s, ssize_t len, ssize_t* next, bool* newline) {
+  ssize_t run = 0;
+  while (true) {
+    run += str_ascii_prefix(s + run, len - run);  // skip printable ascii in bulk
+    if ((*next = str_next_ofs(s, len, run, NULL)) <= 0) break;
+    const uint8_t c = (uint8_t)s[run];
+    if (c >= 0x80) {
+      uint8_t raw;
+      if (unicode_is_raw(unicode_from_qutf8((const uint8_t*)s + run, *next, NULL), &raw)) break;
+    }
+    else if (c <= 0x1B && (c < '\x07' || c > '\x0D')) {
+      break;
+    }
+    else if (c == '\n') {
+      *newline = true;
+    }
+    run += *next;
+  }
+  return run;
+}
+
+static void term_append_buf( term_t* term, const char* s, ssize_t len, bool borrow ) {
   ssize_t pos = 0;
   bool newline = false;
   while (pos < len) {
-    // handle ascii sequences in bulk
-    ssize_t ascii = 0;
+    // handle plain text in bulk; long runs are borrowed if allowed
     ssize_t next;
-    while ((next = str_next_ofs(s, len, pos+ascii, NULL)) > 0 && 
-            (uint8_t)s[pos + ascii] > '\x1B' && (uint8_t)s[pos + ascii] <= 0x7F ) 
-    {
-      ascii += next;      
-    }
-    if (ascii > 0) {
-      sbuf_append_n(term->buf, s+pos, ascii);
-      pos += ascii;
+    ssize_t run = term_plain_run(s + pos, len - pos, &next, &newline);
+    if (run > 0) {
+      if (!(borrow && run >= IC_BORROW_MIN && term_append_borrow(term, s+pos, run))) {
+        sbuf_append_n(term->buf, s+pos, run);
+      }
+      pos += run;
     }
     if (next <= 0) break;
 
     const uint8_t c = (uint8_t)s[pos];
-    // handle utf8 sequences (for non-utf8 terminals)
+    // handle raw bytes in the qutf-8 encoding
     if (c >= 0x80) {
       term_append_utf8(term, s+pos, next);
     }
@@ -502,12 +669,8 @@ static void term_append_buf( term_t* term, const char* s, ssize_t len ) {
     else if (next > 1 && c == '\x1B') {
       term_append_esc(term, s+pos, next);
     }
-    else if (c < ' ' && c != 0 && (c < '\x07' || c > '\x0D')) {
-      // ignore control characters except \a, \b, \t, \n, \r, and form-feed and vertical tab.
-    }
     else {
-      if (c == '\n') { newline = true; }
-      sbuf_append_n(term->buf, s+pos, next);
+      // ignore control characters except \a, \b, \t, \n, \r, and form-feed and vertical tab.
     }
     pos += next;
   }  
@@ -515,6 +678,59 @@ static void term_append_buf( term_t* term, const char* s, ssize_t len ) {
   term_check_flush(term, newline);  
 }
 
+//-------------------------------------------------------------
+// Headless: write to a virtual terminal
+//-------------------------------------------------------------
+
+// A terminal that writes into the virtual terminal `vt` instead of an output
+// handle (and takes its dimensions from it). The real terminal is not touched.
+ic_private term_t* term_new_headless(alloc_t* mem, tty_t* tty, vterm_t* vt) {
+  term_t* term = mem_zalloc_tp(mem, term_t);
+  if (term == NULL) return NULL;
+  term->fd_out  = -1;
+  term->vterm   = vt;
+  term->silent  = true;
+  term->mem     = mem;
+  term->tty     = tty;
+  term->width   = vterm_get_width(vt);
+  term->height  = vterm_get_height(vt);
+  term->is_utf8 = true;
+  term->palette = ANSIRGB;
+  term->buf     = sbuf_new(mem);
+  term->bufmode = LINEBUFFERED;
+  term->attr    = attr_default();
+  term->sync_update = true;
+  term_attr_reset(term);
+  return term;
+}
+
+static bool term_write_vterm(term_t* term, const char* s, ssize_t n) {
+  vterm_write(term->vterm, s, n);
+  term->counters.writes++;
+  term->counters.bytes += to_size_t(n);
+  return true;
+}
+
+// the buffer fragments and borrowed runs in order (counted as a single write like `writev`)
+static bool term_write_vterm_borrowed(term_t* term) {
+  const char* buf = sbuf_string(term->buf);
+  ssize_t ofs = 0;
+  for (ssize_t i = 0; i < term->borrow_count; i++) {
+    const borrow_t* b = &term->borrows[i];
+    if (b->at > ofs) {
+      vterm_write(term->vterm, buf + ofs, b->at - ofs);
+      ofs = b->at;
+    }
+    vterm_write(term->vterm, b->s, b->len);
+    term->counters.bytes += to_size_t(b->len);
+  }
+  vterm_write(term->vterm, buf + ofs, sbuf_len(term->buf) - ofs);
+  term->counters.bytes += to_size_t(sbuf_len(term->buf));
+  term->counters.writes++;
+  return true;
+}
+
+
 //-------------------------------------------------------------
 // Platform dependent: Write directly to the terminal
 //-------------------------------------------------------------
@@ -523,11 +739,14 @@ static void term_append_buf( term_t* term, const char* s, ssize_t len ) {
 
 // write to the console without further processing
 static bool term_write_direct(term_t* term, const char* s, ssize_t n) {
+  if (term->vterm != NULL) return term_write_vterm(term, s, n);
   ssize_t count = 0; 
   while( count < n ) {
     ssize_t nwritten = write(term->fd_out, s + count, to_size_t(n - count));
+    term->counters.writes++;
     if (nwritten > 0) {
       count += nwritten;
+      term->counters.bytes += to_size_t(nwritten);
     }
     else if (errno != EINTR && errno != EAGAIN) {
       debug_msg("term: write failed: length %i, errno %i: \"%s\"\n", n, errno, s);
@@ -537,6 +756,53 @@ static bool term_write_direct(term_t* term, const char* s, ssize_t n) {
   return true;
 }
 
+// write the output buffer interleaved with the borrowed runs using a single `writev`
+static bool term_write_direct_borrowed(term_t* term) {
+  if (term->vterm != NULL) return term_write_vterm_borrowed(term);
+  struct iovec iov[2*IC_BORROW_MAX + 1];
+  int count = 0;
+  const char* buf = sbuf_string(term->buf);
+  ssize_t ofs = 0;
+  for (ssize_t i = 0; i < term->borrow_count; i++) {
+    const borrow_t* b = &term->borrows[i];
+    if (b->at > ofs) {
+      iov[count].iov_base = (void*)(buf + ofs);
+      iov[count].iov_len  = to_size_t(b->at - ofs);
+      count++;
+      ofs = b->at;
+    }
+    iov[count].iov_base = (void*)b->s;
+    iov[count].iov_len  = to_size_t(b->len);
+    count++;
+  }
+  if (sbuf_len(term->buf) > ofs) {
+    iov[count].iov_base = (void*)(buf + ofs);
+    iov[count].iov_len  = to_size_t(sbuf_len(term->buf) - ofs);
+    count++;
+  }
+  int i = 0;
+  while (i < count) {
+    ssize_t nwritten = writev(term->fd_out, iov + i, count - i);
+    term->counters.writes++;
+    if (nwritten < 0) {
+      if (errno == EINTR || errno == EAGAIN) continue;
+      debug_msg("term: writev failed: %i segments, errno %i\n", count - i, errno);
+      return false;
+    }
+    term->counters.bytes += to_size_t(nwritten);
+    // skip fully written segments and adjust a partially written one
+    while (i < count && to_size_t(nwritten) >= iov[i].iov_len) {
+      nwritten -= (ssize_t)iov[i].iov_len;
+      i++;
+    }
+    if (i < count) {
+      iov[i].iov_base = (void*)((const char*)iov[i].iov_base + nwritten);
+      iov[i].iov_len -= to_size_t(nwritten);
+    }
+  }
+  return true;
+}
+
 #else
 
 //----------------------------------------------------------------------------------
@@ -559,6 +825,8 @@ static bool term_write_console(term_t* term, const char* s, ssize_t n ) {
   DWORD written;
   // WriteConsoleA(term->hcon, s, (DWORD)(to_size_t(n)), &written, NULL);
   WriteFile(term->hcon, s, (DWORD)(to_size_t(n)), &written, NULL); // so it can be redirected
+  term->counters.writes++;
+  term->counters.bytes += written;
   return (written == (DWORD)(to_size_t(n)));
 }
 
@@ -810,6 +1078,7 @@ static void term_write_esc( term_t* term, const char* s, ssize_t len ) {
 }
 
 static bool term_write_direct(term_t* term, const char* s, ssize_t len ) {
+  if (term->vterm != NULL) return term_write_vterm(term, s, len);
   term_cursor_visible(term,false); // reduce flicker
   ssize_t pos = 0;    
   if ((term->hcon_mode & ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0) {
@@ -856,6 +1125,26 @@ static bool term_write_direct(term_t* term, const char* s, ssize_t len ) {
   return (pos == len); 
 
 }
+
+// there is no `writev` on windows; write the buffer fragments and borrowed runs in order
+static bool term_write_direct_borrowed(term_t* term) {
+  if (term->vterm != NULL) return term_write_vterm_borrowed(term);
+  const char* buf = sbuf_string(term->buf);
+  ssize_t ofs = 0;
+  bool ok = true;
+  for (ssize_t i = 0; i < term->borrow_count; i++) {
+    const borrow_t* b = &term->borrows[i];
+    if (b->at > ofs) {
+      ok = term_write_direct(term, buf + ofs, b->at - ofs) && ok;
+      ofs = b->at;
+    }
+    ok = term_write_direct(term, b->s, b->len) && ok;
+  }
+  if (sbuf_len(term->buf) > ofs) {
+    ok = term_write_direct(term, buf + ofs, sbuf_len(term->buf) - ofs) && ok;
+  }
+  return ok;
+}
 #endif
 
 
@@ -866,43 +1155,109 @@ static bool term_write_direct(term_t* term, const char* s, ssize_t len ) {
 
 #if !defined(_WIN32)
 
-// send escape query that may return a response on the tty
-static bool term_esc_query_raw( term_t* term, const char* query, char* buf, ssize_t buflen ) 
-{
-  if (buf==NULL || buflen <= 0 || query[0] == 0) return false;
-  bool osc = (query[1] == ']');
-  if (!term_write_direct(term, query, ic_strlen(query))) return false;
-  debug_msg("term: read tty query response to: ESC %s\n", query + 1);  
-  return tty_read_esc_response( term->tty, query[1], osc, buf, buflen );
-}
+//-------------------------------------------------------------
+// Batched escape queries
+// All queries are written at once, followed by a primary device 
+// attributes query (DA1) that every terminal answers. Responses 
+// arrive in order, so once the DA1 response is read any query 
+// without a response is unsupported. We wait for all responses 
+// together with a single timeout.
+//-------------------------------------------------------------
 
-static bool term_esc_query( term_t* term, const char* query, char* buf, ssize_t buflen ) 
-{
-  if (!tty_start_raw(term->tty)) return false;  
-  bool ok = term_esc_query_raw(term,query,buf,buflen);  
-  tty_end_raw(term->tty);
-  return ok;
+#define IC_PROBE_MAX  (20)
+
+typedef struct probe_s {
+  char    query[32];       // escape sequence to send
+  char    kind;            // expected response: '[' (CSI) or ']' (OSC)
+  char    final;           // final character of a CSI response (or 0)
+  char    prefix[8];       // expected prefix of the response
+  bool    ok;              // did we receive a response?
+  char    response[128];   // the response (without the ESC and `kind`)
+} probe_t;
+
+typedef struct probes_s {
+  ssize_t count;
+  probe_t probes[IC_PROBE_MAX];
+} probes_t;
+
+static probe_t* probes_add( probes_t* ps, const char* query, char kind, char final, const char* prefix ) {
+  if (ps->count >= IC_PROBE_MAX) return NULL;
+  probe_t* p = &ps->probes[ps->count++];
+  memset(p, 0, sizeof(*p));
+  ic_strcpy(p->query, ssizeof(p->query), query);
+  ic_strcpy(p->prefix, ssizeof(p->prefix), prefix);
+  p->kind  = kind;
+  p->final = final;
+  return p;
+}
+
+static bool probe_matches( const probe_t* p, char kind, const char* response ) {
+  if (p->ok || p->kind != kind) return false;
+  const ssize_t len = ic_strlen(response);
+  if (p->final != 0 && (len == 0 || response[len-1] != p->final)) return false;
+  return (strncmp(response, p->prefix, strlen(p->prefix)) == 0);
+}
+
+// Send all probes in one write and match the responses as they arrive.
+// Returns `true` if the terminal responded to all probes that it supports.
+static bool term_probe( term_t* term, probes_t* ps ) {
+  if (ps->count <= 0 || ps->count >= IC_PROBE_MAX) return false;
+  const ssize_t count = ps->count;
+  probe_t* da1 = probes_add(ps, "\x1B[c", '[', 'c', "?");
+  char query[IC_PROBE_MAX * 32];
+  ssize_t len = 0;
+  for (ssize_t i = 0; i < ps->count; i++) {
+    const ssize_t n = ic_strlen(ps->probes[i].query);
+    ic_memcpy(query + len, ps->probes[i].query, n);
+    len += n;
+  }
+  const bool in_raw = tty_is_raw(term->tty);  // already in raw mode while editing
+  if (in_raw || tty_start_raw(term->tty)) {
+    if (term_write_direct(term, query, len)) {
+      debug_msg("term: probe %zd queries\n", count);
+      const int64_t deadline = ic_time_us() + 1000*tty_esc_response_timeout(term->tty);
+      int64_t now;
+      while (!da1->ok && (now = ic_time_us()) < deadline) {
+        char kind;
+        char response[128];
+        if (!tty_read_esc_response_any(term->tty, (long)((deadline - now + 999)/1000), &kind, response, ssizeof(response))) break;
+        for (ssize_t i = 0; i < ps->count; i++) {
+          probe_t* p = &ps->probes[i];
+          if (probe_matches(p, kind, response)) {
+            p->ok = true;
+            ic_strcpy(p->response, ssizeof(p->response), response);
+            break;
+          }
+        }
+      }
+      if (!da1->ok) { debug_msg("term: probe: no (complete) response\n"); }
+    }
+    if (!in_raw) { tty_end_raw(term->tty); }
+    tty_typeahead_restore(term->tty);  // after ending raw mode as that clears the push back buffer
+  }
+  ps->count = count;  // remove the DA1 probe
+  return da1->ok;
 }
 
-// get the cursor position via an ESC[6n
-static bool term_get_cursor_pos( term_t* term, ssize_t* row, ssize_t* col) 
-{
-  // send escape query
-  char buf[128];
-  if (!term_esc_query(term,"\x1B[6n",buf,128)) return false; 
-  if (!ic_atoz2(buf,row,col)) return false;
-  return true;
+// Query the dimensions by moving the cursor to the bottom right and reading back its position.
+static probe_t* term_probe_dim_add( probes_t* ps ) {
+  return probes_add(ps, "\x1B" "7" "\x1B[999;999H" "\x1B[6n" "\x1B" "8", '[', 'R', "");
 }
 
-static void term_set_cursor_pos( term_t* term, ssize_t row, ssize_t col ) {
-  term_writef( term, IC_CSI "%zd;%zdH", row, col );
+static bool term_probe_dim_get( const probe_t* p, ssize_t* rows, ssize_t* cols ) {
+  if (p == NULL || !p->ok) return false;
+  return ic_atoz2(p->response, rows, cols);
 }
 
 ic_private bool term_update_dim(term_t* term) {  
   ssize_t cols = 0;
   ssize_t rows = 0;
   struct winsize ws;
-  if (ioctl(term->fd_out, TIOCGWINSZ, &ws) >= 0) {
+  if (term->vterm != NULL) {
+    cols = vterm_get_width(term->vterm);
+    rows = vterm_get_height(term->vterm);
+  }
+  else if (ioctl(term->fd_out, TIOCGWINSZ, &ws) >= 0) {
     // ioctl succeeded
     cols = ws.ws_col;  // debuggers return 0 for the column
     rows = ws.ws_row;
@@ -910,21 +1265,13 @@ ic_private bool term_update_dim(term_t* term) {
   else {
     // determine width by querying the cursor position
     debug_msg("term: ioctl term-size failed: %d,%d\n", ws.ws_row, ws.ws_col);
-    ssize_t col0 = 0;
-    ssize_t row0 = 0;
-    if (term_get_cursor_pos(term,&row0,&col0)) {
-      term_set_cursor_pos(term,999,999);
-      ssize_t col1 = 0;
-      ssize_t row1 = 0;
-      if (term_get_cursor_pos(term,&row1,&col1)) {
-        cols = col1;
-        rows = row1;
-      }
-      term_set_cursor_pos(term,row0,col0);
-    }
-    else {
+    probes_t ps;
+    ps.count = 0;
+    const probe_t* p = term_probe_dim_add(&ps);
+    term_probe(term, &ps);
+    if (!term_probe_dim_get(p, &rows, &cols)) {
       // cannot query position
-      // return 0 column
+      rows = cols = 0;
     }
   }
 
@@ -938,6 +1285,13 @@ ic_private bool term_update_dim(term_t* term) {
   return changed;  
 }
 
+ic_private ssize_t term_peek_width(term_t* term) {
+  if (term->vterm != NULL) return vterm_get_width(term->vterm);
+  struct winsize ws;
+  if (ioctl(term->fd_out, TIOCGWINSZ, &ws) < 0) return 0;
+  return ws.ws_col;
+}
+
 #else
 
 ic_private bool term_update_dim(term_t* term) {
@@ -947,7 +1301,11 @@ ic_private bool term_update_dim(term_t* term) {
   ssize_t rows = 0;
   ssize_t cols = 0;  
   CONSOLE_SCREEN_BUFFER_INFO sbinfo;  
-  if (GetConsoleScreenBufferInfo(term->hcon, &sbinfo)) {
+  if (term->vterm != NULL) {
+    cols = vterm_get_width(term->vterm);
+    rows = vterm_get_height(term->vterm);
+  }
+  else if (GetConsoleScreenBufferInfo(term->hcon, &sbinfo)) {
      cols = (ssize_t)sbinfo.srWindow.Right - (ssize_t)sbinfo.srWindow.Left + 1;
      rows = (ssize_t)sbinfo.srWindow.Bottom - (ssize_t)sbinfo.srWindow.Top + 1;
   }
@@ -958,6 +1316,13 @@ ic_private bool term_update_dim(term_t* term) {
   return changed;
 }
 
+ic_private ssize_t term_peek_width(term_t* term) {
+  if (term->vterm != NULL) return vterm_get_width(term->vterm);
+  CONSOLE_SCREEN_BUFFER_INFO sbinfo;  
+  if (term->hcon == 0 || !GetConsoleScreenBufferInfo(term->hcon, &sbinfo)) return 0;
+  return (ssize_t)sbinfo.srWindow.Right - (ssize_t)sbinfo.srWindow.Left + 1;
+}
+
 #endif
 
 
@@ -984,13 +1349,8 @@ ic_private void term_end_raw(term_t* term, bool force) {
   }
 }
 
-static bool term_esc_query_color_raw(term_t* term, int color_idx, uint32_t* color ) {
-  char buf[128+1];
-  snprintf(buf,128,"\x1B]4;%d;?\x1B\\", color_idx);
-  if (!term_esc_query_raw( term, buf, buf, 128 )) {
-    debug_msg("esc query response not received\n");
-    return false;
-  }
+// parse an OSC 4 color response: `4;<idx>;rgb:<r>/<g>/<b>`
+static bool term_parse_color_response(const char* buf, uint32_t* color ) {
   if (buf[0] != '4') return false;
   const char* rgb = strchr(buf,':');
   if (rgb==NULL) return false;
@@ -1007,8 +1367,18 @@ static bool term_esc_query_color_raw(term_t* term, int color_idx, uint32_t* colo
   return true;
 }
 
-// update ansi 16 color palette for better color approximation
-static void term_update_ansi16(term_t* term) {
+// query the ansi colors with OSC 4 escape sequences?
+#if !defined(IC_PROBE_ANSI_COLORS)
+#if defined(__APPLE__)
+#define IC_PROBE_ANSI_COLORS  1
+#else
+#define IC_PROBE_ANSI_COLORS  0
+#endif
+#endif
+
+// update ansi 16 color palette for better color approximation;
+// adds probes to `ps` if the colors need to be queried (see `term_update_ansi16_probed`).
+static bool term_update_ansi16(term_t* term, probes_t* ps) {
   debug_msg("update ansi colors\n");
   #if defined(GIO_CMAP)
   // try ioctl first (on Linux)
@@ -1021,37 +1391,218 @@ static void term_update_ansi16(term_t* term) {
       debug_msg("term (ioctl) ansi color %d: 0x%06x\n", i, color);
       ansi256[i] = color;
     }
-    return;
+    return false;
   }
   else {
     debug_msg("ioctl GIO_CMAP failed: entry 1: 0x%02x%02x%02x\n", cmap[3], cmap[4], cmap[5]);
   }
   #endif
   // this seems to be unreliable on some systems (Ubuntu+Gnome terminal) so only enable when known ok.
-  #if __APPLE__
-  // otherwise use OSC 4 escape sequence query
-  if (tty_start_raw(term->tty)) {
-    for(ssize_t i = 0; i < 16; i++) {
-      uint32_t color;
-      if (!term_esc_query_color_raw(term, i, &color)) break;
-      debug_msg("term ansi color %d: 0x%06x\n", i, color);
-      ansi256[i] = color;
-    }  
-    tty_end_raw(term->tty);  
+  #if IC_PROBE_ANSI_COLORS
+  // otherwise use OSC 4 escape sequence queries
+  for(int i = 0; i < 16; i++) {
+    char query[32];
+    char prefix[8];
+    snprintf(query, sizeof(query), "\x1B]4;%d;?\x1B\\", i);
+    snprintf(prefix, sizeof(prefix), "4;%d;", i);
+    if (probes_add(ps, query, ']', 0, prefix) == NULL) return false;
   }
+  return true;
+  #else
+  ic_unused(term); ic_unused(ps);
+  return false;
   #endif
 }
 
+// set the ansi 16 colors from the responses of the first 16 probes
+static void term_update_ansi16_probed(const probes_t* ps) {
+  for(ssize_t i = 0; i < 16 && i < ps->count; i++) {
+    uint32_t color;
+    if (!ps->probes[i].ok || !term_parse_color_response(ps->probes[i].response, &color)) continue;
+    debug_msg("term ansi color %zd: 0x%06x\n", i, color);
+    ansi256[i] = color;
+  }
+}
+
 static void term_init_raw(term_t* term) {
+  struct winsize ws;
+  if (term->vterm == NULL && ioctl(term->fd_out, TIOCGWINSZ, &ws) < 0) {
+    // query the dimensions in the same round trip as the ansi colors (see `term_probe_caps`)
+    term->probe_dim = true;
+    term->probe_pending = true;
+  }
+  else {
+    term_update_dim(term);
+  }
+}
+
+//-------------------------------------------------------------
+// Cache of probe results
+// Each line in the cache file is an entry of the form
+// `<key>\t<palette>\t<utf8>\t<color0>,...,<color15>` where the
+// key consists of TERM, TERM_PROGRAM, TERM_PROGRAM_VERSION, and
+// the tty name. The most recent entry comes first.
+//-------------------------------------------------------------
+
+#define IC_CACHE_MAX  (16)    // maximum entries in the cache file
+
+static void term_cache_key( term_t* term, char* key, ssize_t keylen ) {
+  const char* tname = ttyname(term->fd_out);
+  const char* eterm = getenv("TERM");
+  const char* program = getenv("TERM_PROGRAM");
+  const char* version = getenv("TERM_PROGRAM_VERSION");
+  snprintf(key, to_size_t(keylen), "%s|%s|%s|%s", (eterm != NULL ? eterm : ""), (program != NULL ? program : ""), 
+                                                  (version != NULL ? version : ""), (tname != NULL ? tname : ""));
+  for (char* p = key; *p != 0; p++) {
+    if (*p == '\t' || *p == '\n' || *p == '\r') { *p = ' '; }
+  }
+}
+
+// parse an entry; returns `false` if the key or the detected capabilities do not match.
+static bool term_cache_entry_parse( term_t* term, char* line, const char* key, uint32_t colors[16] ) {
+  char* tab = strchr(line, '\t');
+  if (tab == NULL) return false;
+  *tab = 0;
+  if (strcmp(line, key) != 0) return false;
+  int palette, utf8, n;
+  if (sscanf(tab+1, "%d\t%d\t%n", &palette, &utf8, &n) != 2) return false;
+  if (palette != (int)term->palette || (utf8 != 0) != term->is_utf8) return false;  // outdated
+  const char* s = tab + 1 + n;
+  for (int i = 0; i < 16; i++) {
+    unsigned int color;
+    if (sscanf(s, "%x", &color) != 1) return false;
+    colors[i] = color & 0xFFFFFF;
+    s = strchr(s, ',');
+    if (s == NULL) return (i == 15);
+    s++;
+  }
+  return true;
+}
+
+static bool term_cache_load( term_t* term, const char* key, uint32_t colors[16] ) {
+  FILE* f = fopen(term->cache_fname, "r");
+  if (f == NULL) return false;
+  bool found = false;
+  char line[512];
+  while (!found && fgets(line, sizeof(line), f) != NULL) {
+    found = term_cache_entry_parse(term, line, key, colors);
+  }
+  fclose(f);
+  debug_msg("term: cache %s: %s\n", (found ? "hit" : "miss"), key);
+  return found;
+}
+
+static void term_cache_save( term_t* term, const char* key, const uint32_t colors[16] ) {
+  stringbuf_t* sb = sbuf_new(term->mem);
+  if (sb == NULL) return;
+  // new entry first
+  sbuf_appendf(sb, "%s\t%d\t%d\t", key, (int)term->palette, (term->is_utf8 ? 1 : 0));
+  for (int i = 0; i < 16; i++) {
+    sbuf_appendf(sb, (i == 0 ? "%06x" : ",%06x"), colors[i]);
+  }
+  sbuf_append(sb, "\n");
+  // followed by the other existing entries
+  FILE* f = fopen(term->cache_fname, "r");
+  if (f != NULL) {
+    const ssize_t keylen = ic_strlen(key);
+    int entries = 1;
+    char line[512];
+    while (entries < IC_CACHE_MAX && fgets(line, sizeof(line), f) != NULL) {
+      if (strncmp(line, key, to_size_t(keylen)) == 0 && line[keylen] == '\t') continue;
+      if (strchr(line, '\n') == NULL) continue;  // too long
+      sbuf_append(sb, line);
+      entries++;
+    }
+    fclose(f);
+  }
+  f = fopen(term->cache_fname, "w");
+  if (f != NULL) {
+    fputs(sbuf_string(sb), f);
+    fclose(f);
+  }
+  sbuf_free(sb);
+}
+
+ic_private void term_set_cache( term_t* term, const char* fname, bool revalidate ) {
+  mem_free(term->mem, term->cache_fname);
+  term->cache_fname = (fname != NULL ? mem_strdup(term->mem, fname) : NULL);
+  term->cache_revalidate = revalidate;
+}
+
+// set the ansi colors from the probe responses and update the cache
+static void term_probed_ansi16( term_t* term, const char* key, const probes_t* ps ) {
+  uint32_t colors[16];
+  for (int i = 0; i < 16; i++) { colors[i] = ansi256[i]; }
+  term_update_ansi16_probed(ps);
+  bool changed = false;
+  for (int i = 0; i < 16; i++) { 
+    if (colors[i] != ansi256[i]) { changed = true; }
+    colors[i] = ansi256[i]; 
+  }
+  if (changed) { rgb_caches_clear(); }
+  if (term->cache_fname != NULL) {
+    term_cache_save(term, key, colors);
+  }
+}
+
+// probe the ansi colors and update the cache
+static void term_probe_ansi16( term_t* term, const char* key ) {
+  probes_t ps;
+  ps.count = 0;
+  if (!term_update_ansi16(term, &ps)) return;   // colors are known, or cannot be probed
+  if (!term_probe(term, &ps)) return;
+  term_probed_ansi16(term, key, &ps);
+}
+
+// probe the ansi colors (unless cached) and the dimensions (if needed) with a single round trip.
+ic_private void term_probe_caps( term_t* term ) {
+  if (!term->probe_pending) return;
+  term->probe_pending = false;
+  probes_t ps;
+  ps.count = 0;
+  char key[256];
+  bool probe_colors = false;
   if (term->palette < ANSIRGB) {
-    term_update_ansi16(term);
+    term_cache_key(term, key, ssizeof(key));
+    uint32_t colors[16];
+    if (term->cache_fname != NULL && term_cache_load(term, key, colors)) {
+      for (int i = 0; i < 16; i++) { ansi256[i] = colors[i]; }
+      term->probe_revalidate = term->cache_revalidate;
+    }
+    else {
+      probe_colors = term_update_ansi16(term, &ps);
+    }
+  }
+  const probe_t* pdim = NULL;
+  if (term->probe_dim) {
+    term->probe_dim = false;
+    pdim = term_probe_dim_add(&ps);
+  }
+  if (ps.count == 0) return;
+  const bool complete = term_probe(term, &ps);
+  if (probe_colors && complete) {
+    term_probed_ansi16(term, key, &ps);
+  }
+  ssize_t rows, cols;
+  if (term_probe_dim_get(pdim, &rows, &cols) && cols > 0) {
+    term->width = cols;
+    term->height = rows;
   }
 }
 
+ic_private void term_revalidate_caps( term_t* term ) {
+  if (!term->probe_revalidate) return;
+  term->probe_revalidate = false;
+  char key[256];
+  term_cache_key(term, key, ssizeof(key));
+  term_probe_ansi16(term, key);
+}
+
 #else
 
 ic_private void term_start_raw(term_t* term) {
   if (term->raw_enabled++ > 0) return;  
+  if (term->vterm != NULL) return;  // headless
   CONSOLE_SCREEN_BUFFER_INFO info;
   if (GetConsoleScreenBufferInfo(term->hcon, &info)) {
     term->hcon_orig_attr = info.wAttributes;
@@ -1088,6 +1639,7 @@ ic_private void term_end_raw(term_t* term, bool force) {
   }
   else {
     term->raw_enabled = 0;
+    if (term->vterm != NULL) return;  // headless
     SetConsoleMode(term->hcon, term->hcon_orig_mode);
     SetConsoleOutputCP(term->hcon_orig_cp);
     SetConsoleTextAttribute(term->hcon, term->hcon_orig_attr);
@@ -1119,6 +1671,22 @@ static void term_init_raw(term_t* term) {
   }
   term_start_raw(term); // initialize the hcon_mode
   term_end_raw(term,false);
+  term_update_dim(term);
+}
+
+// the console colors are read directly so there is nothing to probe or cache.
+ic_private void term_set_cache( term_t* term, const char* fname, bool revalidate ) {
+  mem_free(term->mem, term->cache_fname);
+  term->cache_fname = (fname != NULL ? mem_strdup(term->mem, fname) : NULL);
+  term->cache_revalidate = revalidate;
+}
+
+ic_private void term_probe_caps( term_t* term ) {
+  term->probe_pending = false;
+}
+
+ic_private void term_revalidate_caps( term_t* term ) {
+  ic_unused(term);
 }
 
 #endif
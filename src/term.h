@@ -8,10 +8,12 @@
 #ifndef IC_TERM_H
 #define IC_TERM_H
 
+#include "../include/isocline.h"  // ic_stat_output_t
 #include "common.h"
 #include "tty.h"
 #include "stringbuf.h"
 #include "attr.h"
+#include "vterm.h"
 
 struct term_s;
 typedef struct term_s term_t;
@@ -26,17 +28,28 @@ typedef enum buffer_mode_e {
 ic_private term_t* term_new(alloc_t* mem, tty_t* tty, bool nocolor, bool silent, int fd_out);
 ic_private void term_free(term_t* term);
 
+ic_private term_t* term_new_headless(alloc_t* mem, tty_t* tty, vterm_t* vt);  // write to a virtual terminal instead
+
 ic_private bool term_is_interactive(const term_t* term);
 ic_private void term_start_raw(term_t* term);
 ic_private void term_end_raw(term_t* term, bool force);
 
 ic_private bool term_enable_beep(term_t* term, bool enable);
 ic_private bool term_enable_color(term_t* term, bool enable);
+ic_private bool term_is_nocolor(const term_t* term);
+
+ic_private void term_set_cache(term_t* term, const char* fname, bool revalidate);
+ic_private void term_probe_caps(term_t* term);       // probe the capabilities (and dimensions) if not done yet
+ic_private void term_revalidate_caps(term_t* term);  // probe again if cached results were used
 
 ic_private void term_flush(term_t* term);
 ic_private buffer_mode_t term_set_buffer_mode(term_t* term, buffer_mode_t mode);
+ic_private buffer_mode_t term_get_buffer_mode(const term_t* term);
+ic_private const ic_stat_output_t* term_get_counters(const term_t* term);  // output statistics
+ic_private void term_reset_counters(term_t* term);
 
 ic_private void term_write_n(term_t* term, const char* s, ssize_t n);
+ic_private void term_write_borrow_n(term_t* term, const char* s, ssize_t n);
 ic_private void term_write(term_t* term, const char* s);
 ic_private void term_writeln(term_t* term, const char* s);
 ic_private void term_write_char(term_t* term, char c);
@@ -45,6 +58,7 @@ ic_private void term_write_repeat(term_t* term, const char* s, ssize_t count );
 ic_private void term_beep(term_t* term);
 
 ic_private bool term_update_dim(term_t* term);
+ic_private ssize_t term_peek_width(term_t* term);  // current width if cheaply available (or 0); does not update the dimensions
 
 ic_private ssize_t term_get_width(term_t* term);
 ic_private ssize_t term_get_height(term_t* term);
@@ -79,6 +93,7 @@ ic_private attr_t term_get_attr( const term_t* term );
 ic_private void   term_set_attr( term_t* term, attr_t attr );
 ic_private void   term_write_formatted( term_t* term, const char* s, const attr_t* attrs );
 ic_private void   term_write_formatted_n( term_t* term, const char* s, const attr_t* attrs, ssize_t n );
+ic_private void   term_write_formatted_borrow_n( term_t* term, const char* s, const attr_t* attrs, ssize_t n );
 
 ic_private ic_color_t color_from_ansi256(ssize_t i);
 
@@ -234,9 +234,19 @@ static int rgb_match( uint32_t* palette, int start, int len, rgb_cache_t* cache,
 }
 
 
+static rgb_cache_t ansi256_cache;
+static rgb_cache_t ansi16_cache;
+static rgb_cache_t ansi8_cache;
+
+// clear the caches when the ansi colors change
+static void rgb_caches_clear(void) {
+  memset(&ansi256_cache, 0, sizeof(ansi256_cache));
+  memset(&ansi16_cache, 0, sizeof(ansi16_cache));
+  memset(&ansi8_cache, 0, sizeof(ansi8_cache));
+}
+
 // Match RGB to an index in the ANSI 256 color table
 static int rgb_to_ansi256(ic_color_t color) {
-  static rgb_cache_t ansi256_cache;
   int c = rgb_match(ansi256, 16, 256, &ansi256_cache, color); // not the first 16 ANSI colors as those may be different 
   //debug_msg("term: rgb %x -> ansi 256: %d\n", color, c );
   return c;
@@ -248,7 +258,6 @@ static int color_to_ansi16(ic_color_t color) {
     return (int)color;
   }
   else {
-    static rgb_cache_t ansi16_cache;
     int c = rgb_match(ansi256, 0, 16, &ansi16_cache, color);
     //debug_msg("term: rgb %x -> ansi 16: %d\n", color, c );
     return (c < 8 ? 30 + c : 90 + c - 8); 
@@ -263,7 +272,6 @@ static int color_to_ansi8(ic_color_t color) {
   }
   else {
     // match to basic 8 colors first
-    static rgb_cache_t ansi8_cache;
     int c = 30 + rgb_match(ansi256, 0, 8, &ansi8_cache, color);
     // and then adjust for brightness
     int r, g, b;
@@ -330,6 +338,7 @@ static void fmt_color_ex(char* buf, ssize_t len, palette_t palette, ic_color_t c
 }
 
 static void term_color_ex(term_t* term, ic_color_t color, bool bg) {
+  term_probe_caps(term);
   char buf[128+1];
   fmt_color_ex(buf,128,term->palette,color,bg);
   term_write(term,buf);
@@ -348,12 +357,14 @@ ic_private void term_bgcolor(term_t* term, ic_color_t color) {
 }
 
 ic_private void term_append_color(term_t* term, stringbuf_t* sbuf, ic_color_t color) {
+  term_probe_caps(term);
   char buf[128+1];
   fmt_color_ex(buf,128,term->palette,color,false);
   sbuf_append(sbuf,buf);
 }
 
 ic_private void term_append_bgcolor(term_t* term, stringbuf_t* sbuf, ic_color_t color) {
+  term_probe_caps(term);
   char buf[128+1];
   fmt_color_ex(buf, 128, term->palette, color, true);
   sbuf_append(sbuf, buf);
@@ -0,0 +1,202 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+-----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#include "common.h"
+#include "trace.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+//-------------------------------------------------------------
+// Ring buffer of trace events
+// Writers claim an entry with an atomic increment and publish it
+// by storing its sequence number last; the reader (`trace_flush`)
+// skips entries that are incomplete or were overwritten while
+// reading. Only formatting a debug message costs more than a few
+// stores; no I/O happens until the buffer is flushed.
+//-------------------------------------------------------------
+
+#if defined(IC_NO_DEBUG_MSG)
+
+ic_private bool trace_is_enabled( void ) {
+  return false;
+}
+
+ic_public void ic_trace_flush( void ) {
+  // nothing
+}
+
+#else
+
+#define IC_TRACE_LEN   (1024)    // entries in the ring buffer (a power of 2)
+#define IC_TRACE_MSG   (104)     // maximal length of a debug message
+
+typedef struct trace_entry_s {
+  uint64_t  seq;                 // index + 1 once the entry is complete
+  int64_t   time;                // in micro seconds
+  int64_t   args[2];
+  int       event;               // trace_event_t
+  char      msg[IC_TRACE_MSG];   // for `TRACE_msg`
+} trace_entry_t;
+
+static trace_entry_t* trace_ring;    // allocated when tracing is enabled
+static uint64_t       trace_next;    // next entry index to write
+static uint64_t       trace_read;    // next entry index to flush
+static int64_t        trace_start;   // time tracing started
+static int            trace_state;   // 0: uninitialized, 1: enabled, -1: disabled
+
+static const char* trace_names[TRACE_COUNT] = {
+  "msg", "key", "frame", "flush", "degrade", "resize"
+};
+
+#if defined(_WIN32)
+static uint64_t trace_claim(void) {
+  return (uint64_t)InterlockedIncrement64((volatile LONG64*)&trace_next) - 1;
+}
+static void trace_publish(trace_entry_t* e, uint64_t seq) {
+  MemoryBarrier(); e->seq = seq;
+}
+static uint64_t trace_seq(const trace_entry_t* e) {
+  uint64_t seq = *((volatile const uint64_t*)&e->seq); MemoryBarrier(); return seq;
+}
+static uint64_t trace_claimed(void) {
+  uint64_t next = *((volatile const uint64_t*)&trace_next); MemoryBarrier(); return next;
+}
+#elif defined(__GNUC__)
+static uint64_t trace_claim(void) {
+  return __atomic_fetch_add(&trace_next, 1, __ATOMIC_RELAXED);
+}
+static void trace_publish(trace_entry_t* e, uint64_t seq) {
+  __atomic_store_n(&e->seq, seq, __ATOMIC_RELEASE);
+}
+static uint64_t trace_seq(const trace_entry_t* e) {
+  return __atomic_load_n(&e->seq, __ATOMIC_ACQUIRE);
+}
+static uint64_t trace_claimed(void) {
+  return __atomic_load_n(&trace_next, __ATOMIC_ACQUIRE);
+}
+#else
+static uint64_t trace_claim(void) { return trace_next++; }
+static void trace_publish(trace_entry_t* e, uint64_t seq) { e->seq = seq; }
+static uint64_t trace_seq(const trace_entry_t* e) { return e->seq; }
+static uint64_t trace_claimed(void) { return trace_next; }
+#endif
+
+#if defined(IC_DEBUG_TO_FILE)
+static const char* trace_fname = "isocline.debug.txt";
+#endif
+
+// enabled by `ISOCLINE_DEBUG=1` (checked once)
+static bool trace_init(void) {
+  if (trace_state == 0) {
+    trace_state = -1;
+    const char* rdebug = getenv("ISOCLINE_DEBUG");
+    if (rdebug != NULL && strcmp(rdebug,"0") != 0) {
+      #if defined(IC_DEBUG_TO_FILE)
+      FILE* fdbg = fopen(trace_fname, "w");  // truncate
+      if (fdbg == NULL) return false;
+      fclose(fdbg);
+      #endif
+      trace_ring = (trace_entry_t*)calloc(IC_TRACE_LEN, sizeof(trace_entry_t));
+      if (trace_ring != NULL) {
+        trace_start = ic_time_us();
+        trace_state = 1;
+      }
+    }
+  }
+  return (trace_state > 0);
+}
+
+ic_private bool trace_is_enabled( void ) {
+  return trace_init();
+}
+
+static trace_entry_t* trace_begin( trace_event_t event, uint64_t* seq ) {
+  const uint64_t idx = trace_claim();
+  trace_entry_t* e = &trace_ring[idx & (IC_TRACE_LEN-1)];
+  trace_publish(e, 0);  // invalidate while writing
+  e->time  = ic_time_us();
+  e->event = (int)event;
+  *seq = idx + 1;
+  return e;
+}
+
+ic_private void trace_add( trace_event_t event, int64_t a0, int64_t a1 ) {
+  if (trace_state <= 0 && !trace_init()) return;
+  uint64_t seq;
+  trace_entry_t* e = trace_begin(event, &seq);
+  e->args[0] = a0;
+  e->args[1] = a1;
+  trace_publish(e, seq);
+}
+
+ic_private void debug_msg( const char* fmt, ... ) {
+  if (trace_state <= 0 && !trace_init()) return;
+  uint64_t seq;
+  trace_entry_t* e = trace_begin(TRACE_msg, &seq);
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(e->msg, IC_TRACE_MSG, fmt, args);
+  va_end(args);
+  e->args[0] = n;
+  e->args[1] = 0;
+  trace_publish(e, seq);
+}
+
+static void trace_write_entry( FILE* f, const trace_entry_t* e ) {
+  const long long t = (long long)(e->time - trace_start);
+  if (e->event == TRACE_msg) {
+    const size_t len = strlen(e->msg);
+    fprintf(f, "%10lld: %s%s%s", t, e->msg, (e->args[0] >= IC_TRACE_MSG ? "..." : ""),
+                                 (len == 0 || e->msg[len-1] != '\n' ? "\n" : ""));
+  }
+  else if (e->event >= 0 && e->event < TRACE_COUNT) {
+    fprintf(f, "%10lld: trace: %s %lld %lld\n", t, trace_names[e->event], (long long)e->args[0], (long long)e->args[1]);
+  }
+}
+
+// write out all events since the last flush
+ic_private void trace_flush( void ) {
+  if (trace_state <= 0) return;
+  const uint64_t next = trace_claimed();
+  if (next == trace_read) return;
+  #if defined(IC_DEBUG_TO_FILE)
+  FILE* f = fopen(trace_fname, "a");
+  if (f == NULL) return;
+  #else
+  FILE* f = stderr;
+  #endif
+  if (next - trace_read > IC_TRACE_LEN) {
+    fprintf(f, "trace: %llu events dropped\n", (unsigned long long)(next - trace_read - IC_TRACE_LEN));
+    trace_read = next - IC_TRACE_LEN;
+  }
+  for (; trace_read < next; trace_read++) {
+    const trace_entry_t* e = &trace_ring[trace_read & (IC_TRACE_LEN-1)];
+    const uint64_t seq = trace_read + 1;
+    if (trace_seq(e) != seq) continue;        // not yet complete, or overwritten
+    trace_entry_t copy = *e;
+    if (trace_seq(e) != seq) continue;        // overwritten while copying
+    copy.msg[IC_TRACE_MSG-1] = 0;
+    trace_write_entry(f, &copy);
+  }
+  #if defined(IC_DEBUG_TO_FILE)
+  fclose(f);
+  #else
+  fflush(f);
+  #endif
+}
+
+ic_public void ic_trace_flush( void ) {
+  trace_flush();
+}
+
+#endif
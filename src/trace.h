@@ -0,0 +1,52 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+-----------------------------------------------------------------------------*/
+#pragma once
+#ifndef IC_TRACE_H
+#define IC_TRACE_H
+
+#include "common.h"
+
+//-------------------------------------------------------------
+// Tracing
+// Events are recorded in an in-memory ring buffer (if enabled
+// by `ISOCLINE_DEBUG=1`) and written out when the editor is idle,
+// at exit, or on demand (`ic_trace_flush`).
+// With `IC_USE_USDT` each event is also a static USDT probe
+// (provider `isocline`) for use with perf, bpftrace, etc.
+//-------------------------------------------------------------
+
+typedef enum trace_event_e {
+  TRACE_msg,      // debug message (len)
+  TRACE_key,      // key read (code, decode time in us)
+  TRACE_frame,    // frame rendered (rows, bytes)
+  TRACE_flush,    // output flushed (bytes, borrowed runs)
+  TRACE_degrade,  // render quality changed (level, frame cost in us)
+  TRACE_resize,   // terminal resized (width, height)
+  TRACE_COUNT
+} trace_event_t;
+
+#if defined(IC_USE_USDT)
+#include <sys/sdt.h>
+#define IC_USDT(name,a0,a1)   DTRACE_PROBE2(isocline, name, a0, a1)
+#else
+#define IC_USDT(name,a0,a1)   (void)(0)
+#endif
+
+#if defined(IC_NO_DEBUG_MSG)
+#define ic_trace(name,a0,a1)  do { const int64_t _a0 = (int64_t)(a0); const int64_t _a1 = (int64_t)(a1); \
+                                   IC_USDT(name,_a0,_a1); (void)_a0; (void)_a1; } while(0)
+#define trace_flush()         (void)(0)
+#else
+#define ic_trace(name,a0,a1)  do { const int64_t _a0 = (int64_t)(a0); const int64_t _a1 = (int64_t)(a1); \
+                                   IC_USDT(name,_a0,_a1); trace_add(TRACE_##name,_a0,_a1); } while(0)
+ic_private void trace_add( trace_event_t event, int64_t a0, int64_t a1 );
+ic_private void trace_flush( void );
+#endif
+
+ic_private bool trace_is_enabled( void );
+
+#endif // IC_TRACE_H
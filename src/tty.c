@@ -35,6 +35,15 @@ WINBASEAPI ULONGLONG WINAPI GetTickCount64(VOID);
 
 #define TTY_PUSH_MAX (32)
 
+// A recorded input event (see `tty_record_start`)
+typedef struct tty_event_s {
+  int64_t   time;     // micro seconds since the start of the recording
+  char      kind;     // 'k': key, 't': read timed out, 's': terminal size
+  code_t    code;     // key code
+  ssize_t   width;    // terminal size
+  ssize_t   height;
+} tty_event_t;
+
 struct tty_s {
   int       fd_in;                  // input handle
   bool      raw_enabled;            // is raw mode enabled?
@@ -46,14 +55,31 @@ struct tty_s {
   ssize_t   push_count;               
   uint8_t   cpushbuf[TTY_PUSH_MAX]; // low level push back buffer for bytes
   ssize_t   cpush_count;
+  uint8_t   typeahead[TTY_PUSH_MAX]; // input read while waiting for escape responses (see `tty_typeahead_restore`)
+  ssize_t   typeahead_count;
   long      esc_initial_timeout;    // initial ms wait to see if ESC starts an escape sequence
   long      esc_timeout;            // follow up delay for characters in an escape sequence
+  int64_t   key_time;               // time the last key started to arrive (in micro seconds)
+  bool      headless;               // read from `input` instead of the input handle?
+  char*     input;                  // scripted input (if headless)
+  ssize_t   input_len;
+  ssize_t   input_pos;
+  vterm_t*  vterm;                  // virtual terminal that is resized on replay (if headless)
+  FILE*     record;                 // record the input events to this file (or NULL)
+  int64_t   record_start;           // time the recording started
+  ssize_t   record_width;           // last recorded terminal size
+  ssize_t   record_height;
+  tty_event_t* replay;              // events to replay instead of reading input (if headless)
+  ssize_t   replay_count;
+  ssize_t   replay_pos;
+  int       wakeup_fd;              // wake up a read when this handle is readable (or -1)
   #if defined(_WIN32)               
   HANDLE    hcon;                   // console input handle
   DWORD     hcon_orig_mode;         // original console mode
   #else
   struct termios  orig_ios;         // original terminal settings
   struct termios  raw_ios;          // raw terminal settings
+  bool      signals_installed;      // signal handlers are installed on the first raw mode
   #endif
 };
 
@@ -63,6 +89,7 @@ struct tty_s {
 //-------------------------------------------------------------
 
 ic_private bool tty_readc_noblock(tty_t* tty, uint8_t* c, long timeout_ms);  // does not modify `c` when no input (false is returned)
+static int tty_wait_wakeup(tty_t* tty, long timeout_ms);  // 1: input is available, 0: timeout, -1: woken up
 
 //-------------------------------------------------------------
 // Key code helpers
@@ -143,18 +170,42 @@ static code_t tty_read_utf8( tty_t* tty, uint8_t c0 ) {
 // pop a code from the pushback buffer.
 static bool tty_code_pop(tty_t* tty, code_t* code);
 
+static void tty_record(tty_t* tty, char kind, code_t code);
+static bool tty_replay_read(tty_t* tty, long timeout_ms, code_t* code);
+
 
 // read a single char/key 
 ic_private bool tty_read_timeout(tty_t* tty, long timeout_ms, code_t* code) 
 {
   // is there a push_count back code?
   if (tty_code_pop(tty,code)) {
+    tty->key_time = ic_time_us();
     return code;
   }
 
+  // replay a recording?
+  if (tty->replay != NULL) return tty_replay_read(tty, timeout_ms, code);
+
+  // wait for input, or for background tasks that are done
+  if (tty->wakeup_fd >= 0 && tty->cpush_count == 0) {
+    const int res = tty_wait_wakeup(tty, timeout_ms);
+    if (res < 0) {
+      *code = KEY_EVENT_TASK;
+      return true;
+    }
+    else if (res == 0) {
+      tty_record(tty, 't', 0);
+      return false;
+    }
+  }
+
   // read a single char/byte from a character stream
   uint8_t c;
-  if (!tty_readc_noblock(tty, &c, timeout_ms)) return false;
+  if (!tty_readc_noblock(tty, &c, timeout_ms)) {
+    tty_record(tty, 't', 0);
+    return false;
+  }
+  tty->key_time = ic_time_us();  // the rest of the key is decoded from here
   
   if (c == KEY_ESC) {
     // escape sequence?
@@ -174,6 +225,7 @@ ic_private bool tty_read_timeout(tty_t* tty, long timeout_ms, code_t* code)
   }
 
   *code = modify_code(*code);
+  tty_record(tty, 'k', *code);
   return true;
 }
 
@@ -223,7 +275,10 @@ static code_t modify_code( code_t code ) {
 ic_private code_t tty_read(tty_t* tty)
 {
   code_t code;
-  if (!tty_read_timeout(tty, -1, &code)) return KEY_NONE;
+  if (!tty_read_timeout(tty, -1, &code)) {
+    if (tty->term_resize_event) return KEY_EVENT_RESIZE;
+    return (tty->headless ? KEY_EVENT_STOP : KEY_NONE);  // stop at the end of the scripted input
+  }
   return code;
 }
 
@@ -231,16 +286,16 @@ ic_private code_t tty_read(tty_t* tty)
 // Read back an ANSI query response
 //-------------------------------------------------------------
 
-ic_private bool tty_read_esc_response(tty_t* tty, char esc_start, bool final_st, char* buf, ssize_t buflen ) 
+ic_private long tty_esc_response_timeout(const tty_t* tty) {
+  return 2*tty->esc_initial_timeout;
+}
+
+// read the response after the initial ESC and start character
+static bool tty_read_esc_response_body(tty_t* tty, bool final_st, char* buf, ssize_t buflen ) 
 {
-  buf[0] = 0;
   ssize_t len = 0;
   uint8_t c = 0;
-  if (!tty_readc_noblock(tty, &c, 2*tty->esc_initial_timeout) || c != '\x1B') {
-    debug_msg("initial esc response failed: 0x%02x\n", c);
-    return false;
-  }
-  if (!tty_readc_noblock(tty, &c, tty->esc_timeout) || (c != esc_start)) return false;
+  buflen--;  // for the terminating zero
   while( len < buflen ) {
     if (!tty_readc_noblock(tty, &c, tty->esc_timeout)) return false;
     if (final_st) {
@@ -271,6 +326,64 @@ ic_private bool tty_read_esc_response(tty_t* tty, char esc_start, bool final_st,
   return true;
 }
 
+ic_private bool tty_read_esc_response(tty_t* tty, char esc_start, bool final_st, char* buf, ssize_t buflen ) 
+{
+  buf[0] = 0;
+  uint8_t c = 0;
+  if (!tty_readc_noblock(tty, &c, tty_esc_response_timeout(tty)) || c != '\x1B') {
+    debug_msg("initial esc response failed: 0x%02x\n", c);
+    return false;
+  }
+  if (!tty_readc_noblock(tty, &c, tty->esc_timeout) || (c != esc_start)) return false;
+  return tty_read_esc_response_body(tty, final_st, buf, buflen);
+}
+
+static void tty_typeahead_add(tty_t* tty, uint8_t c) {
+  if (tty->typeahead_count >= TTY_PUSH_MAX) {
+    debug_msg("tty: type-ahead buffer full! (dropping 0x%02x)\n", c);
+    return;
+  }
+  tty->typeahead[tty->typeahead_count++] = c;
+}
+
+// Read any CSI, OSC, or DCS response within `timeout_ms`; 
+// the kind of response is returned in `esc_start` (as '[', ']', or 'P').
+// Other input (type-ahead) is stashed with `esc_start` set to 0, and
+// can be pushed back in order with `tty_typeahead_restore` once all 
+// responses are read.
+ic_private bool tty_read_esc_response_any(tty_t* tty, long timeout_ms, char* esc_start, char* buf, ssize_t buflen ) 
+{
+  buf[0] = 0;
+  *esc_start = 0;
+  uint8_t c = 0;
+  if (!tty_readc_noblock(tty, &c, timeout_ms)) return false;
+  if (c != '\x1B') {
+    tty_typeahead_add(tty, c);  
+    return true;
+  }
+  uint8_t c1 = 0;
+  if (!tty_readc_noblock(tty, &c1, tty->esc_timeout)) {
+    tty_typeahead_add(tty, c);  // a lone ESC
+    return true;
+  }
+  if (c1 != '[' && c1 != ']' && c1 != 'P') {
+    tty_typeahead_add(tty, c);
+    tty_typeahead_add(tty, c1);
+    return true;
+  }
+  *esc_start = (char)c1;
+  return tty_read_esc_response_body(tty, (c1 != '['), buf, buflen);
+}
+
+// Push back the type-ahead input that was read by `tty_read_esc_response_any`.
+ic_private void tty_typeahead_restore(tty_t* tty) {
+  if (tty == NULL) return;
+  for (ssize_t i = tty->typeahead_count - 1; i >= 0 && tty->cpush_count < TTY_PUSH_MAX; i--) {
+    tty->cpushbuf[tty->cpush_count++] = tty->typeahead[i];
+  }
+  tty->typeahead_count = 0;
+}
+
 //-------------------------------------------------------------
 // High level code pushback
 //-------------------------------------------------------------
@@ -397,6 +510,7 @@ ic_private tty_t* tty_new(alloc_t* mem, int fd_in)
   tty_t* tty = mem_zalloc_tp(mem, tty_t);
   tty->mem = mem;
   tty->fd_in = (fd_in < 0 ? STDIN_FILENO : fd_in);
+  tty->wakeup_fd = -1;
   #if defined(__APPLE__)
   tty->esc_initial_timeout = 200;  // apple use ESC+<key> for alt-<key>
   #else
@@ -416,14 +530,209 @@ ic_private void tty_free(tty_t* tty) {
   if (tty==NULL) return;
   tty_end_raw(tty);
   tty_done_raw(tty);
+  mem_free(tty->mem,tty->input);
+  mem_free(tty->mem,tty->replay);
+  if (tty->record != NULL) { fclose(tty->record); }
   mem_free(tty->mem,tty);
 }
 
+//-------------------------------------------------------------
+// Headless: read scripted input instead of the input handle
+//-------------------------------------------------------------
+
+ic_private tty_t* tty_new_headless(alloc_t* mem, vterm_t* vt) {
+  tty_t* tty = mem_zalloc_tp(mem, tty_t);
+  if (tty == NULL) return NULL;
+  tty->mem = mem;
+  tty->fd_in = -1;
+  tty->wakeup_fd = -1;
+  tty->headless = true;
+  tty->vterm = vt;
+  tty->is_utf8 = true;
+  tty->has_term_resize_event = true;
+  tty->esc_initial_timeout = 0;  // all input is available at once
+  tty->esc_timeout = 0;
+  return tty;
+}
+
+// Append `keys` (raw bytes, including escape sequences) to the scripted input.
+ic_private bool tty_headless_push(tty_t* tty, const char* keys, ssize_t len) {
+  if (tty == NULL || !tty->headless || keys == NULL || len <= 0) return false;
+  if (tty->input_pos > 0) {
+    // drop the consumed prefix
+    tty->input_len -= tty->input_pos;
+    memmove(tty->input, tty->input + tty->input_pos, to_size_t(tty->input_len));
+    tty->input_pos = 0;
+  }
+  char* input = mem_realloc_tp(tty->mem, char, tty->input, tty->input_len + len);
+  if (input == NULL) return false;
+  memcpy(input + tty->input_len, keys, to_size_t(len));
+  tty->input = input;
+  tty->input_len += len;
+  return true;
+}
+
+static bool tty_readc_headless(tty_t* tty, uint8_t* c) {
+  if (tty->input_pos >= tty->input_len) return false;
+  *c = (uint8_t)tty->input[tty->input_pos++];
+  return true;
+}
+
+
+//-------------------------------------------------------------
+// Record and replay
+// A recording is a text file with one event per line:
+//   <time> key <code>      a key code (hexadecimal) was read
+//   <time> timeout         a read timed out (or was interrupted)
+//   <time> size <w> <h>    the terminal size when editing starts or after a resize
+// where <time> is in micro seconds since the start of the recording.
+// A replay is deterministic: the times are ignored, and a read
+// with a timeout only times out where the recording did.
+//-------------------------------------------------------------
+
+#define TTY_RECORD_HEADER  "# isocline key recording v1"
+
+// Record all input events to `fname` (truncated). Note that this includes any passwords typed.
+ic_private bool tty_record_start(tty_t* tty, const char* fname) {
+  if (tty == NULL || fname == NULL || tty->record != NULL) return false;
+  tty->record = fopen(fname, "w");
+  if (tty->record == NULL) {
+    debug_msg("tty: unable to open the recording file: %s\n", fname);
+    return false;
+  }
+  tty->record_start = ic_time_us();
+  fprintf(tty->record, "%s\n", TTY_RECORD_HEADER);
+  return true;
+}
+
+static long long tty_record_time(const tty_t* tty) {
+  const int64_t t = (tty->key_time > tty->record_start ? tty->key_time : ic_time_us());
+  return (long long)(t - tty->record_start);
+}
+
+static void tty_record(tty_t* tty, char kind, code_t code) {
+  if (tty->record == NULL) return;
+  if (kind == 'k') {
+    fprintf(tty->record, "%lld key %x\n", tty_record_time(tty), code);
+  }
+  else {
+    fprintf(tty->record, "%lld timeout\n", (long long)(ic_time_us() - tty->record_start));
+  }
+}
+
+ic_private void tty_record_size(tty_t* tty, ssize_t width, ssize_t height) {
+  if (tty == NULL || tty->record == NULL) return;
+  if (width == tty->record_width && height == tty->record_height) return;
+  tty->record_width = width;
+  tty->record_height = height;
+  fprintf(tty->record, "%lld size %zd %zd\n", (long long)(ic_time_us() - tty->record_start), width, height);
+}
+
+// Replay the events recorded in `fname` (only on a headless tty).
+// The virtual terminal is resized to the initial size of the recording.
+ic_private bool tty_replay_load(tty_t* tty, const char* fname) {
+  if (tty == NULL || !tty->headless || fname == NULL) return false;
+  FILE* f = fopen(fname, "r");
+  if (f == NULL) return false;
+  ssize_t capacity = 0;
+  ssize_t count = 0;
+  tty_event_t* events = NULL;
+  bool ok = true;
+  char line[128];
+  while (ok && fgets(line, ssizeof(line), f) != NULL) {
+    if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') continue;
+    tty_event_t ev;
+    memset(&ev, 0, sizeof(ev));
+    long long time = 0;
+    char kind[16];
+    unsigned int code = 0;
+    long width = 0, height = 0;
+    if (sscanf(line, "%lld %15s", &time, kind) != 2) { ok = false; break; }
+    ev.time = time;
+    if (strcmp(kind, "key") == 0 && sscanf(line, "%*d %*s %x", &code) == 1) {
+      ev.kind = 'k';
+      ev.code = code;
+    }
+    else if (strcmp(kind, "timeout") == 0) {
+      ev.kind = 't';
+    }
+    else if (strcmp(kind, "size") == 0 && sscanf(line, "%*d %*s %ld %ld", &width, &height) == 2 && width > 0 && height > 0) {
+      ev.kind = 's';
+      ev.width = width;
+      ev.height = height;
+    }
+    else {
+      ok = false;
+      break;
+    }
+    if (count >= capacity) {
+      capacity = (capacity == 0 ? 256 : 2*capacity);
+      tty_event_t* newevents = mem_realloc_tp(tty->mem, tty_event_t, events, capacity);
+      if (newevents == NULL) { ok = false; break; }
+      events = newevents;
+    }
+    events[count++] = ev;
+  }
+  fclose(f);
+  if (!ok) {
+    debug_msg("tty: invalid recording: %s\n", fname);
+    mem_free(tty->mem, events);
+    return false;
+  }
+  mem_free(tty->mem, tty->replay);
+  tty->replay = events;
+  tty->replay_count = count;
+  tty->replay_pos = 0;
+  // start at the initial size
+  if (count > 0 && events[0].kind == 's' && tty->vterm != NULL) {
+    vterm_resize(tty->vterm, events[0].width, events[0].height);
+    tty->replay_pos = 1;
+  }
+  return true;
+}
+
+ic_private bool tty_replay_done(const tty_t* tty) {
+  return (tty == NULL || tty->replay == NULL || tty->replay_pos >= tty->replay_count);
+}
+
+// apply the size events at the current position
+static void tty_replay_sizes(tty_t* tty) {
+  while (tty->replay_pos < tty->replay_count && tty->replay[tty->replay_pos].kind == 's') {
+    const tty_event_t* ev = &tty->replay[tty->replay_pos++];
+    if (tty->vterm != NULL && (ev->width != vterm_get_width(tty->vterm) || ev->height != vterm_get_height(tty->vterm))) {
+      vterm_resize(tty->vterm, ev->width, ev->height);
+      tty->term_resize_event = true;
+    }
+  }
+}
+
+static bool tty_replay_read(tty_t* tty, long timeout_ms, code_t* code) {
+  ic_unused(timeout_ms);
+  tty_replay_sizes(tty);
+  if (tty->replay_pos >= tty->replay_count) return false;
+  const tty_event_t* ev = &tty->replay[tty->replay_pos++];
+  tty->key_time = ic_time_us();
+  // a size recorded right after a read is the resize that interrupted it
+  tty_replay_sizes(tty);
+  if (ev->kind != 'k') return false;
+  *code = ev->code;
+  return true;
+}
+
+ic_private int64_t tty_key_time(const tty_t* tty) {
+  return (tty == NULL ? 0 : tty->key_time);
+}
+
 ic_private bool tty_is_utf8(const tty_t* tty) {
   if (tty == NULL) return true;
   return (tty->is_utf8);
 }
 
+ic_private bool tty_is_raw(const tty_t* tty) {
+  if (tty == NULL) return false;
+  return (tty->raw_enabled);
+}
+
 ic_private bool tty_term_resize_event(tty_t* tty) {
   if (tty == NULL) return true;
   if (tty->has_term_resize_event) {
@@ -446,6 +755,17 @@ ic_private void tty_set_esc_delay(tty_t* tty, long initial_delay_ms, long follow
 static bool tty_readc_blocking(tty_t* tty, uint8_t* c) {
   if (tty_cpop(tty,c)) return true;
   *c = 0;
+  #if defined(FD_SET)
+  if (tty->has_term_resize_event) {
+    // wait first using select as a `read` is restarted after a signal but we like to return on a resize
+    fd_set readset;
+    FD_ZERO(&readset);
+    FD_SET(tty->fd_in, &readset);
+    if (select(tty->fd_in + 1, &readset, NULL, NULL, NULL) < 0 && errno == EINTR && tty->term_resize_event) {
+      return false;
+    }
+  }
+  #endif
   ssize_t nread = read(tty->fd_in, (char*)c, 1);
   if (nread < 0 && errno == EINTR) {
     // can happen on SIGWINCH signal for terminal resize
@@ -459,6 +779,7 @@ ic_private bool tty_readc_noblock(tty_t* tty, uint8_t* c, long timeout_ms)
 {
   // in our pushback buffer?
   if (tty_cpop(tty, c)) return true;
+  if (tty->headless) return tty_readc_headless(tty, c);
 
   // blocking read?
   if (timeout_ms < 0) {
@@ -531,6 +852,29 @@ ic_private bool tty_readc_noblock(tty_t* tty, uint8_t* c, long timeout_ms)
   return false;
 }
 
+// Wait at most `timeout_ms` for a next resize event without reading input. 
+// Returns `false` on a timeout or when input is available.
+ic_private bool tty_term_resize_wait(tty_t* tty, long timeout_ms) {
+  if (tty == NULL || !tty->has_term_resize_event) return false;
+  if (tty->push_count > 0 || tty->cpush_count > 0) return false;
+  if (tty->headless) { timeout_ms = 0; }
+  #if defined(FD_SET)
+  if (!tty->term_resize_event && timeout_ms > 0) {
+    // a signal interrupts the select
+    fd_set readset;
+    struct timeval time;
+    FD_ZERO(&readset);
+    FD_SET(tty->fd_in, &readset);
+    time.tv_sec  = timeout_ms / 1000;
+    time.tv_usec = 1000*(timeout_ms % 1000);
+    select(tty->fd_in + 1, &readset, NULL, NULL, &time);
+  }
+  #endif
+  if (!tty->term_resize_event) return false;
+  tty->term_resize_event = false;
+  return true;
+}
+
 #if defined(TIOCSTI) 
 ic_private bool tty_async_stop(const tty_t* tty) {
   // insert ^C in the input stream
@@ -543,6 +887,34 @@ ic_private bool tty_async_stop(const tty_t* tty) {
 }
 #endif
 
+ic_private void tty_set_wakeup(tty_t* tty, int fd) {
+  if (tty == NULL || tty->headless) return;
+  tty->wakeup_fd = fd;
+}
+
+// Wait for input or until the wakeup handle becomes readable (see `tty_set_wakeup`).
+static int tty_wait_wakeup(tty_t* tty, long timeout_ms) {
+  #if defined(FD_SET)
+  while (true) {
+    fd_set readset;
+    struct timeval time;
+    FD_ZERO(&readset);
+    FD_SET(tty->fd_in, &readset);
+    FD_SET(tty->wakeup_fd, &readset);
+    time.tv_sec  = (timeout_ms > 0 ? timeout_ms / 1000 : 0);
+    time.tv_usec = (timeout_ms > 0 ? 1000*(timeout_ms % 1000) : 0);
+    const int nfds = (tty->fd_in > tty->wakeup_fd ? tty->fd_in : tty->wakeup_fd) + 1;
+    const int n = select(nfds, &readset, NULL, NULL, (timeout_ms < 0 ? NULL : &time));
+    if (n > 0) return (FD_ISSET(tty->fd_in, &readset) ? 1 : -1);  // input goes first
+    if (n == 0 || errno != EINTR || tty->term_resize_event) return 0;
+    // interrupted by another signal: keep waiting
+  }
+  #else
+  ic_unused(tty); ic_unused(timeout_ms);
+  return 1;
+  #endif
+}
+
 // We install various signal handlers to restore the terminal settings
 // in case of a terminating signal. This is also used to catch terminal window resizes.
 // This is not strictly needed so this can be disabled on 
@@ -651,6 +1023,13 @@ static void signals_restore(void) {
 ic_private bool tty_start_raw(tty_t* tty) {
   if (tty == NULL) return false;
   if (tty->raw_enabled) return true;
+  if (tty->headless) { tty->raw_enabled = true; return true; }
+  if (!tty->signals_installed) {
+    // store in global so our signal handlers can restore the terminal mode
+    // (done lazily so programs that only print do not change the signal handlers)
+    tty->signals_installed = true;
+    signals_install(tty);
+  }
   if (tcsetattr(tty->fd_in,TCSAFLUSH,&tty->raw_ios) < 0) return false;  
   tty->raw_enabled = true;
   return true;
@@ -658,8 +1037,10 @@ ic_private bool tty_start_raw(tty_t* tty) {
 
 ic_private void tty_end_raw(tty_t* tty) {
   if (tty == NULL) return;
+  if (tty->record != NULL) { fflush(tty->record); }
   if (!tty->raw_enabled) return;
   tty->cpush_count = 0;
+  if (tty->headless) { tty->raw_enabled = false; return; }
   if (tcsetattr(tty->fd_in,TCSAFLUSH,&tty->orig_ios) < 0) return;
   tty->raw_enabled = false;
 }
@@ -678,16 +1059,14 @@ static bool tty_init_raw(tty_t* tty)
   // 1 byte at a time, no delay
   tty->raw_ios.c_cc[VTIME] = 0;
   tty->raw_ios.c_cc[VMIN] = 1;
-
-  // store in global so our signal handlers can restore the terminal mode
-  signals_install(tty);
-  
   return true;
 }
 
 static void tty_done_raw(tty_t* tty) {
-  ic_unused(tty);
-  signals_restore();
+  if (tty->signals_installed) {
+    tty->signals_installed = false;
+    signals_restore();
+  }
 }
 
 
@@ -704,11 +1083,33 @@ static void tty_waitc_console(tty_t* tty, long timeout_ms);
 ic_private bool tty_readc_noblock(tty_t* tty, uint8_t* c, long timeout_ms) {  // don't modify `c` if there is no input
   // in our pushback buffer?
   if (tty_cpop(tty, c)) return true;
+  if (tty->headless) return tty_readc_headless(tty, c);
   // any events in the input queue?
   tty_waitc_console(tty, timeout_ms);
   return tty_cpop(tty, c);
 }
 
+// Wait at most `timeout_ms` for a next resize event; other input events are left in the queue.
+// Returns `false` on a timeout or when other input is available.
+ic_private bool tty_term_resize_wait(tty_t* tty, long timeout_ms) {
+  if (tty == NULL) return false;
+  if (tty->push_count > 0 || tty->cpush_count > 0) return false;
+  if (tty->headless) { timeout_ms = 0; }
+  if (!tty->term_resize_event && timeout_ms > 0) {
+    if (WaitForSingleObject(tty->hcon, (DWORD)timeout_ms) != WAIT_OBJECT_0) return false;
+    // only consume resize events
+    INPUT_RECORD inp;
+    DWORD count;
+    while (PeekConsoleInputW(tty->hcon, &inp, 1, &count) && count == 1 && inp.EventType == WINDOW_BUFFER_SIZE_EVENT) {
+      if (!ReadConsoleInputW(tty->hcon, &inp, 1, &count)) break;
+      tty->term_resize_event = true;
+    }
+  }
+  if (!tty->term_resize_event) return false;
+  tty->term_resize_event = false;
+  return true;
+}
+
 // Read from the console input events and push escape codes into the tty cbuffer.
 static void tty_waitc_console(tty_t* tty, long timeout_ms) 
 {
@@ -757,6 +1158,7 @@ static void tty_waitc_console(tty_t* tty, long timeout_ms)
     // resize event?
     if (inp.EventType == WINDOW_BUFFER_SIZE_EVENT) {
       tty->term_resize_event = true;
+      if (timeout_ms < 0) return;  // return from a blocking read so the editor can reflow
       continue;
     }
 
@@ -843,6 +1245,16 @@ static void tty_waitc_console(tty_t* tty, long timeout_ms)
   }
 }  
 
+// background tasks are not supported on Windows (see `pool.c`)
+ic_private void tty_set_wakeup(tty_t* tty, int fd) {
+  ic_unused(tty); ic_unused(fd);
+}
+
+static int tty_wait_wakeup(tty_t* tty, long timeout_ms) {
+  ic_unused(tty); ic_unused(timeout_ms);
+  return 1;
+}
+
 ic_private bool tty_async_stop(const tty_t* tty) {
   // send ^c
   INPUT_RECORD events[2];
@@ -859,6 +1271,7 @@ ic_private bool tty_async_stop(const tty_t* tty) {
 
 ic_private bool tty_start_raw(tty_t* tty) {
   if (tty->raw_enabled) return true;
+  if (tty->headless) { tty->raw_enabled = true; return true; }
   GetConsoleMode(tty->hcon,&tty->hcon_orig_mode);
   DWORD mode = ENABLE_QUICK_EDIT_MODE   // cut&paste allowed 
              | ENABLE_WINDOW_INPUT      // to catch resize events 
@@ -871,7 +1284,9 @@ ic_private bool tty_start_raw(tty_t* tty) {
 }
 
 ic_private void tty_end_raw(tty_t* tty) {
+  if (tty->record != NULL) { fflush(tty->record); }
   if (!tty->raw_enabled) return;
+  if (tty->headless) { tty->raw_enabled = false; return; }
   SetConsoleMode(tty->hcon, tty->hcon_orig_mode );
   tty->raw_enabled = false;
 }
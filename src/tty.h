@@ -9,6 +9,7 @@
 #define IC_TTY_H
 
 #include "common.h"
+#include "vterm.h"
 
 //-------------------------------------------------------------
 // TTY/Keyboard input 
@@ -25,10 +26,22 @@ typedef struct tty_s tty_t;
 ic_private tty_t* tty_new(alloc_t* mem, int fd_in);
 ic_private void   tty_free(tty_t* tty);
 
+// headless: read scripted input (used with a virtual terminal, see `term_new_headless`)
+ic_private tty_t* tty_new_headless(alloc_t* mem, vterm_t* vt);
+ic_private bool   tty_headless_push(tty_t* tty, const char* keys, ssize_t len);
+
+// record the input events to a file, and replay them deterministically (headless only)
+ic_private bool   tty_record_start(tty_t* tty, const char* fname);
+ic_private void   tty_record_size(tty_t* tty, ssize_t width, ssize_t height);
+ic_private bool   tty_replay_load(tty_t* tty, const char* fname);
+ic_private bool   tty_replay_done(const tty_t* tty);
+
 ic_private bool   tty_is_utf8(const tty_t* tty);
+ic_private bool   tty_is_raw(const tty_t* tty);
 ic_private bool   tty_start_raw(tty_t* tty);
 ic_private void   tty_end_raw(tty_t* tty);
 ic_private code_t tty_read(tty_t* tty);
+ic_private int64_t tty_key_time(const tty_t* tty);  // time the last read key started to arrive
 ic_private bool   tty_read_timeout(tty_t* tty, long timeout_ms, code_t* c );
 
 ic_private void   tty_code_pushback( tty_t* tty, code_t c );
@@ -37,7 +50,9 @@ ic_private bool   code_is_unicode(code_t c, unicode_t* uchr);
 ic_private bool   code_is_virt_key(code_t c );
 
 ic_private bool   tty_term_resize_event(tty_t* tty); // did the terminal resize?
+ic_private bool   tty_term_resize_wait(tty_t* tty, long timeout_ms); // wait for a next resize event (but return early on input)
 ic_private bool   tty_async_stop(const tty_t* tty);  // unblock the read asynchronously
+ic_private void   tty_set_wakeup(tty_t* tty, int fd);  // a read returns `KEY_EVENT_TASK` when `fd` becomes readable (-1 to disable)
 ic_private void   tty_set_esc_delay(tty_t* tty, long initial_delay_ms, long followup_delay_ms);
 
 // shared between tty.c and tty_esc.c: low level character push
@@ -48,6 +63,9 @@ ic_private code_t tty_read_esc(tty_t* tty, long esc_initial_timeout, long esc_ti
 
 // used by term.c to read back ANSI escape responses
 ic_private bool   tty_read_esc_response(tty_t* tty, char esc_start, bool final_st, char* buf, ssize_t buflen ); 
+ic_private bool   tty_read_esc_response_any(tty_t* tty, long timeout_ms, char* esc_start, char* buf, ssize_t buflen ); 
+ic_private void   tty_typeahead_restore(tty_t* tty);  // push back input that was read while waiting for responses
+ic_private long   tty_esc_response_timeout(const tty_t* tty);   // default time to wait for a response
 
 
 //-------------------------------------------------------------
@@ -142,6 +160,7 @@ static inline code_t key_unicode( unicode_t u ) {
 #define KEY_EVENT_RESIZE  (KEY_EVENT_BASE+1)
 #define KEY_EVENT_AUTOTAB (KEY_EVENT_BASE+2)
 #define KEY_EVENT_STOP    (KEY_EVENT_BASE+3)
+#define KEY_EVENT_TASK    (KEY_EVENT_BASE+4)  // background tasks are done (see `tty_set_wakeup`)
 
 // Convenience
 #define KEY_CTRL_UP       (WITH_CTRL(KEY_UP))
@@ -0,0 +1,391 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+-----------------------------------------------------------------------------*/
+#include <string.h>
+
+#include "common.h"
+#include "attr.h"
+#include "stringbuf.h"
+#include "vterm.h"
+
+#define VTERM_ESC_MAX  (256)   // longer escape sequences are discarded
+
+typedef struct vcell_s {
+  unicode_t  code;      // 0 for the second column of a wide character
+  attr_t     attr;
+} vcell_t;
+
+struct vterm_s {
+  alloc_t*   mem;
+  ssize_t    width;
+  ssize_t    height;
+  vcell_t*   cells;          // `height` rows of `width` cells
+  ssize_t    row;            // cursor (0-based)
+  ssize_t    col;
+  bool       wrap_pending;   // written the last column; wrap on the next character (like xterm)
+  bool       cursor_visible;
+  attr_t     attr;           // current attributes
+  ssize_t    save_row;
+  ssize_t    save_col;
+  ssize_t    scrolled;       // rows scrolled off the top
+  char       pending[VTERM_ESC_MAX];  // incomplete escape or utf-8 sequence at the end of a write
+  ssize_t    pending_len;
+};
+
+
+//-------------------------------------------------------------
+// Create, reset, resize
+//-------------------------------------------------------------
+
+static vcell_t vcell_blank(void) {
+  vcell_t cell;
+  cell.code = ' ';
+  cell.attr = attr_default();
+  return cell;
+}
+
+static void vterm_clear_cells( vterm_t* vt, ssize_t from, ssize_t to ) {
+  const vcell_t blank = vcell_blank();
+  for (ssize_t i = from; i < to; i++) {
+    vt->cells[i] = blank;
+  }
+}
+
+ic_private vterm_t* vterm_new( alloc_t* mem, ssize_t width, ssize_t height ) {
+  if (width <= 0 || height <= 0) return NULL;
+  vterm_t* vt = mem_zalloc_tp(mem, vterm_t);
+  if (vt == NULL) return NULL;
+  vt->mem = mem;
+  vt->width = width;
+  vt->height = height;
+  vt->cells = mem_malloc_tp_n(mem, vcell_t, width * height);
+  if (vt->cells == NULL) {
+    mem_free(mem, vt);
+    return NULL;
+  }
+  vterm_reset(vt);
+  return vt;
+}
+
+ic_private void vterm_free( vterm_t* vt ) {
+  if (vt == NULL) return;
+  mem_free(vt->mem, vt->cells);
+  mem_free(vt->mem, vt);
+}
+
+ic_private void vterm_reset( vterm_t* vt ) {
+  vterm_clear_cells(vt, 0, vt->width * vt->height);
+  vt->row = vt->col = 0;
+  vt->save_row = vt->save_col = 0;
+  vt->wrap_pending = false;
+  vt->cursor_visible = true;
+  vt->attr = attr_default();
+  vt->scrolled = 0;
+  vt->pending_len = 0;
+}
+
+ic_private void vterm_resize( vterm_t* vt, ssize_t width, ssize_t height ) {
+  if (width <= 0 || height <= 0) return;
+  vcell_t* cells = mem_malloc_tp_n(vt->mem, vcell_t, width * height);
+  if (cells == NULL) return;
+  const vcell_t blank = vcell_blank();
+  for (ssize_t r = 0; r < height; r++) {
+    for (ssize_t c = 0; c < width; c++) {
+      cells[r*width + c] = (r < vt->height && c < vt->width ? vt->cells[r*vt->width + c] : blank);
+    }
+  }
+  mem_free(vt->mem, vt->cells);
+  vt->cells  = cells;
+  vt->width  = width;
+  vt->height = height;
+  if (vt->row >= height) { vt->row = height - 1; }
+  if (vt->col >= width)  { vt->col = width - 1; }
+  vt->wrap_pending = false;
+}
+
+ic_private ssize_t vterm_get_width( const vterm_t* vt ) {
+  return vt->width;
+}
+
+ic_private ssize_t vterm_get_height( const vterm_t* vt ) {
+  return vt->height;
+}
+
+ic_private void vterm_get_cursor( const vterm_t* vt, ssize_t* row, ssize_t* col ) {
+  if (row != NULL) { *row = vt->row; }
+  if (col != NULL) { *col = vt->col; }
+}
+
+ic_private ssize_t vterm_get_scrolled( const vterm_t* vt ) {
+  return vt->scrolled;
+}
+
+
+//-------------------------------------------------------------
+// Cursor movement and editing
+//-------------------------------------------------------------
+
+static ssize_t vterm_clamp( ssize_t x, ssize_t lo, ssize_t hi ) {
+  return (x < lo ? lo : (x > hi ? hi : x));
+}
+
+static void vterm_move_to( vterm_t* vt, ssize_t row, ssize_t col ) {
+  vt->row = vterm_clamp(row, 0, vt->height - 1);
+  vt->col = vterm_clamp(col, 0, vt->width - 1);
+  vt->wrap_pending = false;
+}
+
+static void vterm_scroll_up( vterm_t* vt, ssize_t n ) {
+  if (n <= 0) return;
+  if (n > vt->height) { n = vt->height; }
+  const ssize_t keep = (vt->height - n) * vt->width;
+  memmove(vt->cells, vt->cells + n*vt->width, to_size_t(keep) * sizeof(vcell_t));
+  vterm_clear_cells(vt, keep, vt->height * vt->width);
+  vt->scrolled += n;
+}
+
+static void vterm_linefeed( vterm_t* vt ) {
+  if (vt->row >= vt->height - 1) {
+    vterm_scroll_up(vt, 1);
+  }
+  else {
+    vt->row++;
+  }
+  vt->wrap_pending = false;
+}
+
+static void vterm_put( vterm_t* vt, unicode_t code, ssize_t w ) {
+  if (w <= 0) return;  // combining characters are not tracked
+  if (vt->wrap_pending || (w > 1 && vt->col + w > vt->width)) {
+    vt->col = 0;
+    vterm_linefeed(vt);
+  }
+  vcell_t* cell = &vt->cells[vt->row*vt->width + vt->col];
+  cell->code = code;
+  cell->attr = vt->attr;
+  if (w > 1 && vt->col + 1 < vt->width) {
+    cell[1].code = 0;
+    cell[1].attr = vt->attr;
+  }
+  vt->col += w;
+  if (vt->col >= vt->width) {
+    vt->col = vt->width - 1;
+    vt->wrap_pending = true;
+  }
+}
+
+// erase the cells `from` up to `to` (exclusive) of the screen
+static void vterm_erase( vterm_t* vt, ssize_t from, ssize_t to ) {
+  vterm_clear_cells(vt, vterm_clamp(from, 0, vt->width*vt->height), vterm_clamp(to, 0, vt->width*vt->height));
+}
+
+
+//-------------------------------------------------------------
+// Escape sequences
+//-------------------------------------------------------------
+
+static ssize_t vterm_param( const ssize_t* pars, ssize_t count, ssize_t i, ssize_t def ) {
+  return (i < count && pars[i] > 0 ? pars[i] : def);
+}
+
+// `s` is the CSI sequence starting after `ESC[` and including the final character.
+static void vterm_csi( vterm_t* vt, const char* s, ssize_t len ) {
+  const char final = s[len-1];
+  const bool private_mode = (len > 1 && s[0] == '?');
+  ssize_t pars[16];
+  ssize_t count = 0;
+  pars[0] = 0;
+  for (ssize_t i = (private_mode ? 1 : 0); i < len - 1; i++) {
+    const char c = s[i];
+    if (c >= '0' && c <= '9') {
+      if (count == 0) { count = 1; }
+      pars[count-1] = 10*pars[count-1] + (c - '0');
+    }
+    else if ((c == ';' || c == ':') && count < 16) {
+      if (count == 0) { count = 1; }
+      if (count < 16) { pars[count++] = 0; }
+    }
+  }
+  const ssize_t n = vterm_param(pars, count, 0, 1);
+  const ssize_t at = vt->row*vt->width + vt->col;
+  switch (final) {
+    case 'A': vterm_move_to(vt, vt->row - n, vt->col); break;
+    case 'B': vterm_move_to(vt, vt->row + n, vt->col); break;
+    case 'C': vterm_move_to(vt, vt->row, vt->col + n); break;
+    case 'D': vterm_move_to(vt, vt->row, vt->col - n); break;
+    case 'E': vterm_move_to(vt, vt->row + n, 0); break;
+    case 'F': vterm_move_to(vt, vt->row - n, 0); break;
+    case 'G': vterm_move_to(vt, vt->row, n - 1); break;
+    case 'd': vterm_move_to(vt, n - 1, vt->col); break;
+    case 'H':
+    case 'f': vterm_move_to(vt, n - 1, vterm_param(pars, count, 1, 1) - 1); break;
+    case 'J': {
+      const ssize_t mode = vterm_param(pars, count, 0, 0);
+      if (mode == 0)      { vterm_erase(vt, at, vt->width*vt->height); }
+      else if (mode == 1) { vterm_erase(vt, 0, at + 1); }
+      else                { vterm_erase(vt, 0, vt->width*vt->height); }
+      break;
+    }
+    case 'K': {
+      const ssize_t mode = vterm_param(pars, count, 0, 0);
+      const ssize_t line = vt->row*vt->width;
+      if (mode == 0)      { vterm_erase(vt, at, line + vt->width); }
+      else if (mode == 1) { vterm_erase(vt, line, at + 1); }
+      else                { vterm_erase(vt, line, line + vt->width); }
+      break;
+    }
+    case 'X': vterm_erase(vt, at, at + vterm_clamp(n, 0, vt->width - vt->col)); break;
+    case 'S': vterm_scroll_up(vt, n); break;
+    case 'm': {
+      if (private_mode) break;
+      vt->attr = (len <= 1 ? attr_default() : attr_update_with(vt->attr, attr_from_sgr(s, len - 1)));
+      break;
+    }
+    case 's': vt->save_row = vt->row; vt->save_col = vt->col; break;
+    case 'u': vterm_move_to(vt, vt->save_row, vt->save_col); break;
+    case 'h':
+    case 'l': {
+      if (private_mode && vterm_param(pars, count, 0, 0) == 25) { vt->cursor_visible = (final == 'h'); }
+      break;  // other modes (like synchronized output) do not affect the screen
+    }
+    default: break;  // queries (like `n`) are ignored
+  }
+}
+
+// Try to process an escape sequence at `s`; returns the length processed or
+// 0 if the sequence is incomplete.
+static ssize_t vterm_esc( vterm_t* vt, const char* s, ssize_t len ) {
+  if (len < 2) return 0;
+  const char kind = s[1];
+  if (kind == '[') {
+    // CSI: parameters and intermediates up to a final character in 0x40-0x7E
+    for (ssize_t i = 2; i < len; i++) {
+      if (s[i] >= 0x40 && s[i] <= 0x7E) {
+        vterm_csi(vt, s + 2, i - 1);
+        return i + 1;
+      }
+    }
+    return 0;
+  }
+  else if (kind == ']' || kind == 'P' || kind == '_') {
+    // OSC, DCS, APC: skip up to BEL or ST
+    for (ssize_t i = 2; i < len; i++) {
+      if (s[i] == '\x07') return i + 1;
+      if (s[i] == '\x1B' && i + 1 < len && s[i+1] == '\\') return i + 2;
+    }
+    return 0;
+  }
+  else if (kind == '7') { vt->save_row = vt->row; vt->save_col = vt->col; }
+  else if (kind == '8') { vterm_move_to(vt, vt->save_row, vt->save_col); }
+  else if (kind == 'c') { vterm_reset(vt); }
+  return 2;
+}
+
+// Process as much of `s` as possible; returns the length of an incomplete sequence at the end.
+static ssize_t vterm_process( vterm_t* vt, const char* s, ssize_t len ) {
+  ssize_t i = 0;
+  while (i < len) {
+    const uint8_t c = (uint8_t)s[i];
+    if (c == '\x1B') {
+      const ssize_t n = vterm_esc(vt, s + i, len - i);
+      if (n <= 0) return (len - i);
+      i += n;
+    }
+    else if (c < ' ' || c == 0x7F) {
+      switch (c) {
+        case '\r': vt->col = 0; vt->wrap_pending = false; break;
+        case '\n': vt->col = 0; vterm_linefeed(vt); break;   // like a terminal with `ONLCR`
+        case '\b': if (vt->col > 0) { vt->col--; } vt->wrap_pending = false; break;
+        case '\t': vterm_move_to(vt, vt->row, ((vt->col / 8) + 1) * 8); break;
+        default: break;
+      }
+      i++;
+    }
+    else {
+      // a (complete) utf-8 sequence
+      const ssize_t n = (c >= 0xF0 ? 4 : (c >= 0xE0 ? 3 : (c >= 0xC0 ? 2 : 1)));
+      if (i + n > len) return (len - i);
+      ssize_t w = 1;
+      ssize_t nread = 0;
+      const ssize_t next = str_next_ofs(s + i, n, 0, &w);
+      const unicode_t code = unicode_from_qutf8((const uint8_t*)(s + i), (next > 0 ? next : 1), &nread);
+      vterm_put(vt, code, w);
+      i += (nread > 0 ? nread : 1);
+    }
+  }
+  return 0;
+}
+
+ic_private void vterm_write( vterm_t* vt, const char* s, ssize_t len ) {
+  if (vt == NULL || s == NULL || len <= 0) return;
+  if (vt->pending_len > 0) {
+    // complete the pending sequence byte by byte first
+    ssize_t i = 0;
+    while (i < len && vt->pending_len > 0) {
+      vt->pending[vt->pending_len++] = s[i++];
+      if (vterm_process(vt, vt->pending, vt->pending_len) < vt->pending_len  // completed
+          || vt->pending_len >= VTERM_ESC_MAX)                               // too long: discard
+      {
+        vt->pending_len = 0;
+      }
+    }
+    s += i;
+    len -= i;
+    if (len <= 0) return;
+  }
+  const ssize_t rest = vterm_process(vt, s, len);
+  if (rest > 0 && rest < VTERM_ESC_MAX) {
+    memcpy(vt->pending, s + len - rest, to_size_t(rest));
+    vt->pending_len = rest;
+  }
+}
+
+
+//-------------------------------------------------------------
+// Inspect the screen
+//-------------------------------------------------------------
+
+ic_private void vterm_row_text( const vterm_t* vt, ssize_t row, stringbuf_t* out ) {
+  if (row < 0 || row >= vt->height) return;
+  const vcell_t* cells = vt->cells + row*vt->width;
+  ssize_t end = vt->width;
+  while (end > 0 && cells[end-1].code == ' ') { end--; }
+  for (ssize_t c = 0; c < end; c++) {
+    if (cells[c].code == 0) continue;  // second half of a wide character
+    uint8_t buf[5];
+    unicode_to_qutf8(cells[c].code, buf);
+    sbuf_append(out, (const char*)buf);
+  }
+}
+
+ic_private void vterm_screen_text( const vterm_t* vt, stringbuf_t* out ) {
+  ssize_t rows = vt->height;
+  const vcell_t blank = vcell_blank();
+  while (rows > 0) {
+    const vcell_t* cells = vt->cells + (rows-1)*vt->width;
+    ssize_t c = 0;
+    while (c < vt->width && cells[c].code == blank.code) { c++; }
+    if (c < vt->width) break;
+    rows--;
+  }
+  for (ssize_t r = 0; r < rows; r++) {
+    if (r > 0) { sbuf_append(out, "\n"); }
+    vterm_row_text(vt, r, out);
+  }
+}
+
+ic_private bool vterm_screen_equal( const vterm_t* vt1, const vterm_t* vt2 ) {
+  if (vt1->width != vt2->width || vt1->height != vt2->height) return false;
+  if (vt1->row != vt2->row || vt1->col != vt2->col) return false;
+  for (ssize_t i = 0; i < vt1->width * vt1->height; i++) {
+    const vcell_t* c1 = &vt1->cells[i];
+    const vcell_t* c2 = &vt2->cells[i];
+    if (c1->code != c2->code) return false;
+    // attributes only matter for visible cells
+    if (c1->code != ' ' && !attr_is_eq(c1->attr, c2->attr)) return false;
+  }
+  return true;
+}
@@ -0,0 +1,44 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+-----------------------------------------------------------------------------*/
+#pragma once
+#ifndef IC_VTERM_H
+#define IC_VTERM_H
+
+#include "common.h"
+#include "stringbuf.h"
+
+//-------------------------------------------------------------
+// Virtual terminal
+// A headless screen grid that interprets the subset of the
+// CSI/SGR escape sequences that isocline emits. A `term_t` can
+// write into it instead of its output handle (see `term_new_headless`)
+// so rendering can be measured and verified without a terminal.
+//-------------------------------------------------------------
+
+struct vterm_s;
+typedef struct vterm_s vterm_t;
+
+ic_private vterm_t* vterm_new( alloc_t* mem, ssize_t width, ssize_t height );
+ic_private void     vterm_free( vterm_t* vt );
+ic_private void     vterm_reset( vterm_t* vt );   // clear the screen and reset the state
+ic_private void     vterm_write( vterm_t* vt, const char* s, ssize_t len );
+ic_private void     vterm_resize( vterm_t* vt, ssize_t width, ssize_t height );  // keeps the top-left content
+
+ic_private ssize_t  vterm_get_width( const vterm_t* vt );
+ic_private ssize_t  vterm_get_height( const vterm_t* vt );
+ic_private void     vterm_get_cursor( const vterm_t* vt, ssize_t* row, ssize_t* col );
+ic_private ssize_t  vterm_get_scrolled( const vterm_t* vt );  // rows scrolled off the top
+
+// Append the text of a row (without trailing blanks) or of the whole screen
+// (rows separated by newlines, without trailing empty rows).
+ic_private void     vterm_row_text( const vterm_t* vt, ssize_t row, stringbuf_t* out );
+ic_private void     vterm_screen_text( const vterm_t* vt, stringbuf_t* out );
+
+// Do two screens show the same text with the same attributes and cursor position?
+ic_private bool     vterm_screen_equal( const vterm_t* vt1, const vterm_t* vt2 );
+
+#endif // IC_VTERM_H
@@ -0,0 +1,465 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Micro benchmarks of the internal kernels.
+
+  usage: bench [--quick] [filter]
+
+  Includes the library sources directly so the internal functions can
+  be called. Each benchmark is calibrated to run for a minimal time and
+  then repeated; the median and minimum are written as JSON to stdout
+  so results can be compared across commits. All inputs are generated
+  deterministically.
+-----------------------------------------------------------------------------*/
+#include "../src/isocline.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+
+#if defined(_WIN32)
+#include <io.h>
+#define BENCH_NULL_DEVICE  "NUL"
+#else
+#include <unistd.h>
+#define BENCH_NULL_DEVICE  "/dev/null"
+#endif
+
+#define BENCH_REPEAT  (5)
+
+
+//-------------------------------------------------------------
+// Harness
+//-------------------------------------------------------------
+
+typedef void (bench_fun_t)( void* arg, long iters );
+
+static const char* bench_filter;
+static int64_t     bench_min_us = 20000;   // minimal time of a calibrated run
+static bool        bench_first = true;
+static volatile ssize_t bench_sink;        // keep results alive
+
+static int cmp_double(const void* p1, const void* p2) {
+  double d1 = *((const double*)p1);
+  double d2 = *((const double*)p2);
+  return (d1 < d2 ? -1 : (d1 > d2 ? 1 : 0));
+}
+
+static bool bench_enabled( const char* name ) {
+  return (bench_filter == NULL || strstr(name, bench_filter) != NULL);
+}
+
+// run `fun` on `items` elements; reports the time per call and per item.
+static void bench_run( const char* name, long items, bench_fun_t* fun, void* arg ) {
+  // calibrate the iterations
+  long iters = 1;
+  int64_t elapsed;
+  while (true) {
+    const int64_t start = ic_time_us();
+    fun(arg, iters);
+    elapsed = ic_time_us() - start;
+    if (elapsed >= bench_min_us || iters >= (1L << 30)) break;
+    iters = (elapsed <= 0 ? iters * 16 : (long)((double)iters * 1.2 * (double)bench_min_us / (double)elapsed) + 1);
+  }
+  // and measure
+  double ns[BENCH_REPEAT];
+  for (int i = 0; i < BENCH_REPEAT; i++) {
+    const int64_t start = ic_time_us();
+    fun(arg, iters);
+    ns[i] = ((double)(ic_time_us() - start) * 1000.0) / (double)iters;
+  }
+  qsort(ns, BENCH_REPEAT, sizeof(double), &cmp_double);
+  const double median = ns[BENCH_REPEAT/2];
+  printf("%s\n    { \"name\": \"%s\", \"items\": %ld, \"iterations\": %ld, \"ns_per_op\": %.1f, \"min_ns_per_op\": %.1f, \"ns_per_item\": %.3f }",
+          (bench_first ? "" : ","), name, items, iters, median, ns[0], median / (double)(items > 0 ? items : 1));
+  bench_first = false;
+  fflush(stdout);
+}
+
+// a deterministic pseudo random generator
+static uint32_t bench_seed = 42;
+static uint32_t bench_rand(void) {
+  bench_seed = bench_seed * 1664525U + 1013904223U;
+  return (bench_seed >> 8);
+}
+
+
+//-------------------------------------------------------------
+// Inputs
+//-------------------------------------------------------------
+
+static alloc_t*  mem;
+static term_t*   term;
+static bbcode_t* bbcode;
+
+static const char* words[] = { "ls", "cd", "git", "status", "commit", "make", "--verbose", "src/", "~/", "echo",
+                               "\"hello world\"", "|", "grep", "-rn", "main", "1234", "&&", "(x + y)", "[a, b]", "{ }" };
+#define WORDS_COUNT (sizeof(words)/sizeof(words[0]))
+
+// a command like line of about `len` bytes
+static char* make_line( ssize_t len, bool unicode ) {
+  stringbuf_t* sb = sbuf_new(mem);
+  while (sbuf_len(sb) < len) {
+    const uint32_t r = bench_rand();
+    if (unicode && (r % 8) == 0) {
+      sbuf_append(sb, ((r/8) % 2 == 0 ? "\xE6\x97\xA5\xE6\x9C\xAC" /* wide */ : "\xC3\xA9t\xC3\xA9" /* latin */));
+    }
+    else if ((r % 64) == 1) {
+      sbuf_append(sb, "\n");
+    }
+    else {
+      sbuf_append(sb, words[(r/64) % WORDS_COUNT]);
+    }
+    sbuf_append(sb, " ");
+  }
+  char* s = sbuf_strdup(sb);
+  sbuf_free(sb);
+  return s;
+}
+
+
+//-------------------------------------------------------------
+// Row layout
+//-------------------------------------------------------------
+
+typedef struct layout_arg_s {
+  const char* s;
+  ssize_t     len;
+} layout_arg_t;
+
+static void bench_layout( void* varg, long iters ) {
+  layout_arg_t* arg = (layout_arg_t*)varg;
+  for (long i = 0; i < iters; i++) {
+    bench_sink = str_for_each_row(arg->s, arg->len, 80, 10, 2, NULL, NULL, NULL);
+  }
+}
+
+
+//-------------------------------------------------------------
+// Character width
+//-------------------------------------------------------------
+
+#define WCWIDTH_COUNT (4096)
+static int32_t wcwidth_chars[WCWIDTH_COUNT];
+
+static void bench_wcwidth( void* arg, long iters ) {
+  ic_unused(arg);
+  for (long i = 0; i < iters; i++) {
+    ssize_t w = 0;
+    for (ssize_t j = 0; j < WCWIDTH_COUNT; j++) {
+      w += mk_wcwidth(wcwidth_chars[j]);
+    }
+    bench_sink = w;
+  }
+}
+
+static void init_wcwidth(void) {
+  static const int32_t ranges[][2] = {
+    {0x20,0x7E}, {0xA0,0x24F}, {0x300,0x36F}, {0x400,0x4FF}, {0x3040,0x30FF}, {0x4E00,0x9FFF}, {0xAC00,0xD7A3}, {0x1F300,0x1F6FF}
+  };
+  const size_t nranges = sizeof(ranges)/sizeof(ranges[0]);
+  for (ssize_t i = 0; i < WCWIDTH_COUNT; i++) {
+    const uint32_t r = bench_rand();
+    // half ascii, the rest spread over the other ranges
+    const size_t k = ((r & 1) == 0 ? 0 : (r/2) % nranges);
+    wcwidth_chars[i] = ranges[k][0] + (int32_t)((r/16) % (uint32_t)(ranges[k][1] - ranges[k][0] + 1));
+  }
+}
+
+
+//-------------------------------------------------------------
+// Bbcode and formatted output
+//-------------------------------------------------------------
+
+typedef struct bbcode_arg_s {
+  const char*  s;
+  stringbuf_t* out;
+  attrbuf_t*   attrs;
+} bbcode_arg_t;
+
+static void bench_bbcode( void* varg, long iters ) {
+  bbcode_arg_t* arg = (bbcode_arg_t*)varg;
+  for (long i = 0; i < iters; i++) {
+    sbuf_clear(arg->out);
+    attrbuf_clear(arg->attrs);
+    bbcode_append(bbcode, arg->s, arg->out, arg->attrs);
+  }
+  bench_sink = sbuf_len(arg->out);
+}
+
+static char* make_bbcode( ssize_t len ) {
+  static const char* tags[] = { "b", "i", "u", "red", "ansi-blue", "#8080FF", "ic-hint", "keyword" };
+  stringbuf_t* sb = sbuf_new(mem);
+  while (sbuf_len(sb) < len) {
+    const uint32_t r = bench_rand();
+    const char* tag = tags[r % (sizeof(tags)/sizeof(tags[0]))];
+    sbuf_appendf(sb, "[%s]%s[/%s] %s ", tag, words[(r/8) % WORDS_COUNT], tag, words[(r/128) % WORDS_COUNT]);
+  }
+  char* s = sbuf_strdup(sb);
+  sbuf_free(sb);
+  return s;
+}
+
+static void bench_write_formatted( void* varg, long iters ) {
+  bbcode_arg_t* arg = (bbcode_arg_t*)varg;
+  const char* s = sbuf_string(arg->out);
+  const attr_t* attrs = attrbuf_attrs(arg->attrs, sbuf_len(arg->out));
+  for (long i = 0; i < iters; i++) {
+    term_write_formatted_n(term, s, attrs, sbuf_len(arg->out));
+    term_flush(term);
+  }
+}
+
+
+//-------------------------------------------------------------
+// History
+//-------------------------------------------------------------
+
+typedef struct history_arg_s {
+  history_t* h;
+  long       next;
+} history_arg_t;
+
+// a history with `n` (unique) entries; bypasses the `IC_MAX_HISTORY` limit
+static history_t* make_history( ssize_t n ) {
+  history_t* h = history_new(mem);
+  if (h == NULL) return NULL;
+  h->elems = (const char**)mem_zalloc_tp_n(mem, char*, n);
+  if (h->elems == NULL) { history_free(h); return NULL; }
+  h->len = n;
+  char buf[64];
+  for (ssize_t i = 0; i < n; i++) {
+    snprintf(buf, sizeof(buf), "%s %s %zd", words[i % (ssize_t)WORDS_COUNT], words[(i/7) % (ssize_t)WORDS_COUNT], i);
+    h->elems[i] = mem_strdup(mem, buf);
+    h->count++;
+  }
+  return h;
+}
+
+// push a new entry into a full history (so the oldest is removed)
+static void bench_history_push( void* varg, long iters ) {
+  history_arg_t* arg = (history_arg_t*)varg;
+  char buf[64];
+  for (long i = 0; i < iters; i++) {
+    snprintf(buf, sizeof(buf), "new entry %ld", arg->next++);
+    history_push(arg->h, buf);
+  }
+}
+
+// search for a string that is not present (a full scan)
+static void bench_history_search( void* varg, long iters ) {
+  history_arg_t* arg = (history_arg_t*)varg;
+  for (long i = 0; i < iters; i++) {
+    ssize_t hidx;
+    bench_sink = history_search(arg->h, 0, "not-present", true, &hidx, NULL);
+  }
+}
+
+
+//-------------------------------------------------------------
+// Completions
+//-------------------------------------------------------------
+
+typedef struct completions_arg_s {
+  completions_t* cms;
+  ssize_t        count;
+} completions_arg_t;
+
+// add `count` (unique) completions and clear them again
+static void bench_completions_add( void* varg, long iters ) {
+  completions_arg_t* arg = (completions_arg_t*)varg;
+  char buf[64];
+  for (long i = 0; i < iters; i++) {
+    arg->cms->completer_max = arg->count;
+    for (ssize_t j = 0; j < arg->count; j++) {
+      snprintf(buf, sizeof(buf), "completion-%zd", j);
+      completions_add(arg->cms, buf, NULL, NULL, 3, 0);
+    }
+    bench_sink = completions_count(arg->cms);
+    completions_clear(arg->cms);
+  }
+}
+
+
+//-------------------------------------------------------------
+// Brace matching
+//-------------------------------------------------------------
+
+typedef struct braces_arg_s {
+  const char* s;
+  attrbuf_t*  attrs;
+} braces_arg_t;
+
+static char* make_braces( ssize_t len ) {
+  stringbuf_t* sb = sbuf_new(mem);
+  ssize_t depth = 0;
+  while (sbuf_len(sb) < len) {
+    const uint32_t r = bench_rand() % 8;
+    if (r == 0 && depth < 32) { sbuf_append(sb, "(["); depth++; }
+    else if (r == 1 && depth > 0) { sbuf_append(sb, "])"); depth--; }
+    else { sbuf_append(sb, words[r % WORDS_COUNT]); }
+  }
+  while (depth-- > 0) { sbuf_append(sb, "])"); }
+  char* s = sbuf_strdup(sb);
+  sbuf_free(sb);
+  return s;
+}
+
+static void bench_braces( void* varg, long iters ) {
+  braces_arg_t* arg = (braces_arg_t*)varg;
+  const ssize_t len = ic_strlen(arg->s);
+  for (long i = 0; i < iters; i++) {
+    highlight_match_braces(arg->s, arg->attrs, len/2, "()[]{}", attr_from_color(IC_ANSI_RED), attr_from_color(IC_ANSI_YELLOW));
+  }
+}
+
+
+//-------------------------------------------------------------
+// Color matching
+//-------------------------------------------------------------
+
+#define RGB_COUNT (1024)
+static ic_color_t rgb_colors[RGB_COUNT];
+
+static void bench_rgb_match( void* arg, long iters ) {
+  ic_unused(arg);
+  for (long i = 0; i < iters; i++) {
+    ssize_t sum = 0;
+    for (ssize_t j = 0; j < RGB_COUNT; j++) {
+      sum += rgb_match(ansi256, 16, 256, NULL, rgb_colors[j]);
+    }
+    bench_sink = sum;
+  }
+}
+
+// a few colors that are used over and over (like in a theme)
+static void bench_rgb_match_cached( void* arg, long iters ) {
+  ic_unused(arg);
+  rgb_cache_t cache;
+  memset(&cache, 0, sizeof(cache));
+  for (long i = 0; i < iters; i++) {
+    ssize_t sum = 0;
+    for (ssize_t j = 0; j < RGB_COUNT; j++) {
+      sum += rgb_match(ansi256, 16, 256, &cache, rgb_colors[j % 8]);
+    }
+    bench_sink = sum;
+  }
+}
+
+
+//-------------------------------------------------------------
+// Main
+//-------------------------------------------------------------
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--quick") == 0) { bench_min_us = 2000; }
+    else { bench_filter = argv[i]; }
+  }
+
+  mem = mem_new(&malloc, &realloc, &free);
+  FILE* fnull = fopen(BENCH_NULL_DEVICE, "w");
+  if (mem == NULL || fnull == NULL) return 1;
+  term = term_new(mem, NULL, false, true, fileno(fnull));
+  bbcode = bbcode_new(mem, term);
+  if (term == NULL || bbcode == NULL) return 1;
+  term->nocolor = false;      // the null device is not a terminal
+  term->palette = ANSIRGB;
+
+  printf("{\n  \"library\": \"isocline\",\n  \"benchmarks\": [");
+
+  if (bench_enabled("layout")) {
+    for (ssize_t len = 100; len <= 100000; len *= 10) {
+      layout_arg_t arg;
+      char* s = make_line(len, true);
+      arg.s = s;
+      arg.len = ic_strlen(s);
+      char name[64]; snprintf(name, sizeof(name), "layout/%zd", len);
+      bench_run(name, (long)arg.len, &bench_layout, &arg);
+      mem_free(mem, s);
+    }
+  }
+
+  if (bench_enabled("wcwidth")) {
+    init_wcwidth();
+    bench_run("wcwidth", WCWIDTH_COUNT, &bench_wcwidth, NULL);
+  }
+
+  if (bench_enabled("bbcode") || bench_enabled("write_formatted")) {
+    bbcode_arg_t arg;
+    char* s = make_bbcode(1000);
+    arg.s = s;
+    arg.out = sbuf_new(mem);
+    arg.attrs = attrbuf_new(mem);
+    bench_run("bbcode_append/1000", (long)ic_strlen(s), &bench_bbcode, &arg);
+    if (bench_enabled("write_formatted")) {
+      bench_run("write_formatted/1000", (long)sbuf_len(arg.out), &bench_write_formatted, &arg);
+    }
+    sbuf_free(arg.out);
+    attrbuf_free(arg.attrs);
+    mem_free(mem, s);
+  }
+
+  if (bench_enabled("history")) {
+    for (ssize_t n = 1000; n <= 1000000; n *= (n == 1000 ? 100 : 10)) {
+      history_arg_t arg;
+      arg.h = make_history(n);
+      arg.next = 0;
+      if (arg.h == NULL) continue;
+      char name[64];
+      snprintf(name, sizeof(name), "history_push/%zd", n);
+      bench_run(name, (long)n, &bench_history_push, &arg);
+      snprintf(name, sizeof(name), "history_search/%zd", n);
+      bench_run(name, (long)n, &bench_history_search, &arg);
+      history_free(arg.h);
+    }
+  }
+
+  if (bench_enabled("completions")) {
+    for (ssize_t n = 100; n <= 10000; n *= 10) {
+      completions_arg_t arg;
+      arg.cms = completions_new(mem);
+      arg.count = n;
+      if (arg.cms == NULL) continue;
+      char name[64]; snprintf(name, sizeof(name), "completions_add/%zd", n);
+      bench_run(name, (long)n, &bench_completions_add, &arg);
+      completions_free(arg.cms);
+    }
+  }
+
+  if (bench_enabled("braces")) {
+    for (ssize_t len = 100; len <= 10000; len *= 10) {
+      braces_arg_t arg;
+      char* s = make_braces(len);
+      arg.s = s;
+      arg.attrs = attrbuf_new(mem);
+      stringbuf_t* tmp = sbuf_new(mem);
+      attrbuf_append_n(tmp, arg.attrs, s, ic_strlen(s), attr_none());
+      sbuf_free(tmp);
+      char name[64]; snprintf(name, sizeof(name), "match_braces/%zd", len);
+      bench_run(name, (long)ic_strlen(s), &bench_braces, &arg);
+      attrbuf_free(arg.attrs);
+      mem_free(mem, s);
+    }
+  }
+
+  if (bench_enabled("rgb_match")) {
+    for (ssize_t i = 0; i < RGB_COUNT; i++) {
+      rgb_colors[i] = ic_rgb(bench_rand() & 0xFFFFFF);
+    }
+    bench_run("rgb_match", RGB_COUNT, &bench_rgb_match, NULL);
+    bench_run("rgb_match_cached", RGB_COUNT, &bench_rgb_match_cached, NULL);
+  }
+
+  printf("\n  ]\n}\n");
+
+  bbcode_free(bbcode);
+  term_free(term);
+  mem_delete(mem);
+  fclose(fnull);
+  return 0;
+}
@@ -0,0 +1,379 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  End-to-end latency benchmark through a pseudo terminal.
+
+  usage: bench_pty [--quick]         (run the benchmarks against a child process)
+         bench_pty app               (the child: a plain `ic_readline` loop)
+
+  The child runs in a fresh pseudo terminal so the measurements include
+  the termios raw mode, the system calls, and the terminal I/O on both
+  sides. Synthetic input is typed by the parent, which measures the time
+  until the expected output arrives:
+
+  - typing:       one key every 5ms; latency until the key is echoed.
+  - typing_burst: the next key as soon as the previous one is echoed.
+  - paste:        bursts of 1000 characters plus enter; latency until the
+                  child reports the accepted line and shows the next prompt.
+  - resize:       storms of 20 window resizes 1ms apart, then a key;
+                  latency until the key is echoed (this includes the
+                  resize debounce of the editor).
+
+  The throughput (keys per second) and latency percentiles are written
+  as JSON to stdout.
+-----------------------------------------------------------------------------*/
+#if !defined(_WIN32) && !defined(_XOPEN_SOURCE)
+#define _XOPEN_SOURCE  700   // posix_openpt, clock_gettime
+#endif
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE      // TIOCSWINSZ, usleep
+#endif
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <isocline.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#endif
+
+#define BENCH_WIDTH    (100)
+#define BENCH_HEIGHT   (30)
+#define BENCH_TIMEOUT  (5000)   // maximal wait for output in milliseconds
+
+// The child: accept lines and report each one with a marker.
+static int app(void) {
+  ic_enable_hint(false);   // no output that is delayed
+  ic_set_history(NULL, -1);
+  long count = 0;
+  char* input;
+  while ((input = ic_readline("bench")) != NULL) {
+    const bool stop = (strcmp(input, "exit") == 0);
+    ic_free(input);
+    printf("<<ok %ld>>\n", ++count);
+    fflush(stdout);
+    if (stop) break;
+  }
+  return 0;
+}
+
+
+#if !defined(_WIN32)
+
+//-------------------------------------------------------------
+// Pseudo terminal
+//-------------------------------------------------------------
+
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((double)ts.tv_sec * 1e6) + ((double)ts.tv_nsec / 1e3);
+}
+
+typedef struct pty_s {
+  int    master;
+  pid_t  pid;
+  char   buf[1 << 16];  // received output that is not yet matched
+  size_t len;
+} pty_t;
+
+static void pty_resize(pty_t* pty, int width, int height) {
+  struct winsize ws;
+  memset(&ws, 0, sizeof(ws));
+  ws.ws_col = (unsigned short)width;
+  ws.ws_row = (unsigned short)height;
+  ioctl(pty->master, TIOCSWINSZ, &ws);   // signals SIGWINCH to the child
+}
+
+// start `self app` with the standard handles connected to a fresh pseudo terminal.
+static bool pty_spawn(pty_t* pty, const char* self) {
+  pty->len = 0;
+  pty->master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (pty->master < 0 || grantpt(pty->master) != 0 || unlockpt(pty->master) != 0) return false;
+  const char* slave_name = ptsname(pty->master);
+  if (slave_name == NULL) { close(pty->master); return false; }
+  pty_resize(pty, BENCH_WIDTH, BENCH_HEIGHT);
+  pty->pid = fork();
+  if (pty->pid < 0) { close(pty->master); return false; }
+  if (pty->pid == 0) {
+    setsid();
+    int slave = open(slave_name, O_RDWR);  // becomes the controlling terminal
+    if (slave < 0) _exit(1);
+    dup2(slave, 0); dup2(slave, 1); dup2(slave, 2);
+    close(pty->master);
+    execl(self, self, "app", (char*)NULL);
+    _exit(1);
+  }
+  return true;
+}
+
+// closing the master hangs up the child; kill it if it does not exit by itself.
+static void pty_close(pty_t* pty) {
+  close(pty->master);
+  for (int i = 0; i < 100; i++) {
+    if (waitpid(pty->pid, NULL, WNOHANG) != 0) return;
+    usleep(10000);
+  }
+  kill(pty->pid, SIGKILL);
+  waitpid(pty->pid, NULL, 0);
+}
+
+static bool pty_write(pty_t* pty, const char* s, size_t len) {
+  while (len > 0) {
+    ssize_t n = write(pty->master, s, len);
+    if (n <= 0) return false;
+    s += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+// read available output; wait at most `timeout_ms` for the first bytes.
+static bool pty_read(pty_t* pty, int timeout_ms) {
+  struct pollfd pfd = { pty->master, POLLIN, 0 };
+  if (poll(&pfd, 1, timeout_ms) <= 0 || (pfd.revents & POLLIN) == 0) return false;
+  if (pty->len >= sizeof(pty->buf) - 1) {
+    // keep the tail so a pattern on the boundary still matches
+    memmove(pty->buf, pty->buf + pty->len - 64, 64);
+    pty->len = 64;
+  }
+  ssize_t n = read(pty->master, pty->buf + pty->len, sizeof(pty->buf) - 1 - pty->len);
+  if (n <= 0) return false;
+  pty->len += (size_t)n;
+  pty->buf[pty->len] = 0;
+  return true;
+}
+
+// discard all output that is available right now.
+static void pty_drain(pty_t* pty) {
+  while (pty_read(pty, 0)) { }
+  pty->len = 0;
+}
+
+// wait until `pattern` is in the output; everything up to it is consumed.
+static bool pty_expect(pty_t* pty, const char* pattern) {
+  const double deadline = now_us() + 1000.0 * BENCH_TIMEOUT;
+  while (true) {
+    const char* p = (pty->len > 0 ? strstr(pty->buf, pattern) : NULL);
+    if (p != NULL) {
+      const size_t ofs = (size_t)(p - pty->buf) + strlen(pattern);
+      memmove(pty->buf, pty->buf + ofs, pty->len - ofs + 1);
+      pty->len -= ofs;
+      return true;
+    }
+    const double left_ms = (deadline - now_us()) / 1000.0;
+    if (left_ms <= 0 || !pty_read(pty, (int)left_ms + 1)) return false;
+  }
+}
+
+// wait until a key typed at the end of the input is echoed: the editor redraws
+// the row and clears the rest of it (matching just the key could hit the prompt).
+static bool pty_expect_key(pty_t* pty, char key) {
+  char pattern[8];
+  snprintf(pattern, sizeof(pattern), "%c\x1B[K", key);
+  return pty_expect(pty, pattern);
+}
+
+// submit the current line and wait until the child reports it and shows the next prompt.
+// (input typed before the prompt would be read in cooked mode where a `\r` becomes a `\n`)
+static long pty_lines;
+
+static bool pty_submit(pty_t* pty, const char* s) {
+  char marker[64];
+  snprintf(marker, sizeof(marker), "<<ok %ld>>", ++pty_lines);
+  return (pty_write(pty, s, strlen(s)) && pty_write(pty, "\r", 1) && pty_expect(pty, marker) && pty_expect(pty, "bench> "));
+}
+
+
+//-------------------------------------------------------------
+// Benchmarks
+//-------------------------------------------------------------
+
+typedef struct samples_s {
+  double* us;
+  int     count;
+  int     capacity;
+  long    items;       // keys sent
+  double  elapsed_us;  // total time of the measured phases
+} samples_t;
+
+static void samples_add(samples_t* s, double us) {
+  if (s->count >= s->capacity) {
+    s->capacity = (s->capacity == 0 ? 256 : 2*s->capacity);
+    s->us = (double*)realloc(s->us, sizeof(double) * (size_t)s->capacity);
+    if (s->us == NULL) { s->count = s->capacity = 0; return; }
+  }
+  s->us[s->count++] = us;
+}
+
+static int cmp_double(const void* p1, const void* p2) {
+  double d1 = *((const double*)p1);
+  double d2 = *((const double*)p2);
+  return (d1 < d2 ? -1 : (d1 > d2 ? 1 : 0));
+}
+
+static double percentile(const samples_t* s, double p) {
+  int i = (int)(p * (double)s->count);
+  if (i >= s->count) { i = s->count - 1; }
+  return s->us[i];
+}
+
+static bool bench_first = true;
+
+static void report(const char* name, samples_t* s, int failed) {
+  if (s->count > 0) {
+    qsort(s->us, (size_t)s->count, sizeof(double), &cmp_double);
+  }
+  printf("%s\n    { \"name\": \"%s\", \"samples\": %d, \"failed\": %d, \"keys\": %ld, \"keys_per_sec\": %.0f,"
+         " \"p50_us\": %.1f, \"p90_us\": %.1f, \"p99_us\": %.1f, \"max_us\": %.1f }",
+         (bench_first ? "" : ","), name, s->count, failed, s->items,
+         (s->elapsed_us > 0 ? 1e6 * (double)s->items / s->elapsed_us : 0.0),
+         (s->count > 0 ? percentile(s, 0.50) : 0.0), (s->count > 0 ? percentile(s, 0.90) : 0.0),
+         (s->count > 0 ? percentile(s, 0.99) : 0.0), (s->count > 0 ? s->us[s->count-1] : 0.0));
+  bench_first = false;
+  fflush(stdout);
+  free(s->us);
+}
+
+static void sleep_until(double t_us) {
+  const double left = t_us - now_us();
+  if (left > 0) { usleep((useconds_t)left); }
+}
+
+// type `keys` one at a time (every `interval_us`, or closed loop if 0) and
+// time until each key is echoed. Lines are submitted every 60 keys.
+static int bench_typing(pty_t* pty, samples_t* s, long keys, double interval_us) {
+  int failed = 0;
+  double next = now_us();
+  for (long i = 0; i < keys; i++) {
+    if (i > 0 && i % 60 == 0) {
+      if (!pty_submit(pty, "")) failed++;
+      pty_drain(pty);
+      next = now_us();
+    }
+    const char key = (char)('a' + (i % 26));
+    if (interval_us > 0) { sleep_until(next); next += interval_us; }
+    pty_drain(pty);
+    const double start = now_us();
+    if (!pty_write(pty, &key, 1) || !pty_expect_key(pty, key)) { failed++; continue; }
+    const double elapsed = now_us() - start;
+    samples_add(s, elapsed);
+    s->elapsed_us += elapsed;
+    s->items++;
+  }
+  if (!pty_submit(pty, "")) failed++;
+  return failed;
+}
+
+// paste bursts of `len` characters followed by enter; time until the line is accepted.
+static int bench_paste(pty_t* pty, samples_t* s, int bursts, int len) {
+  char* text = (char*)malloc((size_t)len + 1);
+  if (text == NULL) return bursts;
+  for (int i = 0; i < len; i++) {
+    text[i] = (i % 8 == 7 ? ' ' : (char)('a' + (i % 26)));
+  }
+  text[len] = 0;
+  int failed = 0;
+  for (int b = 0; b < bursts; b++) {
+    pty_drain(pty);
+    const double start = now_us();
+    if (!pty_submit(pty, text)) { failed++; continue; }
+    const double elapsed = now_us() - start;
+    samples_add(s, elapsed);
+    s->elapsed_us += elapsed;
+    s->items += len + 1;
+  }
+  free(text);
+  return failed;
+}
+
+// a storm of resizes with a half typed line, then a key; time until the key is echoed.
+static int bench_resize(pty_t* pty, samples_t* s, int storms) {
+  int failed = 0;
+  const char* line = "the quick brown fox jumps over the lazy dog; the quick brown fox jumps over the lazy dog ";
+  if (!pty_write(pty, line, strlen(line))) return storms;
+  for (int k = 0; k < storms; k++) {
+    pty_drain(pty);
+    const double start = now_us();
+    for (int i = 0; i < 20; i++) {
+      pty_resize(pty, BENCH_WIDTH - 40 + ((i * 7) % 40), BENCH_HEIGHT);
+      usleep(1000);
+    }
+    pty_resize(pty, BENCH_WIDTH - (k % 2 == 0 ? 30 : 10), BENCH_HEIGHT);
+    const char key = (char)('A' + (k % 26));
+    if (!pty_write(pty, &key, 1) || !pty_expect_key(pty, key)) { failed++; continue; }
+    const double elapsed = now_us() - start;
+    samples_add(s, elapsed);
+    s->elapsed_us += elapsed;
+    s->items++;
+  }
+  pty_resize(pty, BENCH_WIDTH, BENCH_HEIGHT);
+  if (!pty_submit(pty, "")) failed++;
+  return failed;
+}
+
+static int run(const char* self, bool quick) {
+  pty_t* pty = (pty_t*)calloc(1, sizeof(pty_t));
+  if (pty == NULL || !pty_spawn(pty, self)) {
+    fprintf(stderr, "bench_pty: unable to start the child in a pseudo terminal\n");
+    return 1;
+  }
+  if (!pty_expect(pty, "bench> ")) {   // wait for the first prompt
+    fprintf(stderr, "bench_pty: no prompt from the child\n");
+    pty_close(pty);
+    return 1;
+  }
+  const int scale = (quick ? 1 : 5);
+  int failed = 0;
+  printf("{\n  \"library\": \"isocline\",\n  \"width\": %d,\n  \"height\": %d,\n  \"benchmarks\": [", BENCH_WIDTH, BENCH_HEIGHT);
+
+  samples_t s;
+  int f;
+  memset(&s, 0, sizeof(s));
+  f = bench_typing(pty, &s, 120 * scale, 5000.0);
+  report("typing", &s, f); failed += f;
+
+  memset(&s, 0, sizeof(s));
+  f = bench_typing(pty, &s, 300 * scale, 0.0);
+  report("typing_burst", &s, f); failed += f;
+
+  memset(&s, 0, sizeof(s));
+  f = bench_paste(pty, &s, 4 * scale, 1000);
+  report("paste", &s, f); failed += f;
+
+  memset(&s, 0, sizeof(s));
+  f = bench_resize(pty, &s, 4 * scale);
+  report("resize", &s, f); failed += f;
+
+  printf("\n  ]\n}\n");
+  pty_write(pty, "exit\r", 5);
+  pty_expect(pty, "<<ok");
+  pty_close(pty);
+  free(pty);
+  return (failed > 0 ? 1 : 0);
+}
+
+#endif
+
+int main(int argc, char** argv) {
+  if (argc >= 2 && strcmp(argv[1], "app") == 0) {
+    return app();
+  }
+  #if defined(_WIN32)
+  printf("usage: bench_pty app  (the benchmark driver needs a pseudo terminal)\n");
+  return 1;
+  #else
+  const bool quick = (argc >= 2 && strcmp(argv[1], "--quick") == 0);
+  return run(argv[0], quick);
+  #endif
+}
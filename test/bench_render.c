@@ -0,0 +1,345 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Rendering benchmarks on a virtual terminal.
+
+  usage: bench_render [--quick] [--show] [filter]
+
+  Drives the line editor with scripted keystrokes on a headless
+  virtual terminal (see `src/vterm.c`) and reports the frames, output
+  bytes, and time per frame as JSON to stdout. Each scenario is also
+  verified: the final screen must equal the screen after the same
+  keys followed by a full repaint (`ctrl-L`). Exits with 1 if any
+  scenario fails verification; `--show` prints the final screens
+  to stderr.
+-----------------------------------------------------------------------------*/
+#include "../src/isocline.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_WIDTH   (60)
+#define BENCH_HEIGHT  (24)
+
+typedef void (setup_fun_t)( ic_env_t* env );
+
+typedef struct scenario_s {
+  const char*   name;
+  setup_fun_t*  setup;      // can be NULL
+  ssize_t       width;      // 0 for the default width
+  char          keys[4096];
+  ssize_t       len;
+} scenario_t;
+
+static const char* bench_filter;
+static bool        bench_show;
+static int         bench_repeat = 25;
+static bool        bench_first = true;
+
+
+//-------------------------------------------------------------
+// Scripts
+//-------------------------------------------------------------
+
+static void keys_add( scenario_t* sc, const char* keys ) {
+  const ssize_t n = ic_strlen(keys);
+  if (sc->len + n > ssizeof(sc->keys)) return;
+  memcpy(sc->keys + sc->len, keys, to_size_t(n));
+  sc->len += n;
+}
+
+static void keys_repeat( scenario_t* sc, const char* keys, ssize_t count ) {
+  for (ssize_t i = 0; i < count; i++) { keys_add(sc, keys); }
+}
+
+#define KEYS_LEFT       "\x1B[D"
+#define KEYS_RIGHT      "\x1B[C"
+#define KEYS_UP         "\x1B[A"
+#define KEYS_DOWN       "\x1B[B"
+#define KEYS_HOME       "\x1B[H"
+#define KEYS_END        "\x1B[F"
+#define KEYS_CTRL_LEFT  "\x1B[1;5D"
+#define KEYS_DEL        "\x1B[3~"
+#define KEYS_PAGEDOWN   "\x1B[6~"
+
+static const char* words[] = { "select", "name", "from", "users", "where", "(id", "=", "42)", "and", "[x,", "y]", "{ok}", "\"quoted\"" };
+#define WORDS_COUNT  (sizeof(words)/sizeof(words[0]))
+
+static void keys_words( scenario_t* sc, ssize_t count ) {
+  for (ssize_t i = 0; i < count; i++) {
+    keys_add(sc, words[i % (ssize_t)WORDS_COUNT]);
+    keys_add(sc, " ");
+  }
+}
+
+
+//-------------------------------------------------------------
+// Setup
+//-------------------------------------------------------------
+
+static void highlighter( ic_highlight_env_t* henv, const char* input, void* arg ) {
+  ic_unused(arg);
+  for (long i = 0; input[i] != 0; i++) {
+    if (input[i] >= '0' && input[i] <= '9') {
+      ic_highlight(henv, i, 1, "ansi-maroon");
+    }
+    else if (strncmp(input + i, "select", 6) == 0 || strncmp(input + i, "where", 5) == 0) {
+      ic_highlight(henv, i, 5, "keyword");
+      i += 4;
+    }
+  }
+}
+
+static void setup_highlight( ic_env_t* env ) {
+  env->highlighter = &highlighter;
+  env->highlighter_arg = NULL;
+}
+
+static void setup_history( ic_env_t* env ) {
+  history_load_from(env->history, NULL, -1);  // in memory only
+  char buf[128];
+  for (int i = 0; i < 50; i++) {
+    snprintf(buf, sizeof(buf), "history entry %d: %s %s", i, words[i % (int)WORDS_COUNT], words[(i*7) % (int)WORDS_COUNT]);
+    history_push(env->history, buf);
+  }
+}
+
+// a history entry that is much taller than the terminal
+#define TALL_ROWS  (20000)
+
+static void setup_tall( ic_env_t* env ) {
+  env->no_highlight = true;   // measure the layout, not the (whole input) highlighting
+  env->no_bracematch = true;
+  history_load_from(env->history, NULL, -1);  // in memory only
+  stringbuf_t* sb = sbuf_new(env->mem);
+  if (sb == NULL) return;
+  for (int i = 0; i < TALL_ROWS; i++) {
+    sbuf_appendf(sb, "%srow %d: %s %s", (i == 0 ? "" : "\n"), i, words[i % (int)WORDS_COUNT], words[(i*7) % (int)WORDS_COUNT]);
+  }
+  history_push(env->history, sbuf_string(sb));
+  sbuf_free(sb);
+}
+
+static void word_completer( ic_completion_env_t* cenv, const char* word ) {
+  static const char* candidates[] = { "commit", "compare", "compile", "complete", "compose", "compute", "concat", "config", "connect", "console", "const", "context" };
+  for (size_t i = 0; i < sizeof(candidates)/sizeof(candidates[0]); i++) {
+    if (ic_istarts_with(candidates[i], word)) {
+      ic_add_completion(cenv, candidates[i]);
+    }
+  }
+}
+
+static void completer( ic_completion_env_t* cenv, const char* prefix ) {
+  ic_complete_word(cenv, prefix, &word_completer, NULL);
+}
+
+static void setup_completion( ic_env_t* env ) {
+  completions_set_completer(env->completions, &completer, NULL);
+  setup_highlight(env);
+}
+
+
+//-------------------------------------------------------------
+// Run a scenario
+//-------------------------------------------------------------
+
+typedef struct run_result_s {
+  ic_stats_t  stats;
+  int64_t     elapsed_us;
+  vterm_t*    vt;
+} run_result_t;
+
+static bool scenario_run( const scenario_t* sc, bool repaint, alloc_t* mem, run_result_t* res ) {
+  res->vt = vterm_new(mem, (sc->width > 0 ? sc->width : BENCH_WIDTH), BENCH_HEIGHT);
+  if (res->vt == NULL) return false;
+  ic_env_t* env = ic_env_create_headless(res->vt);
+  if (env == NULL || env->noedit) {
+    if (env != NULL) { ic_env_free_headless(env); }
+    vterm_free(res->vt);
+    res->vt = NULL;
+    return false;
+  }
+  if (sc->setup != NULL) { sc->setup(env); }
+  tty_headless_push(env->tty, sc->keys, sc->len);
+  if (repaint) { tty_headless_push(env->tty, "\x0C", 1); }  // ctrl-L: clear and repaint everything
+  term_flush(env->term);
+  ic_env_reset_stats(env);
+  const int64_t start = ic_time_us();
+  char* line = ic_editline(env, "prompt");
+  res->elapsed_us = ic_time_us() - start;
+  ic_env_get_stats(env, &res->stats);
+  mem_raw_free(env->mem, line);
+  ic_env_free_headless(env);
+  return true;
+}
+
+static int cmp_double(const void* p1, const void* p2) {
+  double d1 = *((const double*)p1);
+  double d2 = *((const double*)p2);
+  return (d1 < d2 ? -1 : (d1 > d2 ? 1 : 0));
+}
+
+static void show_screen( const char* title, const vterm_t* vt, alloc_t* mem ) {
+  stringbuf_t* sb = sbuf_new(mem);
+  if (sb == NULL) return;
+  vterm_screen_text(vt, sb);
+  ssize_t row, col;
+  vterm_get_cursor(vt, &row, &col);
+  fprintf(stderr, "--- %s (cursor %zd,%zd)\n%s\n", title, row, col, sbuf_string(sb));
+  sbuf_free(sb);
+}
+
+// returns whether the scenario passed verification
+static bool scenario_bench( const scenario_t* sc, alloc_t* mem ) {
+  if (bench_filter != NULL && strstr(sc->name, bench_filter) == NULL) return true;
+
+  // verify
+  run_result_t incremental;
+  run_result_t repainted;
+  memset(&incremental, 0, sizeof(incremental));
+  memset(&repainted, 0, sizeof(repainted));
+  bool ok = scenario_run(sc, false, mem, &incremental) && scenario_run(sc, true, mem, &repainted) &&
+            vterm_screen_equal(incremental.vt, repainted.vt);
+  if (bench_show || !ok) {
+    if (incremental.vt != NULL) { show_screen("incremental", incremental.vt, mem); }
+    if (repainted.vt != NULL)   { show_screen("repainted", repainted.vt, mem); }
+  }
+  vterm_free(repainted.vt);
+
+  // measure
+  double us[64];
+  const int repeat = (bench_repeat > 64 ? 64 : bench_repeat);
+  for (int i = 0; i < repeat; i++) {
+    run_result_t r;
+    memset(&r, 0, sizeof(r));
+    if (!scenario_run(sc, false, mem, &r)) { us[i] = 0; continue; }
+    us[i] = (double)r.elapsed_us / (double)(r.stats.frames > 0 ? r.stats.frames : 1);
+    vterm_free(r.vt);
+  }
+  qsort(us, to_size_t(repeat), sizeof(double), &cmp_double);
+
+  const ic_stats_t* st = &incremental.stats;
+  const uint64_t frames = (st->frames > 0 ? st->frames : 1);
+  printf("%s\n    { \"name\": \"%s\", \"keys\": %llu, \"frames\": %llu, \"bytes\": %llu, \"writes\": %llu, \"bytes_per_frame\": %.1f,"
+         " \"frame_bytes_max\": %llu, \"us_per_frame\": %.2f, \"min_us_per_frame\": %.2f, \"verified\": %s }",
+          (bench_first ? "" : ","), sc->name, (unsigned long long)st->keys, (unsigned long long)st->frames, (unsigned long long)st->output.bytes,
+          (unsigned long long)st->output.writes, (double)st->output.bytes / (double)frames,
+          (unsigned long long)st->frame_bytes_max, us[repeat/2], us[0], (ok ? "true" : "false"));
+  bench_first = false;
+  fflush(stdout);
+  vterm_free(incremental.vt);
+  return ok;
+}
+
+
+//-------------------------------------------------------------
+// Main
+//-------------------------------------------------------------
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--quick") == 0) { bench_repeat = 3; }
+    else if (strcmp(argv[i], "--show") == 0) { bench_show = true; }
+    else { bench_filter = argv[i]; }
+  }
+  alloc_t* mem = mem_new(&malloc, &realloc, &free);
+  if (mem == NULL) return 1;
+
+  static scenario_t scenarios[9];
+  int count = 0;
+  scenario_t* sc;
+
+  // typing a long line that wraps over several rows
+  sc = &scenarios[count++];
+  sc->name = "type_wrap";
+  keys_words(sc, 60);
+
+  // typing with syntax highlighting and brace matching
+  sc = &scenarios[count++];
+  sc->name = "type_highlight";
+  sc->setup = &setup_highlight;
+  keys_words(sc, 40);
+
+  // multiline input (ctrl-J inserts a newline)
+  sc = &scenarios[count++];
+  sc->name = "multiline";
+  sc->setup = &setup_highlight;
+  for (int i = 0; i < 8; i++) {
+    keys_words(sc, 5);
+    keys_add(sc, "\n");
+  }
+  keys_repeat(sc, KEYS_UP, 4);
+  keys_add(sc, "inserted ");
+
+  // cursor movement over a wrapped line
+  sc = &scenarios[count++];
+  sc->name = "cursor_move";
+  keys_words(sc, 30);
+  keys_repeat(sc, KEYS_LEFT, 40);
+  keys_repeat(sc, KEYS_CTRL_LEFT, 10);
+  keys_add(sc, KEYS_HOME);
+  keys_repeat(sc, KEYS_RIGHT, 30);
+  keys_add(sc, KEYS_END);
+
+  // editing in the middle of a line
+  sc = &scenarios[count++];
+  sc->name = "delete";
+  sc->setup = &setup_highlight;
+  keys_words(sc, 30);
+  keys_repeat(sc, "\x08", 20);         // backspace
+  keys_repeat(sc, KEYS_LEFT, 30);
+  keys_repeat(sc, KEYS_DEL, 10);
+  keys_add(sc, "\x17\x17\x17");        // ctrl-W
+  keys_add(sc, KEYS_END);
+  keys_add(sc, "\x15");                // ctrl-U
+
+  // browsing the history
+  sc = &scenarios[count++];
+  sc->name = "history";
+  sc->setup = &setup_history;
+  keys_add(sc, "draft");
+  keys_repeat(sc, KEYS_UP, 20);
+  keys_repeat(sc, KEYS_DOWN, 10);
+
+  // the completion menu
+  sc = &scenarios[count++];
+  sc->name = "completion_menu";
+  sc->setup = &setup_completion;
+  keys_add(sc, "run co");
+  keys_add(sc, "\t");
+  keys_repeat(sc, KEYS_DOWN, 5);
+  keys_add(sc, "\r");
+  keys_add(sc, " --all (x)");
+
+  // a narrow terminal with wide characters
+  sc = &scenarios[count++];
+  sc->name = "wide_narrow";
+  sc->width = 17;
+  for (int i = 0; i < 8; i++) { keys_add(sc, "\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E text "); }  // 日本語
+  keys_repeat(sc, KEYS_LEFT, 15);
+  keys_repeat(sc, "\x08", 6);
+
+  // moving the cursor up and down in an input that is much taller than the terminal
+  sc = &scenarios[count++];
+  sc->name = "cursor_tall";
+  sc->setup = &setup_tall;
+  keys_add(sc, KEYS_UP);               // load the tall entry
+  keys_add(sc, KEYS_PAGEDOWN);         // to the end of the input
+  keys_repeat(sc, KEYS_UP, 40);
+  keys_repeat(sc, KEYS_DOWN, 20);
+  keys_repeat(sc, KEYS_RIGHT, 5);
+  keys_repeat(sc, KEYS_LEFT, 5);
+
+  printf("{\n  \"library\": \"isocline\",\n  \"width\": %d,\n  \"height\": %d,\n  \"scenarios\": [", BENCH_WIDTH, BENCH_HEIGHT);
+  int failed = 0;
+  for (int i = 0; i < count; i++) {
+    if (!scenario_bench(&scenarios[i], mem)) { failed++; }
+  }
+  printf("\n  ],\n  \"failed\": %d\n}\n", failed);
+  mem_delete(mem);
+  return (failed > 0 ? 1 : 0);
+}
@@ -0,0 +1,175 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Benchmark the time-to-first-output of a fresh process:
+  the latency of a cold `ic_print` and a cold `ic_readline`.
+
+  usage: bench_startup [runs]           (run both benchmarks in child processes)
+         bench_startup print <fd>       (single cold `ic_print`, time is written to <fd>)
+         bench_startup readline <fd>    (single cold `ic_readline`, time is written to <fd>)
+
+  The children run in a pseudo terminal. For readline, an enter key is sent
+  as soon as the prompt appears so the measured time includes the full editor
+  initialization and rendering (and one pseudo terminal round trip).
+-----------------------------------------------------------------------------*/
+#if !defined(_WIN32) && !defined(_XOPEN_SOURCE)
+#define _XOPEN_SOURCE  700   // posix_openpt, clock_gettime
+#endif
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <isocline.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+#endif
+
+#if defined(_WIN32)
+#include <windows.h>
+static double now_us(void) {
+  LARGE_INTEGER t, freq;
+  QueryPerformanceCounter(&t);
+  QueryPerformanceFrequency(&freq);
+  return ((double)t.QuadPart * 1e6) / (double)freq.QuadPart;
+}
+#else
+static double now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((double)ts.tv_sec * 1e6) + ((double)ts.tv_nsec / 1e3);
+}
+#endif
+
+static int report(const char* fdarg, double elapsed_us) {
+  char buf[64];
+  int n = snprintf(buf, sizeof(buf), "%.1f\n", elapsed_us);
+  FILE* f = (fdarg != NULL ? fdopen(atoi(fdarg), "w") : stderr);
+  if (f == NULL) return 1;
+  fwrite(buf, 1, (size_t)n, f);
+  fclose(f);
+  return 0;
+}
+
+static int cold_print(const char* fdarg) {
+  double start = now_us();
+  ic_print("[ic-info]hello[/] world\n");
+  ic_term_flush();
+  return report(fdarg, now_us() - start);
+}
+
+static int cold_readline(const char* fdarg) {
+  double start = now_us();
+  char* input = ic_readline("bench");
+  double elapsed = now_us() - start;
+  ic_free(input);
+  return report(fdarg, elapsed);
+}
+
+
+//-------------------------------------------------------------
+// Driver: run each benchmark in fresh child processes
+//-------------------------------------------------------------
+
+#if !defined(_WIN32)
+
+static int cmp_double(const void* p1, const void* p2) {
+  double d1 = *((const double*)p1);
+  double d2 = *((const double*)p2);
+  return (d1 < d2 ? -1 : (d1 > d2 ? 1 : 0));
+}
+
+// run `self mode <fd>` with the standard handles connected to a fresh pseudo terminal.
+static double run_child(const char* self, const char* mode) {
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return -1;
+  const char* slave_name = ptsname(master);
+  int fds[2];
+  if (slave_name == NULL || pipe(fds) != 0) { close(master); return -1; }
+  pid_t pid = fork();
+  if (pid == 0) {
+    setsid();
+    int slave = open(slave_name, O_RDWR);
+    if (slave < 0) _exit(1);
+    dup2(slave, 0); dup2(slave, 1); dup2(slave, 2);
+    close(master); close(fds[0]);
+    char fdarg[16];
+    snprintf(fdarg, sizeof(fdarg), "%d", fds[1]);
+    execl(self, self, mode, fdarg, (char*)NULL);
+    _exit(1);
+  }
+  close(fds[1]);
+  // echo the terminal output until the child reports; send enter once the prompt marker appears
+  char buf[256];
+  bool sent = false;
+  struct pollfd pfds[2] = { { master, POLLIN, 0 }, { fds[0], POLLIN, 0 } };
+  while (poll(pfds, 2, 2000) > 0 && (pfds[1].revents == 0)) {
+    if ((pfds[0].revents & POLLIN) != 0) {
+      ssize_t n = read(master, buf, sizeof(buf) - 1);
+      if (n <= 0) break;
+      buf[n] = 0;
+      if (!sent && strstr(buf, "> ") != NULL) {
+        sent = (write(master, "\r", 1) == 1);
+      }
+    }
+    else if (pfds[0].revents != 0) break;
+  }
+  double elapsed = -1;
+  FILE* f = fdopen(fds[0], "r");
+  if (f != NULL) {
+    if (fgets(buf, sizeof(buf), f) != NULL) { elapsed = atof(buf); }
+    fclose(f);
+  }
+  kill(pid, SIGTERM);
+  waitpid(pid, NULL, 0);
+  close(master);
+  return elapsed;
+}
+
+static void bench(const char* self, const char* mode, int runs) {
+  double* times = (double*)malloc(sizeof(double) * (size_t)runs);
+  if (times == NULL) return;
+  int count = 0;
+  for (int i = 0; i < runs; i++) {
+    double t = run_child(self, mode);
+    if (t >= 0) { times[count++] = t; }
+  }
+  if (count == 0) {
+    printf("cold %-9s: failed\n", mode);
+  }
+  else {
+    qsort(times, (size_t)count, sizeof(double), &cmp_double);
+    printf("cold %-9s: min %8.1f us, median %8.1f us, max %8.1f us  (%d runs)\n",
+            mode, times[0], times[count/2], times[count-1], count);
+  }
+  free(times);
+}
+
+#endif
+
+int main(int argc, char** argv) {
+  if (argc >= 2 && strcmp(argv[1], "print") == 0) {
+    return cold_print(argc >= 3 ? argv[2] : NULL);
+  }
+  else if (argc >= 2 && strcmp(argv[1], "readline") == 0) {
+    return cold_readline(argc >= 3 ? argv[2] : NULL);
+  }
+  #if defined(_WIN32)
+  printf("usage: bench_startup (print|readline)\n");
+  return 1;
+  #else
+  int runs = (argc >= 2 ? atoi(argv[1]) : 20);
+  if (runs <= 0) runs = 20;
+  bench(argv[0], "print", runs);
+  bench(argv[0], "readline", runs);
+  return 0;
+  #endif
+}
@@ -0,0 +1,84 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Example use of the C++ interface (`include/isocline.hpp`).
+-----------------------------------------------------------------------------*/
+#include <clocale>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include "isocline.hpp"
+
+// complete the current word from a list of keywords (and file names)
+static void completer( ic::completions& out, std::string_view input ) {
+  out.complete_filename(input, 0, ".;/usr/local;c:\\Program Files", nullptr);
+  out.complete_word(input, [](ic::completions& out, std::string_view word) {
+    static const char* keywords[] = { "print", "println", "printer", "printsln", "prompt" };
+    out.add_all(word, keywords);
+    if (word == "id") {
+      out.add("(x) => x",   "D — (x) => x",       "identity function in D");
+      out.add("fun x -> x", "Ocaml — fun x -> x", "identity lambda in OCaml");
+    }
+    else if (!word.empty() && std::string_view("hello isocline ").substr(0, word.size()) == word) {
+      for (int i = 0; i < 100000; i++) {
+        char buf[32];
+        std::snprintf(buf, sizeof(buf), "hello isocline %03d", i + 1);
+        if (!out.add(buf)) break;   // stop early if not all completions are needed
+      }
+    }
+  });
+}
+
+// highlight keywords and numbers using native character classes
+static void highlighter( ic::highlighter& hl, std::string_view input ) {
+  static const char* keywords[] = { "fun", "static", "const", "struct", nullptr };
+  static const char* types[]    = { "int", "double", "char", "void", nullptr };
+  ic_char_class_t idletters;
+  ic_char_class_t digits;
+  ic_char_class_init(&idletters, IC_CHAR_CLASS_IDLETTER);
+  ic_char_class_init(&digits, IC_CHAR_CLASS_DIGIT);
+  const char* s = input.data();    // the input is 0-terminated
+  const long len = (long)input.size();
+  for (long i = 0; i < len; ) {
+    long tlen;
+    if ((tlen = ic_match_any_token_class(s, i, &idletters, keywords)) > 0) {
+      hl.style(i, tlen, "keyword");
+    }
+    else if ((tlen = ic_match_any_token_class(s, i, &idletters, types)) > 0) {
+      hl.style(i, tlen, "type");
+    }
+    else if ((tlen = ic_is_token_class(s, i, &digits)) > 0) {
+      hl.style(i, tlen, "number");
+    }
+    else {
+      tlen = 1;
+    }
+    i += tlen;
+  }
+}
+
+int main() {
+  std::setlocale(LC_ALL, "C.UTF-8");
+  ic_style_def("ic-prompt", "ansi-maroon");
+  ic_printf("[b]Isocline[/b] C++ sample program:\n"
+            "- Type 'exit' to quit. (or use ctrl-d).\n"
+            "- Type 'p' (or 'id', or 'h') followed by tab for completion.\n"
+            "- Type 'fun' or 'int' to see syntax highlighting.\n\n");
+  ic_set_history("history.txt", -1);
+  ic_enable_auto_tab(true);
+
+  ic::session session{ &completer, &highlighter };
+  while (ic::line input = session.readline("isoclinε")) {
+    const bool stop = (input.view() == "exit" || input.view().empty());
+    ic::style gray("gray");
+    ic_printf("-----\n");
+    ic_println(input.c_str());   // printed as bbcode
+    ic_printf("-----\n");
+    if (stop) break;
+  }
+  ic_println("done");
+  return 0;
+}
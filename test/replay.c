@@ -0,0 +1,153 @@
+/* ----------------------------------------------------------------------------
+  Copyright (c) 2021, Daan Leijen
+  This is free software; you can redistribute it and/or modify it
+  under the terms of the MIT License. A copy of the license can be
+  found in the "LICENSE" file at the root of this distribution.
+
+  Replay recorded key sessions and report the keystroke latencies.
+
+  usage: replay [--repeat N] [--show] recording ...
+
+  Record a session of any program using isocline with:
+
+    $ ISOCLINE_RECORD=session.txt ./example
+
+  The recording contains the key codes, read timeouts, and terminal
+  sizes (see `src/tty.c`). This program replays it deterministically
+  on a headless virtual terminal using the completer and highlighter
+  of `test/example.c` and writes the latency distribution of each
+  phase as JSON to stdout. The history is kept in memory only.
+  `--show` prints the final screen of the last run to stderr.
+-----------------------------------------------------------------------------*/
+#include "../src/isocline.c"
+
+// reuse the completer and highlighter of the example
+#define main example_main
+#include "example.c"
+#undef main
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int  replay_repeat = 10;
+static bool replay_show;
+
+static void hist_merge( ic_stat_hist_t* hist, const ic_stat_hist_t* h ) {
+  hist->count    += h->count;
+  hist->total_us += h->total_us;
+  if (h->max_us > hist->max_us) { hist->max_us = h->max_us; }
+  for (ssize_t i = 0; i < IC_STAT_BUCKETS; i++) {
+    hist->buckets[i] += h->buckets[i];
+  }
+}
+
+// Replay a recording once and add its statistics to `total`.
+static bool replay_run( const char* fname, alloc_t* mem, ic_stats_t* total, bool show ) {
+  vterm_t* vt = vterm_new(mem, 80, 25);
+  if (vt == NULL) return false;
+  ic_env_t* env = ic_env_create_headless(vt);
+  if (env == NULL || env->noedit || !tty_replay_load(env->tty, fname)) {
+    if (env != NULL) { ic_env_free_headless(env); }
+    vterm_free(vt);
+    return false;
+  }
+
+  // the same settings as the example
+  bbcode_style_def(env->bbcode, "ic-prompt", "ansi-maroon");
+  history_load_from(env->history, NULL, -1);
+  completions_set_completer(env->completions, &completer, NULL);
+  env->highlighter = &highlighter;
+  env->highlighter_arg = NULL;
+  env->complete_autotab = true;
+
+  term_update_dim(env->term);   // at the initial size of the recording
+  ic_env_reset_stats(env);
+  while (!tty_replay_done(env->tty)) {
+    char* input = ic_editline(env, "isocline\xCE\xB5");
+    if (input != NULL) {
+      bbcode_printf(env->bbcode, "[gray]-----[/]\n%s\n[gray]-----[/]\n", input);
+      mem_raw_free(env->mem, input);
+    }
+  }
+
+  ic_stats_t stats;
+  ic_env_get_stats(env, &stats);
+  total->keys   += stats.keys;
+  total->frames += stats.frames;
+  total->frames_degraded += stats.frames_degraded;
+  total->output.bytes  += stats.output.bytes;
+  total->output.writes += stats.output.writes;
+  for (ssize_t i = 0; i < IC_STAT_COUNT; i++) {
+    hist_merge(&total->phases[i], &stats.phases[i]);
+  }
+  if (show) {
+    stringbuf_t* sb = sbuf_new(mem);
+    if (sb != NULL) {
+      vterm_screen_text(vt, sb);
+      fprintf(stderr, "--- %s\n%s\n", fname, sbuf_string(sb));
+      sbuf_free(sb);
+    }
+  }
+  ic_env_free_headless(env);
+  vterm_free(vt);
+  return true;
+}
+
+static bool replay_report( const char* fname, alloc_t* mem, bool first ) {
+  ic_stats_t total;
+  memset(&total, 0, sizeof(total));
+  for (int i = 0; i < replay_repeat; i++) {
+    if (!replay_run(fname, mem, &total, replay_show && i == replay_repeat - 1)) {
+      fprintf(stderr, "replay: unable to replay: %s\n", fname);
+      return false;
+    }
+  }
+  const uint64_t runs = (uint64_t)replay_repeat;
+  printf("%s\n    { \"recording\": \"%s\", \"runs\": %d, \"keys\": %llu, \"frames\": %llu, \"frames_degraded\": %llu, \"bytes\": %llu, \"writes\": %llu,\n"
+         "      \"phases\": [",
+          (first ? "" : ","), fname, replay_repeat, (unsigned long long)(total.keys / runs), (unsigned long long)(total.frames / runs),
+          (unsigned long long)(total.frames_degraded / runs), (unsigned long long)(total.output.bytes / runs),
+          (unsigned long long)(total.output.writes / runs));
+  bool first_phase = true;
+  for (ssize_t i = 0; i < IC_STAT_COUNT; i++) {
+    const ic_stat_hist_t* hist = &total.phases[i];
+    if (i == IC_STAT_WAIT || hist->count == 0) continue;  // waiting is not a latency in a replay
+    printf("%s\n        { \"phase\": \"%s\", \"count\": %llu, \"mean_us\": %.1f, \"p50_us\": %llu, \"p90_us\": %llu, \"p99_us\": %llu, \"max_us\": %llu }",
+            (first_phase ? "" : ","), stats_phase_names[i], (unsigned long long)hist->count,
+            (double)hist->total_us / (double)hist->count,
+            (unsigned long long)ic_stat_percentile(hist, 0.50), (unsigned long long)ic_stat_percentile(hist, 0.90),
+            (unsigned long long)ic_stat_percentile(hist, 0.99), (unsigned long long)hist->max_us);
+    first_phase = false;
+  }
+  printf("\n      ] }");
+  fflush(stdout);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  setlocale(LC_ALL,"C.UTF-8");
+  alloc_t* mem = mem_new(&malloc, &realloc, &free);
+  if (mem == NULL) return 1;
+  int count = 0;
+  bool ok = true;
+  printf("{\n  \"library\": \"isocline\",\n  \"replays\": [");
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+      replay_repeat = atoi(argv[++i]);
+      if (replay_repeat <= 0) { replay_repeat = 1; }
+    }
+    else if (strcmp(argv[i], "--show") == 0) { replay_show = true; }
+    else {
+      ok = replay_report(argv[i], mem, count == 0) && ok;
+      count++;
+    }
+  }
+  printf("\n  ]\n}\n");
+  mem_delete(mem);
+  if (count == 0) {
+    fprintf(stderr, "usage: replay [--repeat N] [--show] recording ...\n");
+    return 1;
+  }
+  return (ok ? 0 : 1);
+}
@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+# ----------------------------------------------------------------------------
+# Copyright (c) 2021, Daan Leijen
+# This is free software; you can redistribute it and/or modify it
+# under the terms of the MIT License. A copy of the license can be
+# found in the "LICENSE" file at the root of this distribution.
+# ----------------------------------------------------------------------------
+# Generate `src/wcwidth_data.c`: a two-level lookup table for the column
+# width of unicode code points (used by `mk_wcwidth` in `src/wcwidth.c`).
+#
+# usage: python3 util/gen_wcwidth.py [--ucd <dir>] [-o src/wcwidth_data.c]
+#
+# Without `--ucd` the Unicode data built into Python's `unicodedata` module is
+# used. To use a newer Unicode version, download `UnicodeData.txt` and
+# `EastAsianWidth.txt` from <https://www.unicode.org/Public/UCD/latest/ucd/>
+# and pass their directory with `--ucd`.
+# ----------------------------------------------------------------------------
+
+import argparse
+import os
+import re
+import sys
+
+MAX_CODEPOINT = 0x110000
+BLOCK_SHIFT   = 8                     # 256 code points per block
+BLOCK_SIZE    = 1 << BLOCK_SHIFT
+
+# Unassigned code points in these ranges default to East Asian Wide (see EastAsianWidth.txt)
+DEFAULT_WIDE = [(0x3400, 0x4DBF), (0x4E00, 0x9FFF), (0xF900, 0xFAFF),
+                (0x20000, 0x2FFFD), (0x30000, 0x3FFFD)]
+
+# Hangul Jamo medial vowels and final consonants combine with the initial consonant
+ZERO_WIDTH   = [(0x1160, 0x11FF), (0xD7B0, 0xD7FF), (0x200B, 0x200B)]
+
+
+def load_python():
+  import unicodedata
+  cats = {}
+  eaws = {}
+  for cp in range(MAX_CODEPOINT):
+    ch = chr(cp)
+    cat = unicodedata.category(ch)
+    if cat != "Cn":
+      cats[cp] = cat
+      eaws[cp] = unicodedata.east_asian_width(ch)
+  return unicodedata.unidata_version, cats, eaws
+
+
+def load_ucd(path):
+  cats = {}
+  first = None
+  with open(os.path.join(path, "UnicodeData.txt"), encoding="utf-8") as f:
+    for line in f:
+      fields = line.split(";")
+      if len(fields) < 3:
+        continue
+      cp, name, cat = int(fields[0], 16), fields[1], fields[2]
+      if name.endswith(", First>"):
+        first = cp
+      elif name.endswith(", Last>"):
+        for c in range(first, cp + 1):
+          cats[c] = cat
+      else:
+        cats[cp] = cat
+  eaws = {}
+  version = "unknown"
+  with open(os.path.join(path, "EastAsianWidth.txt"), encoding="utf-8") as f:
+    for line in f:
+      m = re.match(r"#\s*EastAsianWidth-(\d+\.\d+\.\d+)\.txt", line)
+      if m:
+        version = m.group(1)
+      m = re.match(r"([0-9A-Fa-f]+)(?:\.\.([0-9A-Fa-f]+))?\s*;\s*(\w+)", line)
+      if m:
+        lo = int(m.group(1), 16)
+        hi = int(m.group(2), 16) if m.group(2) else lo
+        for c in range(lo, hi + 1):
+          eaws[c] = m.group(3)
+  return version, cats, eaws
+
+
+def in_ranges(cp, ranges):
+  return any(lo <= cp <= hi for (lo, hi) in ranges)
+
+
+def column_width(cp, cats, eaws):
+  cat = cats.get(cp, "Cn")
+  if cp == 0x00AD:                                   # soft hyphen
+    return 1
+  if cat in ("Mn", "Me", "Cf") or in_ranges(cp, ZERO_WIDTH):
+    return 0
+  if cat == "Cn":
+    return (2 if in_ranges(cp, DEFAULT_WIDE) else 1)
+  if eaws.get(cp, "N") in ("W", "F"):
+    return 2
+  return 1
+
+
+def main():
+  parser = argparse.ArgumentParser(description="generate the unicode column width tables")
+  parser.add_argument("--ucd", help="directory with UnicodeData.txt and EastAsianWidth.txt")
+  parser.add_argument("-o", "--output", default=os.path.join(os.path.dirname(__file__), "..", "src", "wcwidth_data.c"))
+  args = parser.parse_args()
+
+  version, cats, eaws = (load_ucd(args.ucd) if args.ucd else load_python())
+
+  # second level: unique blocks of 256 widths packed as 2 bits per code point
+  blocks = []
+  block_index = {}
+  stage1 = []
+  for b in range(MAX_CODEPOINT >> BLOCK_SHIFT):
+    packed = bytearray(BLOCK_SIZE // 4)
+    for i in range(BLOCK_SIZE):
+      w = column_width((b << BLOCK_SHIFT) + i, cats, eaws)
+      packed[i >> 2] |= (w << ((i & 3) * 2))
+    key = bytes(packed)
+    if key not in block_index:
+      block_index[key] = len(blocks)
+      blocks.append(key)
+    stage1.append(block_index[key])
+  if len(blocks) > 256:
+    sys.exit("error: too many unique blocks for a uint8_t index")
+
+  out = []
+  out.append("// include in \"wcwidth.c\"")
+  out.append("// Generated by util/gen_wcwidth.py from Unicode %s; do not edit." % version)
+  out.append("//")
+  out.append("// The column width (0, 1, or 2) of code point `c` is stored in 2 bits at")
+  out.append("// `wcwidth_blocks[wcwidth_index[c >> %d]][(c & 0x%X) >> 2]`, at bit offset `2*(c & 3)`." % (BLOCK_SHIFT, BLOCK_SIZE - 1))
+  out.append("")
+  out.append("#define WCWIDTH_UNICODE_VERSION  \"%s\"" % version)
+  out.append("#define WCWIDTH_BLOCK_SHIFT      (%d)" % BLOCK_SHIFT)
+  out.append("")
+  out.append("static const uint8_t wcwidth_index[%d] = {" % len(stage1))
+  for i in range(0, len(stage1), 16):
+    out.append("  " + ",".join("%3d" % x for x in stage1[i:i+16]) + ",")
+  out.append("};")
+  out.append("")
+  out.append("static const uint8_t wcwidth_blocks[%d][%d] = {" % (len(blocks), BLOCK_SIZE // 4))
+  for blk in blocks:
+    out.append("  {")
+    for i in range(0, len(blk), 16):
+      out.append("    " + ",".join("0x%02x" % x for x in blk[i:i+16]) + ",")
+    out.append("  },")
+  out.append("};")
+  with open(args.output, "w", encoding="utf-8", newline="\n") as f:
+    f.write("\n".join(out) + "\n")
+  print("generated %s: unicode %s, %d blocks, %d bytes" %
+        (args.output, version, len(blocks), len(stage1) + len(blocks) * (BLOCK_SIZE // 4)))
+
+
+if __name__ == "__main__":
+  main()